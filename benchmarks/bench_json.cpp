@@ -0,0 +1,111 @@
+#include <cstdlib>
+#include <filesystem>
+#include "bench_json.h"
+#include "common/util/FileUtil.h"
+#include "third-party/fmt/core.h"
+
+namespace bench {
+
+const char* const OPTIONS_USAGE =
+    "  --out             write results to this JSON file\n"
+    "  --baseline        compare results against this JSON file from an earlier run\n"
+    "  --max-regression  fail if a benchmark is slower than the baseline by more than this ratio\n"
+    "  --filter          only run some of the benchmarks\n";
+
+/*!
+ * If argv[*i] is one of the shared options, read it and its value into options, advance *i past
+ * them and return true.
+ */
+bool parse_option(int argc, char** argv, int* i, Options* options) {
+  std::string arg = argv[*i];
+  if (*i + 1 >= argc) {
+    return false;
+  }
+  if (arg == "--out") {
+    options->out_file = argv[++*i];
+  } else if (arg == "--baseline") {
+    options->baseline_file = argv[++*i];
+  } else if (arg == "--max-regression") {
+    options->max_regression = atof(argv[++*i]);
+  } else if (arg == "--filter") {
+    options->filter = argv[++*i];
+  } else {
+    return false;
+  }
+  return true;
+}
+
+nlohmann::json to_json(const std::string& unit, const std::vector<Result>& results) {
+  nlohmann::json benchmarks = nlohmann::json::array();
+  for (auto& result : results) {
+    nlohmann::json entry = result.info;
+    entry["name"] = result.name;
+    entry["value"] = result.value;
+    if (result.checksum) {
+      entry["checksum"] = *result.checksum;
+    }
+    benchmarks.push_back(entry);
+  }
+  return {{"unit", unit}, {"benchmarks", benchmarks}};
+}
+
+/*!
+ * Write results to a file, creating its folder if needed.
+ */
+void write_results(const std::string& file_name, const nlohmann::json& results) {
+  auto dir = std::filesystem::path(file_name).parent_path();
+  if (!dir.empty()) {
+    std::filesystem::create_directories(dir);
+  }
+  file_util::write_text_file(file_name, results.dump(2));
+}
+
+nlohmann::json read_baseline(const std::string& file_name) {
+  return nlohmann::json::parse(file_util::read_text_file(file_name));
+}
+
+/*!
+ * Print the results next to the baseline. Returns false if the baseline has a different unit, if
+ * a value is larger than the baseline by more than max_regression, or if a checksum changed.
+ */
+bool compare_to_baseline(const std::string& unit,
+                         const std::vector<Result>& results,
+                         const nlohmann::json& baseline,
+                         double max_regression) {
+  auto baseline_unit = baseline.value("unit", std::string());
+  if (baseline_unit != unit) {
+    fmt::print("Can't compare to the baseline, it is in '{}' instead of '{}'\n", baseline_unit,
+               unit);
+    return false;
+  }
+
+  bool ok = true;
+  fmt::print("{:<36} {:>12} {:>12} {:>8}\n", "benchmark", unit, "baseline", "ratio");
+  for (auto& result : results) {
+    const nlohmann::json* old = nullptr;
+    for (auto& entry : baseline.at("benchmarks")) {
+      if (entry.at("name").get<std::string>() == result.name) {
+        old = &entry;
+      }
+    }
+    if (!old) {
+      fmt::print("{:<36} {:>12.3f} {:>12} {:>8}\n", result.name, result.value, "-", "-");
+      continue;
+    }
+
+    double old_value = old->at("value").get<double>();
+    double ratio = old_value > 0 ? result.value / old_value : 1;
+    const char* note = "";
+    if (result.checksum && old->value("checksum", *result.checksum) != *result.checksum) {
+      note = " checksum changed!";
+      ok = false;
+    } else if (max_regression > 0 && ratio > max_regression) {
+      note = " regression!";
+      ok = false;
+    }
+    fmt::print("{:<36} {:>12.3f} {:>12.3f} {:>8.3f}{}\n", result.name, result.value, old_value,
+               ratio, note);
+  }
+  return ok;
+}
+}  // namespace bench
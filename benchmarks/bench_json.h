@@ -0,0 +1,49 @@
+#pragma once
+
+/*!
+ * @file bench_json.h
+ * The results file and baseline comparison shared by the benchmark programs.
+ *
+ * Results are written as JSON:
+ *   {"unit": "ms", "benchmarks": [{"name": "...", "value": 1.23, ...}, ...]}
+ * Each benchmark has a value, where lower is better, that is compared against the same benchmark
+ * in the baseline. It may also have a checksum, which must match the baseline exactly, and other
+ * fields that are only there for information.
+ */
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+#include "third-party/json.hpp"
+
+namespace bench {
+struct Result {
+  std::string name;
+  double value = 0;
+  std::optional<s64> checksum;
+  nlohmann::json info = nlohmann::json::object();  // written, but not compared
+};
+
+/*!
+ * Command line options that all of the benchmark programs take.
+ */
+struct Options {
+  std::string out_file;
+  std::string baseline_file;
+  std::string filter;
+  double max_regression = 0;
+};
+
+// help text for the options above, for the usage message.
+extern const char* const OPTIONS_USAGE;
+
+bool parse_option(int argc, char** argv, int* i, Options* options);
+nlohmann::json to_json(const std::string& unit, const std::vector<Result>& results);
+void write_results(const std::string& file_name, const nlohmann::json& results);
+nlohmann::json read_baseline(const std::string& file_name);
+bool compare_to_baseline(const std::string& unit,
+                         const std::vector<Result>& results,
+                         const nlohmann::json& baseline,
+                         double max_regression);
+}  // namespace bench
@@ -0,0 +1,159 @@
+/*!
+ * @file goal_bench_main.cpp
+ * Benchmarks for code compiled by goalc.
+ *
+ * This builds the game, starts the runtime, then compiles and runs the GOAL benchmarks in the
+ * goal_bench folder. Each benchmark reports the fastest of several runs, measured with the time
+ * stamp counter. The results are written as JSON (see bench_json.h), and can be compared against
+ * the results of an earlier run:
+ *   goal-bench --out before.json
+ *   (change the compiler)
+ *   goal-bench --baseline before.json
+ * Compiler settings can be changed for the benchmarks with --config, for example to compare the
+ * loop optimizer against the default:
+ *   goal-bench --config optimize-loops '#t' --baseline before.json
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include "benchmarks/bench_json.h"
+#include "common/log/log.h"
+#include "common/util/FileUtil.h"
+#include "game/runtime.h"
+#include "goalc/compiler/Compiler.h"
+#include "third-party/fmt/core.h"
+
+namespace {
+// each group is a file bench-<group>.gc with a function (bench-<group>) that runs its benchmarks.
+const std::vector<std::string> bench_groups = {"loops", "math", "format", "method", "process"};
+
+struct BenchResult {
+  std::string name;
+  s64 iterations = 0;
+  s64 cycles = 0;
+  s64 checksum = 0;
+
+  double cycles_per_iteration() const { return double(cycles) / iterations; }
+};
+
+void print_usage() {
+  printf(
+      "usage: goal-bench [--out file] [--baseline file] [--max-regression ratio] [--filter name]\n"
+      "                  [--config setting value]\n"
+      "%s"
+      "  --config          set-config! for compiling the benchmarks, can be used more than once\n"
+      "--filter runs the groups with the given text in their name.\n"
+      "Results go to out/goal-bench.json by default.\n",
+      bench::OPTIONS_USAGE);
+}
+
+void run_runtime() {
+  constexpr int argc = 4;
+  const char* argv[argc] = {"", "-fakeiso", "-debug", "-nodisplay"};
+  exec_runtime(argc, const_cast<char**>(argv));
+}
+
+/*!
+ * Get the results from the output of a benchmark group, lines of "bench name iterations cycles
+ * checksum".
+ */
+std::vector<BenchResult> parse_results(const std::vector<std::string>& output) {
+  std::vector<BenchResult> results;
+  for (auto& message : output) {
+    std::istringstream lines(message);
+    std::string line;
+    while (std::getline(lines, line)) {
+      std::istringstream words(line);
+      std::string tag;
+      BenchResult result;
+      if (words >> tag >> result.name >> result.iterations >> result.cycles >> result.checksum &&
+          tag == "bench" && result.iterations > 0) {
+        results.push_back(result);
+      }
+    }
+  }
+  return results;
+}
+
+/*!
+ * Get the results to save and compare. Benchmarks are compared by cycles per iteration, and the
+ * checksum must not change.
+ */
+std::vector<bench::Result> to_bench_results(const std::vector<BenchResult>& results) {
+  std::vector<bench::Result> out;
+  for (auto& result : results) {
+    bench::Result bench_result;
+    bench_result.name = result.name;
+    bench_result.value = result.cycles_per_iteration();
+    bench_result.checksum = result.checksum;
+    bench_result.info = {{"iterations", result.iterations}, {"cycles", result.cycles}};
+    out.push_back(bench_result);
+  }
+  return out;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bench::Options options;
+  options.out_file = file_util::get_file_path({"out", "goal-bench.json"});
+  std::vector<std::string> configs;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (bench::parse_option(argc, argv, &i, &options)) {
+      continue;
+    } else if (i + 2 < argc && arg == "--config") {
+      configs.push_back(fmt::format("(set-config! {} {})", argv[i + 1], argv[i + 2]));
+      i += 2;
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+
+  nlohmann::json baseline;
+  if (!options.baseline_file.empty()) {
+    baseline = bench::read_baseline(options.baseline_file);
+  }
+
+  lg::initialize();
+  Compiler compiler;
+  compiler.run_test_no_load("test/goalc/source_templates/with_game/test-build-game.gc");
+  std::thread runtime_thread(run_runtime);
+  compiler.run_test_from_file("test/goalc/source_templates/with_game/test-load-game.gc");
+  compiler.run_test_from_string("(ml \"benchmarks/goal_bench/bench-lib.gc\")");
+  for (auto& config : configs) {
+    compiler.run_test_from_string(config);
+  }
+
+  std::vector<BenchResult> results;
+  for (auto& group : bench_groups) {
+    if (group.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    compiler.run_test_from_string(
+        fmt::format("(ml \"benchmarks/goal_bench/bench-{}.gc\")", group));
+    auto group_results =
+        parse_results(compiler.run_test_from_string(fmt::format("(bench-{})", group)));
+    for (auto& result : group_results) {
+      fmt::print("[goal-bench] {:<24} {:>12.1f} cycles/iter\n", result.name,
+                 result.cycles_per_iteration());
+      results.push_back(result);
+    }
+  }
+
+  compiler.shutdown_target();
+  runtime_thread.join();
+
+  auto bench_results = to_bench_results(results);
+  bench::write_results(options.out_file, bench::to_json("cycles/iter", bench_results));
+  fmt::print("[goal-bench] wrote {}\n", options.out_file);
+
+  if (!options.baseline_file.empty() &&
+      !bench::compare_to_baseline("cycles/iter", bench_results, baseline, options.max_regression)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,428 @@
+/*!
+ * @file pipeline_bench_main.cpp
+ * Benchmarks for each stage of the decompiler and the compiler, and for the debugger's address
+ * lookups and the symbol Trie.
+ *
+ * The decompiler runs on the object files that have a reference in test/decompiler/reference, and
+ * the compiler runs on the goal_src files with the same names. Each stage is timed on every
+ * repetition, and the results are written as JSON (see bench_json.h) so they can be compared
+ * against an earlier run:
+ *   pipeline-bench --out before.json
+ *   (change the decompiler or compiler)
+ *   pipeline-bench --baseline before.json --max-regression 1.1
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+
+#include "benchmarks/bench_json.h"
+#include "common/link_types.h"
+#include "common/log/log.h"
+#include "common/util/FileUtil.h"
+#include "common/util/Timer.h"
+#include "common/util/Trie.h"
+#include "decompiler/Disasm/OpcodeInfo.h"
+#include "decompiler/ObjectFile/ObjectFileDB.h"
+#include "decompiler/config.h"
+#include "goalc/compiler/Compiler.h"
+#include "goalc/debugger/DebugInfo.h"
+#include "goalc/listener/MemoryMap.h"
+#include "test/all_jak1_symbols.h"
+#include "third-party/fmt/core.h"
+
+namespace {
+struct Options : bench::Options {
+  std::string iso_data_path;
+  int repetitions = 5;
+};
+
+/*!
+ * The times for a single stage, one per repetition.
+ */
+struct StageResult {
+  std::string name;
+  std::vector<double> times_ms;
+  size_t memory_bytes = 0;  // for stages that build something, how big it is
+
+  double min_ms() const { return *std::min_element(times_ms.begin(), times_ms.end()); }
+  double max_ms() const { return *std::max_element(times_ms.begin(), times_ms.end()); }
+  double median_ms() const {
+    auto sorted = times_ms;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted.at(sorted.size() / 2);
+  }
+};
+
+class Results {
+ public:
+  void add(const std::string& name, double ms) {
+    for (auto& stage : m_stages) {
+      if (stage.name == name) {
+        stage.times_ms.push_back(ms);
+        return;
+      }
+    }
+    m_stages.push_back({name, {ms}});
+  }
+
+  /*!
+   * Run f and add its time to the stage.
+   */
+  void time(const std::string& name, const std::function<void()>& f) {
+    Timer timer;
+    f();
+    add(name, timer.getMs());
+  }
+
+  /*!
+   * Set the memory used by what the stage built. The stage must have been added already.
+   */
+  void set_memory(const std::string& name, size_t bytes) {
+    for (auto& stage : m_stages) {
+      if (stage.name == name) {
+        stage.memory_bytes = bytes;
+      }
+    }
+  }
+
+  const std::vector<StageResult>& stages() const { return m_stages; }
+
+ private:
+  std::vector<StageResult> m_stages;  // in the order they ran
+};
+
+void print_usage() {
+  printf(
+      "usage: pipeline-bench [--out file] [--baseline file] [--max-regression ratio]\n"
+      "                      [--filter group] [--repetitions n] [--iso-data path]\n"
+      "%s"
+      "  --repetitions     times to run each stage (default 5)\n"
+      "  --iso-data        folder with the game's CGO folder (default iso_data)\n"
+      "The groups for --filter are decompiler, compiler, debugger and trie.\n"
+      "Results go to out/pipeline-bench.json by default.\n",
+      bench::OPTIONS_USAGE);
+}
+
+/*!
+ * Get the names of the object files with a reference in test/decompiler/reference, in order.
+ */
+std::vector<std::string> get_reference_objects() {
+  const std::string suffix = "_REF.gc";
+  std::vector<std::string> result;
+  for (auto& entry : std::filesystem::directory_iterator(
+           file_util::get_file_path({"test", "decompiler", "reference"}))) {
+    auto name = entry.path().filename().string();
+    if (name.size() > suffix.size() &&
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      result.push_back(name.substr(0, name.size() - suffix.size()));
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/*!
+ * Find the goal_src file for each object. Returns paths relative to the project folder.
+ */
+std::vector<std::string> get_source_files(const std::vector<std::string>& objects) {
+  std::vector<std::string> result;
+  auto goal_src = std::filesystem::path(file_util::get_file_path({"goal_src"}));
+  for (auto& obj : objects) {
+    for (auto& entry : std::filesystem::recursive_directory_iterator(goal_src)) {
+      if (entry.path().filename() == obj + ".gc") {
+        auto relative = std::filesystem::relative(entry.path(), goal_src.parent_path());
+        result.push_back(relative.generic_string());
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+/*!
+ * Run the decompiler on the reference objects, timing each stage.
+ * This follows ObjectFileDB::analyze_functions_ir2, but times each pass separately.
+ */
+void run_decompiler(const std::vector<std::string>& dgo_paths, Results* results) {
+  auto& config = decompiler::get_config();
+  std::unique_ptr<decompiler::ObjectFileDB> db;
+
+  // this also loads the types from all-types.gc, which is small compared to the DGOs.
+  results->time("decompiler/read-dgo", [&]() {
+    db = std::make_unique<decompiler::ObjectFileDB>(dgo_paths, config.obj_file_name_map_file,
+                                                    std::vector<std::string>{},
+                                                    std::vector<std::string>{});
+  });
+  results->time("decompiler/process-link-data", [&]() { db->process_link_data(); });
+  results->time("decompiler/find-code", [&]() { db->find_code(); });
+  results->time("decompiler/process-labels", [&]() { db->process_labels(); });
+
+  results->time("decompiler/ir2-top-level", [&]() { db->ir2_top_level_pass(); });
+  results->time("decompiler/ir2-basic-blocks", [&]() { db->ir2_basic_block_pass(); });
+  results->time("decompiler/ir2-atomic-ops", [&]() { db->ir2_atomic_op_pass(); });
+  results->time("decompiler/ir2-type-analysis", [&]() { db->ir2_type_analysis_pass(); });
+  results->time("decompiler/ir2-register-usage", [&]() { db->ir2_register_usage_pass(); });
+  results->time("decompiler/ir2-variables", [&]() { db->ir2_variable_pass(); });
+  results->time("decompiler/ir2-cfg-build", [&]() { db->ir2_cfg_build_pass(); });
+  if (config.analyze_expressions) {
+    results->time("decompiler/ir2-store-forms", [&]() { db->ir2_store_current_forms(); });
+    results->time("decompiler/ir2-expressions", [&]() { db->ir2_build_expressions(); });
+    results->time("decompiler/ir2-inline-asm",
+                  [&]() { db->ir2_rewrite_inline_asm_instructions(); });
+    if (config.insert_lets) {
+      results->time("decompiler/ir2-insert-lets", [&]() { db->ir2_insert_lets(); });
+    }
+    results->time("decompiler/ir2-anonymous-functions",
+                  [&]() { db->ir2_insert_anonymous_functions(); });
+  }
+
+  results->time("decompiler/final-output", [&]() {
+    db->for_each_obj([&](decompiler::ObjectFileData& data) { db->ir2_final_out(data); });
+  });
+}
+
+/*!
+ * Compile the source files, timing each stage. The times are the total for all of the files.
+ * Macro expansion happens during compilation, so its time is taken out of the compile time.
+ */
+void run_compiler(Compiler* compiler,
+                  const std::vector<std::string>& source_files,
+                  Results* results) {
+  double read_ms = 0, macro_ms = 0, compile_ms = 0, color_ms = 0, codegen_ms = 0;
+  for (auto& file : source_files) {
+    Timer timer;
+    auto code = compiler->get_goos().reader.read_from_file({file});
+    read_ms += timer.getMs();
+
+    auto name = std::filesystem::path(file).stem().string();
+    double macro_start = compiler->macro_expansion_ms();
+    timer.start();
+    auto obj_file = compiler->compile_object_file(name, code, true);
+    double file_macro_ms = compiler->macro_expansion_ms() - macro_start;
+    compile_ms += timer.getMs() - file_macro_ms;
+    macro_ms += file_macro_ms;
+
+    timer.start();
+    compiler->color_object_file(obj_file);
+    color_ms += timer.getMs();
+
+    timer.start();
+    compiler->codegen_object_file(obj_file);
+    codegen_ms += timer.getMs();
+  }
+
+  results->add("compiler/read", read_ms);
+  results->add("compiler/macro-expand", macro_ms);
+  results->add("compiler/compile", compile_ms);
+  results->add("compiler/color", color_ms);
+  results->add("compiler/codegen", codegen_ms);
+}
+
+/*!
+ * Symbolize addresses like the debugger does: find the object in the memory map, then the function
+ * in the object's debug info. There are 200 objects, each with 100 functions in the main and debug
+ * segments.
+ */
+void run_symbolize(Results* results) {
+  constexpr int object_count = 200;
+  constexpr int functions_per_object = 100;
+  constexpr u32 function_size = 0x40;
+  constexpr u32 segment_size = functions_per_object * function_size;
+  constexpr int lookup_count = 1000000;
+
+  // lay out objects back to back, like a loaded game.
+  std::unordered_map<std::string, listener::LoadEntry> loads;
+  std::unordered_map<std::string, DebugInfo> debug_info;
+  const u32 start_addr = 0x100000;
+  u32 addr = start_addr;
+  for (int obj = 0; obj < object_count; obj++) {
+    auto obj_name = fmt::format("object-{}", obj);
+    auto& le = loads[obj_name];
+    auto& di = debug_info.insert({obj_name, DebugInfo(obj_name)}).first->second;
+    for (int seg : {MAIN_SEGMENT, DEBUG_SEGMENT}) {
+      le.segments[seg] = addr;
+      le.segment_sizes[seg] = segment_size;
+      addr += segment_size;
+      for (int f = 0; f < functions_per_object; f++) {
+        auto& func = di.add_function(fmt::format("{}-seg{}-function-{}", obj_name, seg, f));
+        func.seg = seg;
+        func.offset_in_seg = f * function_size;
+        func.length = function_size;
+      }
+    }
+  }
+  listener::MemoryMap map(loads);
+
+  int found = 0;
+  FunctionDebugInfo* info = nullptr;
+  std::string name;
+  results->time("debugger/symbolize", [&]() {
+    for (int i = 0; i < lookup_count; i++) {
+      // spread the lookups over all the functions, in no particular order.
+      u32 lookup_addr = start_addr + (u32(i) * 7919u) % (addr - start_addr);
+      auto& entry = map.lookup(lookup_addr);
+      if (!entry.empty && debug_info.at(entry.obj_name)
+                              .lookup_function(&info, &name, lookup_addr - entry.start_addr,
+                                               entry.seg_id)) {
+        found++;
+      }
+    }
+  });
+
+  if (found != lookup_count) {
+    lg::error("Symbolized {} of {} addresses", found, lookup_count);
+  }
+}
+
+/*!
+ * Build a Trie of all the jak 1 symbols, like the compiler's symbol info, and look up the first 1
+ * to 4 characters of each symbol, like completing a symbol name in the REPL.
+ */
+void run_trie(Results* results) {
+  std::unique_ptr<Trie<std::string>> trie;
+  results->time("trie/insert", [&]() {
+    trie = std::make_unique<Trie<std::string>>();
+    for (auto sym : all_syms) {
+      trie->insert(sym, sym);
+    }
+  });
+  results->set_memory("trie/insert", trie->memory_usage());
+
+  size_t found = 0;
+  results->time("trie/lookup-prefix", [&]() {
+    for (auto sym : all_syms) {
+      std::string name = sym;
+      for (size_t len = 1; len <= 4 && len <= name.length(); len++) {
+        found += trie->lookup_prefix(name.substr(0, len)).size();
+      }
+    }
+  });
+
+  if (!found) {
+    lg::error("Trie prefix lookups found nothing");
+  }
+}
+
+/*!
+ * Get the results to save and compare. Stages are compared by their median time.
+ */
+std::vector<bench::Result> to_bench_results(const Results& results) {
+  std::vector<bench::Result> out;
+  for (auto& stage : results.stages()) {
+    bench::Result result;
+    result.name = stage.name;
+    result.value = stage.median_ms();
+    result.info = {{"repetitions", stage.times_ms.size()},
+                   {"min_ms", stage.min_ms()},
+                   {"median_ms", stage.median_ms()},
+                   {"max_ms", stage.max_ms()}};
+    if (stage.memory_bytes) {
+      result.info["memory_bytes"] = stage.memory_bytes;
+    }
+    out.push_back(result);
+  }
+  return out;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  options.out_file = file_util::get_file_path({"out", "pipeline-bench.json"});
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (bench::parse_option(argc, argv, &i, &options)) {
+      continue;
+    } else if (i + 1 < argc && arg == "--repetitions") {
+      options.repetitions = std::max(atoi(argv[++i]), 1);
+    } else if (i + 1 < argc && arg == "--iso-data") {
+      options.iso_data_path = argv[++i];
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+
+  nlohmann::json baseline;
+  if (!options.baseline_file.empty()) {
+    baseline = bench::read_baseline(options.baseline_file);
+  }
+
+  lg::initialize();
+  auto objects = get_reference_objects();
+  Results results;
+
+  if (options.filter.empty() || options.filter == "decompiler") {
+    file_util::init_crc();
+    decompiler::init_opcode_info();
+    decompiler::set_config(
+        file_util::get_file_path({"decompiler", "config", "jak1_ntsc_black_label.jsonc"}));
+    decompiler::get_config().allowed_objects.clear();
+    decompiler::get_config().allowed_objects.insert(objects.begin(), objects.end());
+
+    std::vector<std::string> dgo_paths;
+    bool have_dgos = true;
+    for (auto& dgo : {"KERNEL.CGO", "ENGINE.CGO"}) {
+      auto path = options.iso_data_path.empty()
+                      ? file_util::get_file_path({"iso_data", "CGO", dgo})
+                      : file_util::combine_path(options.iso_data_path, std::string("CGO/") + dgo);
+      have_dgos = have_dgos && std::filesystem::exists(path);
+      dgo_paths.push_back(path);
+    }
+
+    if (have_dgos) {
+      // the passes log a lot, and printing it would be part of the time.
+      lg::set_stdout_level(lg::level::warn);
+      for (int i = 0; i < options.repetitions; i++) {
+        run_decompiler(dgo_paths, &results);
+      }
+      lg::set_stdout_level(lg::level::info);
+    } else {
+      lg::warn("Skipping the decompiler benchmarks, couldn't find {} and {}", dgo_paths.at(0),
+               dgo_paths.at(1));
+    }
+  }
+
+  if (options.filter.empty() || options.filter == "compiler") {
+    // build everything first, so the files can be compiled on their own.
+    Compiler compiler;
+    compiler.run_front_end_on_string("(build-game)");
+    auto source_files = get_source_files(objects);
+    for (int i = 0; i < options.repetitions; i++) {
+      run_compiler(&compiler, source_files, &results);
+    }
+  }
+
+  if (options.filter.empty() || options.filter == "debugger") {
+    for (int i = 0; i < options.repetitions; i++) {
+      run_symbolize(&results);
+    }
+  }
+
+  if (options.filter.empty() || options.filter == "trie") {
+    for (int i = 0; i < options.repetitions; i++) {
+      run_trie(&results);
+    }
+  }
+
+  for (auto& stage : results.stages()) {
+    fmt::print("[pipeline-bench] {:<36} {:>10.3f} ms median, {:>10.3f} ms min", stage.name,
+               stage.median_ms(), stage.min_ms());
+    if (stage.memory_bytes) {
+      fmt::print(", {:.1f} kB", stage.memory_bytes / 1024.0);
+    }
+    fmt::print("\n");
+  }
+
+  auto bench_results = to_bench_results(results);
+  bench::write_results(options.out_file, bench::to_json("ms", bench_results));
+  fmt::print("[pipeline-bench] wrote {}\n", options.out_file);
+
+  if (!options.baseline_file.empty() &&
+      !bench::compare_to_baseline("ms", bench_results, baseline, options.max_regression)) {
+    return 1;
+  }
+  return 0;
+}
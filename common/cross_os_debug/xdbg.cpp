@@ -19,7 +19,9 @@
 #include <sys/types.h>
 #include <sys/user.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
 #include <fcntl.h>
+#include <climits>
 #elif _WIN32
 
 #endif
@@ -167,6 +169,41 @@ bool read_goal_memory(u8* dest_buffer,
   return true;
 }
 
+/*!
+ * Do many reads of target's EE memory. This uses process_vm_readv so up to IOV_MAX reads can be
+ * done in a single system call. If that fails, falls back to reading one at a time.
+ */
+bool read_goal_memory_batch(const std::vector<MemoryRead>& reads,
+                            const DebugContext& context,
+                            const MemoryHandle& mem) {
+  std::vector<iovec> local, remote;
+  size_t next = 0;
+  while (next < reads.size()) {
+    size_t first = next;
+    ssize_t expected = 0;
+    local.clear();
+    remote.clear();
+    for (; next < reads.size() && local.size() < IOV_MAX; next++) {
+      const auto& read = reads[next];
+      local.push_back({read.dest, (size_t)read.size});
+      remote.push_back({(void*)(context.base + read.goal_addr), (size_t)read.size});
+      expected += read.size;
+    }
+
+    if (process_vm_readv(context.tid.id, local.data(), local.size(), remote.data(), remote.size(),
+                         0) != expected) {
+      // it's possible that process_vm_readv isn't allowed, or that one of the reads is bad.
+      for (size_t i = first; i < next; i++) {
+        const auto& read = reads[i];
+        if (!read_goal_memory(read.dest, read.size, read.goal_addr, context, mem)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 /*!
  * Write data into target's EE memory
  */
@@ -343,6 +380,12 @@ bool read_goal_memory(u8* dest_buffer,
   return false;
 }
 
+bool read_goal_memory_batch(const std::vector<MemoryRead>& reads,
+                            const DebugContext& context,
+                            const MemoryHandle& mem) {
+  return false;
+}
+
 bool write_goal_memory(const u8* src_buffer,
                        int size,
                        u32 goal_addr,
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
 #include "common/common_types.h"
 
 #ifdef __linux
@@ -60,6 +61,15 @@ struct DebugContext {
   uint32_t s7;     //! The value of s7 (GOAL address)
 };
 
+/*!
+ * A single read from the target's EE memory, for batching many reads together.
+ */
+struct MemoryRead {
+  u8* dest = nullptr;  //! Where to put the data
+  u32 goal_addr = 0;   //! Where to read from (GOAL address)
+  int size = 0;        //! How many bytes to read
+};
+
 /*!
  * The x86-64 registers, including rip.
  */
@@ -104,6 +114,10 @@ bool read_goal_memory(u8* dest_buffer,
                       const DebugContext& context,
                       const MemoryHandle& mem);
 
+bool read_goal_memory_batch(const std::vector<MemoryRead>& reads,
+                            const DebugContext& context,
+                            const MemoryHandle& mem);
+
 bool write_goal_memory(const u8* src_buffer,
                        int size,
                        u32 goal_addr,
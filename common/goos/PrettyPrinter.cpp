@@ -8,6 +8,7 @@
 #include <stdexcept>
 #include <utility>
 #include <cstring>
+#include <deque>
 #include "PrettyPrinter.h"
 #include "Reader.h"
 #include "third-party/fmt/core.h"
@@ -49,33 +50,57 @@ struct FormToken {
 
   std::string str;
 
-  std::string toString() const {
-    std::string s;
+  /*!
+   * Width of this token when printed.
+   */
+  int length() const {
     switch (kind) {
       case TokenKind::WHITESPACE:
-        s.push_back(' ');
+      case TokenKind::OPEN_PAREN:
+      case TokenKind::DOT:
+      case TokenKind::CLOSE_PAREN:
+        return 1;
+      case TokenKind::EMPTY_PAIR:
+        return 2;
+      case TokenKind::STRING:
+      case TokenKind::SPECIAL_STRING:
+        return str.length();
+      default:
+        throw std::runtime_error("length unknown token kind");
+    }
+  }
+
+  void append_to(std::string* s) const {
+    switch (kind) {
+      case TokenKind::WHITESPACE:
+        s->push_back(' ');
         break;
       case TokenKind::STRING:
-        s.append(str);
+        s->append(str);
         break;
       case TokenKind::OPEN_PAREN:
-        s.push_back('(');
+        s->push_back('(');
         break;
       case TokenKind::DOT:
-        s.push_back('.');
+        s->push_back('.');
         break;
       case TokenKind::CLOSE_PAREN:
-        s.push_back(')');
+        s->push_back(')');
         break;
       case TokenKind::EMPTY_PAIR:
-        s.append("()");
+        s->append("()");
         break;
       case TokenKind::SPECIAL_STRING:
-        s.append(str);
+        s->append(str);
         break;
       default:
         throw std::runtime_error("toString unknown token kind");
     }
+  }
+
+  std::string toString() const {
+    std::string s;
+    append_to(&s);
     return s;
   }
 };
@@ -175,27 +200,13 @@ struct PrettyPrinterNode {
  * Container to track and cleanup all nodes after use.
  */
 struct NodePool {
-  std::vector<PrettyPrinterNode*> nodes;
-  PrettyPrinterNode* allocate(FormToken* x) {
-    auto result = new PrettyPrinterNode(x);
-    nodes.push_back(result);
-    return result;
-  }
+  std::deque<PrettyPrinterNode> nodes;
+  PrettyPrinterNode* allocate(FormToken* x) { return &nodes.emplace_back(x); }
 
-  PrettyPrinterNode* allocate() {
-    auto result = new PrettyPrinterNode;
-    nodes.push_back(result);
-    return result;
-  }
+  PrettyPrinterNode* allocate() { return &nodes.emplace_back(); }
 
   NodePool() = default;
 
-  ~NodePool() {
-    for (auto& x : nodes) {
-      delete x;
-    }
-  }
-
   // so we don't accidentally copy this.
   NodePool& operator=(const NodePool&) = delete;
   NodePool(const NodePool&) = delete;
@@ -238,7 +249,7 @@ void insertNewlineBefore(NodePool& pool, PrettyPrinterNode* node, int specialInd
 /*!
  * Break a list across multiple lines. This is how line lengths are decreased.
  * This does not compute the proper indentation and leaves the list in a bad state.
- * After this has been called, the entire selection should be reformatted with propagate_pretty
+ * After this has been called, the line should be laid out again with layoutLine
  */
 void breakList(NodePool& pool, PrettyPrinterNode* leftParen) {
   assert(!leftParen->is_line_separator);
@@ -261,89 +272,64 @@ void breakList(NodePool& pool, PrettyPrinterNode* leftParen) {
 }
 
 /*!
- * Compute proper line numbers, offsets, and indents for a list of tokens with newlines
- * Will add newlines for close parens if needed.
+ * Compute the line number, offsets, and indent for a single line, starting from the indent stack
+ * at the beginning of the line, plus the specialIndentDelta of the newline before it. The indent
+ * stack is left in the state for the start of the next line.
+ * A close paren with its open paren on an earlier line is moved to a line of its own.
+ * Sets bad if any token on the line starts past line_length.
+ * Returns the first token of the next line, or nullptr if this is the last line.
  */
-static PrettyPrinterNode* propagatePretty(NodePool& pool,
-                                          PrettyPrinterNode* list,
-                                          int line_length) {
-  // propagate line numbers
-  PrettyPrinterNode* rv = nullptr;
-  int line = list->line;
-  for (auto* n = list; n; n = n->next) {
-    if (n->is_line_separator) {
-      line++;
-    } else {
-      n->line = line;
+PrettyPrinterNode* layoutLine(NodePool& pool,
+                              PrettyPrinterNode* line_start,
+                              int line,
+                              std::vector<int>& indentStack,
+                              int line_length,
+                              bool* bad) {
+  assert(!line_start->is_line_separator);
+  *bad = false;
+  int offset = indentStack.back();
+  if (line_start->prev && line_start->prev->is_line_separator) {
+    offset += line_start->prev->specialIndentDelta;
+  }
+  line_start->lineIndent = offset;
+  for (auto* n = line_start;; n = n->next) {
+    n->line = line;
+    if (n->tok->kind == FormToken::TokenKind::CLOSE_PAREN && n->paren->line != line) {
       // add the weird newline.
-      if (n->tok->kind == FormToken::TokenKind::CLOSE_PAREN) {
-        if (n->line != n->paren->line) {
-          if (n->prev && !n->prev->is_line_separator) {
-            insertNewlineBefore(pool, n, 0);
-            line++;
-          }
-          if (n->next && !n->next->is_line_separator) {
-            insertNewlineAfter(pool, n, 0);
-          }
-        }
+      if (n != line_start) {
+        insertNewlineBefore(pool, n, 0);
+        return n;
       }
+      insertNewlineAfter(pool, n, 0);
     }
-  }
 
-  // compute offsets and indents
-  std::vector<int> indentStack;
-  indentStack.push_back(0);
-  int offset = 0;
-  PrettyPrinterNode* line_start = list;
-  bool previous_line_sep = false;
-  for (auto* n = list; n; n = n->next) {
-    if (n->is_line_separator) {
-      previous_line_sep = true;
-      offset = indentStack.back() + n->specialIndentDelta;
-    } else {
-      if (previous_line_sep) {
-        line_start = n;
-        n->lineIndent = offset;
-        previous_line_sep = false;
-      }
+    n->offset = offset;
+    offset += n->tok->length();
+    if (n->offset > line_length) {
+      *bad = true;
+    }
 
-      n->offset = offset;
-      offset += n->tok->toString().length();
-      if (offset > line_length && !rv)
-        rv = line_start;
-      if (n->tok->kind == FormToken::TokenKind::OPEN_PAREN) {
-        if (!n->prev || n->prev->is_line_separator) {
-          indentStack.push_back(offset + 1);
-        } else {
-          indentStack.push_back(offset - 1);
-        }
+    if (n->tok->kind == FormToken::TokenKind::OPEN_PAREN) {
+      if (n == line_start) {
+        indentStack.push_back(offset + 1);
+      } else {
+        indentStack.push_back(offset - 1);
       }
+    }
 
-      if (n->tok->kind == FormToken::TokenKind::CLOSE_PAREN) {
-        indentStack.pop_back();
-      }
+    if (n->tok->kind == FormToken::TokenKind::CLOSE_PAREN) {
+      indentStack.pop_back();
     }
-  }
-  return rv;
-}
 
-/*!
- * Get the token on the start of the next line. nullptr if we're the last line.
- */
-PrettyPrinterNode* getNextLine(PrettyPrinterNode* start) {
-  assert(!start->is_line_separator);
-  int line = start->line;
-  for (;;) {
-    if (start->is_line_separator || start->line == line) {
-      if (start->next)
-        start = start->next;
-      else
-        return nullptr;
-    } else {
-      break;
+    if (!n->next) {
+      return nullptr;
+    }
+
+    if (n->next->is_line_separator) {
+      assert(n->next->next);
+      return n->next->next;
     }
   }
-  return start;
 }
 
 /*!
@@ -433,86 +419,40 @@ PrettyPrinterNode* getFirstListOnLine(PrettyPrinterNode* start) {
   return nullptr;
 }
 
-/*!
- * Get the first token on the first line which exceeds the max length
- */
-PrettyPrinterNode* getFirstBadLine(PrettyPrinterNode* start, int line_length) {
-  assert(!start->is_line_separator);
-  int currentLine = start->line;
-  auto* currentLineNode = start;
-  for (;;) {
-    if (start->is_line_separator) {
-      assert(start->next);
-      start = start->next;
-    } else {
-      if (start->line != currentLine) {
-        currentLine = start->line;
-        currentLineNode = start;
-      }
-      if (start->offset > line_length) {
-        return currentLineNode;
-      }
-      if (!start->next) {
-        return nullptr;
-      }
-      start = start->next;
-    }
-  }
-}
-
 /*!
  * Break insertion algorithm.
+ * Lines are laid out in a single pass from the top. Breaking a list on a line can only change that
+ * line and the ones after it, so once a line fits (or can't be fixed) it is never revisited. A line
+ * that is too long has the lists on it broken, first to last, until it fits.
  */
 void insertBreaksAsNeeded(NodePool& pool, PrettyPrinterNode* head, int line_length) {
-  PrettyPrinterNode* last_line_complete = nullptr;
-  PrettyPrinterNode* line_to_start_line_search = head;
-
-  // loop over lines
-  for (;;) {
-    // compute lines as needed
-    propagatePretty(pool, head, line_length);
-
-    // search for a bad line starting at the last line we fixed
-    PrettyPrinterNode* candidate_line = getFirstBadLine(line_to_start_line_search, line_length);
-    // if we got the same line we started on, this means we couldn't fix it.
-    if (candidate_line == last_line_complete) {
-      candidate_line = nullptr;  // so we say our candidate was bad and try to find another
-      PrettyPrinterNode* next_line = getNextLine(line_to_start_line_search);
-      if (next_line) {
-        candidate_line = getFirstBadLine(next_line, line_length);
-      }
-    }
-    if (!candidate_line)
-      break;
-
-    // okay, we have a line which needs fixing.
-    assert(!candidate_line->prev || candidate_line->prev->is_line_separator);
-    PrettyPrinterNode* form_to_start = getFirstListOnLine(candidate_line);
-    for (;;) {
-      if (!form_to_start) {
-        // this means we failed to hit the desired line length...
-        break;
-      }
-      breakList(pool, form_to_start);
-      propagatePretty(pool, head, line_length);
-      if (getFirstBadLine(candidate_line, line_length) != candidate_line) {
-        break;
+  std::vector<int> indentStack = {0};
+  std::vector<int> lineStartIndentStack;
+  int line = 0;
+  for (PrettyPrinterNode* line_start = head; line_start; line++) {
+    lineStartIndentStack = indentStack;
+    bool bad = false;
+    auto* next_line = layoutLine(pool, line_start, line, indentStack, line_length, &bad);
+
+    if (bad) {
+      for (auto* form = getFirstListOnLine(line_start); form; form = getNextListOnLine(form)) {
+        breakList(pool, form);
+        indentStack = lineStartIndentStack;
+        next_line = layoutLine(pool, line_start, line, indentStack, line_length, &bad);
+        if (!bad) {
+          break;
+        }
       }
-
-      form_to_start = getNextListOnLine(form_to_start);
-      if (!form_to_start)
-        break;
     }
 
-    last_line_complete = candidate_line;
-    line_to_start_line_search = candidate_line;
+    line_start = next_line;
   }
 }
 
 /*!
  * Break a list across multiple lines. This is how line lengths are decreased.
  * This does not compute the proper indentation and leaves the list in a bad state.
- * After this has been called, the entire selection should be reformatted with propagate_pretty
+ * After this has been called, the line should be laid out again with layoutLine
  */
 void breakList(NodePool& pool, PrettyPrinterNode* leftParen, PrettyPrinterNode* first_elt) {
   assert(!leftParen->is_line_separator);
@@ -699,14 +639,14 @@ std::string to_string(const goos::Object& obj, int line_length) {
   head->line = 0;
   head->offset = 0;
   head->lineIndent = 0;
-  int offset = head->tok->toString().length();
+  int offset = head->tok->length();
   for (size_t i = 1; i < tokens.size(); i++) {
     node->next = pool.allocate(&tokens[i]);
     node->next->prev = node;
     node = node->next;
     node->line = 0;
     node->offset = offset;
-    offset += node->tok->toString().length();
+    offset += node->tok->length();
     node->lineIndent = 0;
   }
 
@@ -728,7 +668,6 @@ std::string to_string(const goos::Object& obj, int line_length) {
   assert(!parenStack.back());
 
   insertSpecialBreaks(pool, head);
-  propagatePretty(pool, head, line_length);
   insertBreaksAsNeeded(pool, head, line_length);
 
   // write to string
@@ -744,7 +683,7 @@ std::string to_string(const goos::Object& obj, int line_length) {
         if (n->tok->kind == FormToken::TokenKind::WHITESPACE)
           continue;
       }
-      pretty.append(n->tok->toString());
+      n->tok->append_to(&pretty);
     }
   }
 
@@ -8,15 +8,16 @@
 #ifndef JAK1_LISTENER_COMMON_H
 #define JAK1_LISTENER_COMMON_H
 
+#include <vector>
 #include "common/common_types.h"
 
 /*!
  * Header of a DECI2 protocol message
- * TODO - there are other copies of this somewhere
+ * Unlike the real DECI2 header, the length is 32-bits (we took the reserved field) so a single
+ * message can be larger than 64 kB.
  */
 struct Deci2Header {
-  u16 len;    //! size of data following header
-  u16 rsvd;   //! zero, used internally by runtime.
+  u32 len;    //! size of the message, including this header
   u16 proto;  //! protocol identification number
   u8 src;     //! identification code of sender
   u8 dst;     //! identification code of recipient
@@ -65,4 +66,26 @@ constexpr int DECI2_PORT = 8112;  // TODO - is this a good choice?
 
 constexpr u16 DECI2_PROTOCOL = 0xe042;
 
+/*!
+ * Version of the listener protocol, sent by the target after the GOAL version on connect.
+ * 1: original DECI2 framing with 16-bit lengths, one message at a time.
+ * 2: 32-bit lengths, large messages are streamed in chunks, several messages may be in flight.
+ */
+constexpr u32 LISTENER_PROTOCOL_VERSION = 2;
+
+/*!
+ * Size of the target's buffer for incoming listener messages, including the header.
+ */
+constexpr u32 DEBUG_MESSAGE_BUFFER_SIZE = 0x80000;
+
+/*!
+ * A call stack recorded by the runtime's profiler, and how many times it was seen.
+ * Frames are GOAL addresses, innermost first. The first frame is the sampled instruction, or 0 if
+ * it wasn't in GOAL code, and the rest are return addresses found on the stack.
+ */
+struct ProfileStack {
+  u32 count = 0;
+  std::vector<u32> frames;
+};
+
 #endif  // JAK1_LISTENER_COMMON_H
@@ -3,34 +3,40 @@
 /*!
  * @file BinaryReader.h
  * Read raw data like a stream.
+ * The reader does not own or copy the data, so the data must outlive the reader.
  */
 
 #include <cstdint>
 #include <cassert>
+#include <cstring>
 #include <vector>
 
 class BinaryReader {
  public:
-  explicit BinaryReader(const std::vector<uint8_t>& _buffer) : buffer(_buffer) {}
+  explicit BinaryReader(const std::vector<uint8_t>& _buffer)
+      : buffer(_buffer.data()), size(_buffer.size()) {}
+  BinaryReader(const uint8_t* _buffer, uint32_t _size) : buffer(_buffer), size(_size) {}
 
   template <typename T>
   T read() {
-    assert(seek + sizeof(T) <= buffer.size());
-    T& obj = *(T*)(buffer.data() + seek);
+    assert(seek + sizeof(T) <= size);
+    T obj;
+    memcpy(&obj, buffer + seek, sizeof(T));
     seek += sizeof(T);
     return obj;
   }
 
   void ffwd(int amount) {
     seek += amount;
-    assert(seek <= buffer.size());
+    assert(seek <= size);
   }
 
-  uint32_t bytes_left() const { return buffer.size() - seek; }
-  uint8_t* here() { return buffer.data() + seek; }
+  uint32_t bytes_left() const { return size - seek; }
+  const uint8_t* here() const { return buffer + seek; }
   uint32_t get_seek() const { return seek; }
 
  private:
-  std::vector<u8> buffer;
+  const uint8_t* buffer = nullptr;
+  uint32_t size = 0;
   uint32_t seek = 0;
 };
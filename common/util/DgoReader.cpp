@@ -7,12 +7,39 @@
 #include "third-party/json.hpp"
 #include "dgo_util.h"
 
-DgoReader::DgoReader(std::string file_name, const std::vector<u8>& data)
+/*!
+ * Read a DGO from memory. The data must be uncompressed and must outlive the reader.
+ */
+DgoReader::DgoReader(std::string file_name, const u8* data, size_t size)
     : m_file_name(std::move(file_name)) {
-  BinaryReader reader(data);
+  read_entries(data, size);
+}
+
+DgoReader::DgoReader(std::string file_name, const std::vector<u8>& data)
+    : DgoReader(std::move(file_name), data.data(), data.size()) {}
+
+/*!
+ * Read a DGO from a file. Uncompressed DGOs are memory mapped and used in place, compressed DGOs
+ * are decompressed.
+ */
+DgoReader::DgoReader(const std::string& file_path) : m_file_name(file_util::base_name(file_path)) {
+  m_mapped_file = std::make_unique<file_util::MappedFile>(file_path);
+  if (file_util::dgo_header_is_compressed(m_mapped_file->data(), m_mapped_file->size())) {
+    m_decompressed = file_util::decompress_dgo(m_mapped_file->data(), m_mapped_file->size());
+    m_mapped_file.reset();
+    read_entries(m_decompressed.data(), m_decompressed.size());
+  } else {
+    read_entries(m_mapped_file->data(), m_mapped_file->size());
+  }
+}
+
+void DgoReader::read_entries(const u8* data, size_t size) {
+  BinaryReader reader(data, size);
   auto header = reader.read<DgoHeader>();
+  assert_string_empty_after(header.name, 60);
   m_internal_name = header.name;
   std::unordered_set<std::string> all_unique_names;
+  m_entries.reserve(header.object_count);
 
   // get all obj files...
   for (uint32_t i = 0; i < header.object_count; i++) {
@@ -23,7 +50,8 @@ DgoReader::DgoReader(std::string file_name, const std::vector<u8>& data)
     DgoDataEntry entry;
     entry.internal_name = obj_header.name;
 
-    entry.unique_name = get_object_file_name(entry.internal_name, reader.here(), obj_header.size);
+    entry.object_name = get_object_file_name(entry.internal_name, reader.here(), obj_header.size);
+    entry.unique_name = entry.object_name;
     if (all_unique_names.find(entry.unique_name) != all_unique_names.end()) {
       printf("Warning: there are multiple files named %s\n", entry.unique_name.c_str());
       entry.unique_name += '-';
@@ -31,11 +59,11 @@ DgoReader::DgoReader(std::string file_name, const std::vector<u8>& data)
     }
 
     all_unique_names.insert(entry.unique_name);
-    entry.data.resize(obj_header.size);
 
     assert((reader.get_seek() % 16) == 0);
-    memcpy(entry.data.data(), reader.here(), obj_header.size);
-    m_entries.push_back(entry);
+    entry.data = reader.here();
+    entry.size = obj_header.size;
+    m_entries.push_back(std::move(entry));
 
     reader.ffwd(obj_header.size);
   }
@@ -58,4 +86,4 @@ std::string DgoReader::description_as_json() const {
   }
 
   return j.dump(4);
-}
\ No newline at end of file
+}
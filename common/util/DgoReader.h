@@ -2,21 +2,43 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include "common/common_types.h"
+#include "common/util/FileUtil.h"
 
+/*!
+ * An object file inside of a DGO. The data is not copied out of the DGO, so it is only valid for
+ * as long as the DgoReader (and the data the DgoReader was created from) is alive.
+ */
 struct DgoDataEntry {
-  std::vector<u8> data;
-  std::string internal_name;
-  std::string unique_name;
+  const u8* data = nullptr;
+  u32 size = 0;
+  std::string internal_name;  // name in the DGO header
+  std::string object_name;    // internal name, with -ag added for art groups
+  std::string unique_name;    // object name, made unique if the DGO has duplicates
+
+  std::vector<u8> copy() const { return std::vector<u8>(data, data + size); }
 };
 
 class DgoReader {
  public:
+  DgoReader(std::string file_name, const u8* data, size_t size);
   DgoReader(std::string file_name, const std::vector<u8>& data);
-  const std::vector<DgoDataEntry> entries() const { return m_entries; }
+  explicit DgoReader(const std::string& file_path);
+  DgoReader(const DgoReader&) = delete;
+  DgoReader& operator=(const DgoReader&) = delete;
+
+  const std::vector<DgoDataEntry>& entries() const { return m_entries; }
+  const std::string& internal_name() const { return m_internal_name; }
   std::string description_as_json() const;
 
  private:
+  void read_entries(const u8* data, size_t size);
+
   std::vector<DgoDataEntry> m_entries;
   std::string m_internal_name, m_file_name;
-};
\ No newline at end of file
+
+  // storage for DGOs read from files.
+  std::unique_ptr<file_util::MappedFile> m_mapped_file;
+  std::vector<u8> m_decompressed;
+};
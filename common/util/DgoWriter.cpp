@@ -29,5 +29,11 @@ void build_dgo(const DgoDescription& description) {
   }
 
   file_util::create_dir_if_needed(file_util::get_file_path({"out", "iso"}));
-  writer.write_to_file(file_util::get_file_path({"out", "iso", description.dgo_name}));
+  auto out_name = file_util::get_file_path({"out", "iso", description.dgo_name});
+  if (description.compress) {
+    auto compressed = file_util::compress_dgo((const u8*)writer.get_data(), writer.get_size());
+    file_util::write_binary_file(out_name, compressed.data(), compressed.size());
+  } else {
+    writer.write_to_file(out_name);
+  }
 }
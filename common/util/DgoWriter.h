@@ -5,6 +5,7 @@
  * Create a DGO from existing files.
  */
 
+#include <string>
 #include <vector>
 
 struct DgoDescription {
@@ -14,6 +15,8 @@ struct DgoDescription {
     std::string name_in_dgo;
   };
   std::vector<DgoEntry> entries;
+  // write a compressed (chunked oZlB) DGO. lzokay only has a single compression level.
+  bool compress = false;
 };
 
 void build_dgo(const DgoDescription& description);
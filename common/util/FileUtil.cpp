@@ -11,6 +11,10 @@
 #include <sstream>
 #include <cassert>
 #include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <thread>
 #include "common/util/BinaryReader.h"
 #include "BinaryWriter.h"
 #include "common/common_types.h"
@@ -22,6 +26,9 @@
 #else
 #include <unistd.h>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 namespace file_util {
@@ -118,6 +125,43 @@ void write_text_file(const std::string& file_name, const std::string& text) {
   fclose(fp);
 }
 
+/*!
+ * Write a text file like write_text_file, but leave the file untouched if it already holds exactly
+ * what would be written. This keeps the timestamps of unchanged files, so tools watching the output
+ * don't see changes. Returns true if the file was written.
+ */
+bool write_text_file_if_changed(const std::string& file_name, const std::string& text) {
+  FILE* fp = fopen(file_name.c_str(), "r");
+  if (fp) {
+    // write_text_file prints text as a C string, followed by a newline.
+    size_t text_size = std::min(text.find('\0'), text.size());
+    std::vector<char> buffer(1 << 16);
+    size_t pos = 0;
+    bool match = true;
+    for (;;) {
+      size_t n = fread(buffer.data(), 1, buffer.size(), fp);
+      if (n == 0) {
+        break;
+      }
+      size_t from_text = pos < text_size ? std::min(n, text_size - pos) : 0;
+      if (memcmp(buffer.data(), text.data() + pos, from_text) != 0 ||
+          (from_text < n &&
+           (n - from_text != 1 || buffer[from_text] != '\n' || pos + from_text != text_size))) {
+        match = false;
+        break;
+      }
+      pos += n;
+    }
+    fclose(fp);
+    if (match && pos == text_size + 1) {
+      return false;
+    }
+  }
+
+  write_text_file(file_name, text);
+  return true;
+}
+
 std::vector<uint8_t> read_binary_file(const std::string& filename) {
   auto fp = fopen(filename.c_str(), "rb");
   if (!fp)
@@ -138,6 +182,43 @@ std::vector<uint8_t> read_binary_file(const std::string& filename) {
   return data;
 }
 
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+  m_fallback = read_binary_file(filename);
+  m_data = m_fallback.data();
+  m_size = m_fallback.size();
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("File " + filename +
+                             " cannot be opened: " + std::string(strerror(errno)));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("File " + filename + " cannot be read");
+  }
+  m_size = st.st_size;
+  if (m_size) {
+    void* mem = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mem == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("File " + filename + " cannot be mapped");
+    }
+    m_data = (const u8*)mem;
+  }
+  close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (m_data) {
+    munmap(const_cast<u8*>(m_data), m_size);
+  }
+#endif
+}
+
 std::string read_text_file(const std::string& path) {
   std::ifstream file(path);
   if (!file.good()) {
@@ -329,63 +410,246 @@ void assert_file_exists(const char* path, const char* error_message) {
   }
 }
 
+namespace {
+constexpr int MAX_CHUNK_SIZE = 0x8000;
+constexpr char COMPRESSED_DGO_MAGIC[] = "oZlB";
+}  // namespace
+
 /*!
  * Check if the given DGO header (or entire file) is compressed.
  */
 bool dgo_header_is_compressed(const std::vector<u8>& data) {
-  const char compressed_header[] = "oZlB";
-  bool is_compressed = true;
-  for (int i = 0; i < 4; i++) {
-    if (compressed_header[i] != data.at(i)) {
-      is_compressed = false;
+  return dgo_header_is_compressed(data.data(), data.size());
+}
+
+bool dgo_header_is_compressed(const u8* data, size_t size) {
+  return size >= 4 && !memcmp(data, COMPRESSED_DGO_MAGIC, 4);
+}
+
+namespace {
+/*!
+ * Decompress a single chunk of a compressed DGO to dst, which has room for exactly the expected
+ * output of the chunk. Returns false if the chunk doesn't decompress to the expected size.
+ */
+bool decompress_dgo_chunk(const DgoChunk& chunk, const u8* src, u8* dst) {
+  if (chunk.compressed) {
+    std::size_t bytes_written = 0;
+    lzokay::EResult ok =
+        lzokay::decompress(src, chunk.in_size, dst, chunk.out_size, bytes_written);
+    return ok == lzokay::EResult::Success && bytes_written == chunk.out_size;
+  } else {
+    memcpy(dst, src, chunk.out_size);
+    return true;
+  }
+}
+
+/*!
+ * Figure out the chunk that starts with the given chunk size word.
+ */
+DgoChunk make_dgo_chunk(u32 chunk_size, size_t in_offset, size_t out_offset, size_t total_size) {
+  DgoChunk chunk;
+  chunk.in_offset = in_offset;
+  chunk.out_offset = out_offset;
+  chunk.out_size = std::min(size_t(MAX_CHUNK_SIZE), total_size - out_offset);
+  // sometimes chunk_size is bigger than MAX, but we should still use max.
+  chunk.compressed = chunk_size < MAX_CHUNK_SIZE;
+  chunk.in_size = chunk.compressed ? chunk_size : MAX_CHUNK_SIZE;
+  return chunk;
+}
+}  // namespace
+
+/*!
+ * Find all the chunks in a compressed DGO. This assumes that every chunk except the last
+ * decompresses to exactly MAX_CHUNK_SIZE bytes, so the output offsets are known without
+ * decompressing anything. This is true for the game's DGOs. decompress_dgo checks it.
+ */
+std::vector<DgoChunk> scan_dgo_chunks(const u8* data_in, size_t size_in) {
+  if (size_in < 8) {
+    throw std::runtime_error("Compressed DGO is too small");
+  }
+  size_t decompressed_size = *(const u32*)(data_in + 4);
+  size_t seek = 8;  // past oZlB and size
+  size_t output_offset = 0;
+  std::vector<DgoChunk> chunks;
+  chunks.reserve(decompressed_size / MAX_CHUNK_SIZE + 1);
+
+  while (output_offset < decompressed_size) {
+    // seek past alignment bytes and read the next chunk size
+    u32 chunk_size = 0;
+    while (!chunk_size) {
+      if (seek + 4 > size_in) {
+        throw std::runtime_error("Compressed DGO ends before all chunks were found");
+      }
+      memcpy(&chunk_size, data_in + seek, 4);
+      seek += 4;
+    }
+
+    chunks.push_back(make_dgo_chunk(chunk_size, seek, output_offset, decompressed_size));
+    seek += chunks.back().in_size;
+    if (seek > size_in) {
+      throw std::runtime_error("Compressed DGO chunk is past the end of the file");
+    }
+    output_offset += chunks.back().out_size;
+
+    while (seek % 4) {
+      seek++;
     }
   }
-  return is_compressed;
+
+  return chunks;
 }
 
+std::vector<DgoChunk> scan_dgo_chunks(const std::vector<u8>& data_in) {
+  return scan_dgo_chunks(data_in.data(), data_in.size());
+}
+
+namespace {
 /*!
- * Decompress a DGO. Resulting data will start at the DGO header.
+ * Decompress a DGO one chunk at a time, moving forward by the size each chunk actually
+ * decompressed to. This is slower, but also works if some chunks are smaller than MAX_CHUNK_SIZE.
  */
-std::vector<u8> decompress_dgo(const std::vector<u8>& data_in) {
-  constexpr int MAX_CHUNK_SIZE = 0x8000;
-  BinaryReader compressed_reader(data_in);
-  // seek past oZlB
-  compressed_reader.ffwd(4);
-  std::size_t decompressed_size = compressed_reader.read<uint32_t>();
-  std::vector<uint8_t> decompressed_data;
-  decompressed_data.resize(decompressed_size);
+std::vector<u8> decompress_dgo_serial(const u8* data_in, size_t size_in) {
+  size_t decompressed_size = *(const u32*)(data_in + 4);
+  std::vector<u8> decompressed_data(decompressed_size);
+  size_t seek = 8;  // past oZlB and size
   size_t output_offset = 0;
-  while (true) {
+
+  while (output_offset < decompressed_size) {
     // seek past alignment bytes and read the next chunk size
-    uint32_t chunk_size = 0;
+    u32 chunk_size = 0;
     while (!chunk_size) {
-      chunk_size = compressed_reader.read<uint32_t>();
+      if (seek + 4 > size_in) {
+        throw std::runtime_error("Compressed DGO ends before all chunks were found");
+      }
+      memcpy(&chunk_size, data_in + seek, 4);
+      seek += 4;
     }
 
-    if (chunk_size < MAX_CHUNK_SIZE) {
-      std::size_t bytes_written = 0;
-      lzokay::EResult ok = lzokay::decompress(
-          compressed_reader.here(), chunk_size, decompressed_data.data() + output_offset,
-          decompressed_data.size() - output_offset, bytes_written);
-      assert(ok == lzokay::EResult::Success);
-      compressed_reader.ffwd(chunk_size);
-      output_offset += bytes_written;
+    auto chunk = make_dgo_chunk(chunk_size, seek, output_offset, decompressed_size);
+    if (seek + chunk.in_size > size_in) {
+      throw std::runtime_error("Compressed DGO chunk is past the end of the file");
+    }
+    size_t bytes_written = chunk.out_size;
+    if (chunk.compressed) {
+      lzokay::EResult ok =
+          lzokay::decompress(data_in + seek, chunk.in_size, decompressed_data.data() + output_offset,
+                             decompressed_size - output_offset, bytes_written);
+      if (ok != lzokay::EResult::Success || !bytes_written) {
+        throw std::runtime_error("Failed to decompress a DGO chunk");
+      }
     } else {
-      // nope - sometimes chunk_size is bigger than MAX, but we should still use max.
-      //        assert(chunk_size == MAX_CHUNK_SIZE);
-      memcpy(decompressed_data.data() + output_offset, compressed_reader.here(), MAX_CHUNK_SIZE);
-      compressed_reader.ffwd(MAX_CHUNK_SIZE);
-      output_offset += MAX_CHUNK_SIZE;
+      memcpy(decompressed_data.data() + output_offset, data_in + seek, chunk.out_size);
     }
+    seek += chunk.in_size;
+    output_offset += bytes_written;
 
-    if (output_offset >= decompressed_size)
-      break;
-    while (compressed_reader.get_seek() % 4) {
-      compressed_reader.ffwd(1);
+    while (seek % 4) {
+      seek++;
+    }
+  }
+
+  return decompressed_data;
+}
+}  // namespace
+
+/*!
+ * Decompress a DGO. Resulting data will start at the DGO header.
+ * The chunks are independent, so they are decompressed in parallel.
+ * Throws std::runtime_error if the DGO is malformed.
+ */
+std::vector<u8> decompress_dgo(const u8* data_in, size_t size_in) {
+  auto chunks = scan_dgo_chunks(data_in, size_in);
+  std::vector<u8> decompressed_data(*(const u32*)(data_in + 4));
+
+  std::atomic<size_t> next_chunk = {0};
+  std::atomic<bool> failed = {false};
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next_chunk.fetch_add(1)) < chunks.size()) {
+      auto& chunk = chunks[i];
+      if (!decompress_dgo_chunk(chunk, data_in + chunk.in_offset,
+                                decompressed_data.data() + chunk.out_offset)) {
+        failed = true;
+      }
     }
+  };
+
+  // don't bother with threads for tiny files.
+  size_t thread_count = std::min<size_t>(std::thread::hardware_concurrency(), chunks.size() / 4);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
   }
 
+  if (failed) {
+    // a chunk didn't decompress to the size scan_dgo_chunks expected. This happens if there are
+    // chunks smaller than MAX_CHUNK_SIZE, so try again without assuming the chunk sizes.
+    return decompress_dgo_serial(data_in, size_in);
+  }
   return decompressed_data;
 }
 
+std::vector<u8> decompress_dgo(const std::vector<u8>& data_in) {
+  return decompress_dgo(data_in.data(), data_in.size());
+}
+
+/*!
+ * Compress a DGO to the chunked oZlB format. The data is split into MAX_CHUNK_SIZE chunks which
+ * are compressed in parallel. Chunks that don't get smaller are stored uncompressed.
+ */
+std::vector<u8> compress_dgo(const u8* data_in, size_t size_in) {
+  size_t chunk_count = (size_in + MAX_CHUNK_SIZE - 1) / MAX_CHUNK_SIZE;
+  std::vector<std::vector<u8>> compressed_chunks(chunk_count);
+
+  std::atomic<size_t> next_chunk = {0};
+  auto worker = [&]() {
+    lzokay::Dict<> dict;
+    size_t i;
+    while ((i = next_chunk.fetch_add(1)) < chunk_count) {
+      size_t offset = i * MAX_CHUNK_SIZE;
+      size_t size = std::min(size_t(MAX_CHUNK_SIZE), size_in - offset);
+      auto& out = compressed_chunks[i];
+      out.resize(lzokay::compress_worst_size(size));
+      std::size_t compressed_size = 0;
+      lzokay::EResult ok = lzokay::compress(data_in + offset, size, out.data(), out.size(),
+                                            compressed_size, dict);
+      if (ok != lzokay::EResult::Success || compressed_size >= MAX_CHUNK_SIZE) {
+        // store it. Stored chunks are always MAX_CHUNK_SIZE, so pad the last one.
+        out.assign(data_in + offset, data_in + offset + size);
+        out.resize(MAX_CHUNK_SIZE);
+      } else {
+        out.resize(compressed_size);
+      }
+    }
+  };
+
+  size_t thread_count = std::min<size_t>(std::thread::hardware_concurrency(), chunk_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  BinaryWriter writer;
+  writer.add_cstr_len(COMPRESSED_DGO_MAGIC, 4);
+  writer.add<u32>(size_in);
+  for (auto& chunk : compressed_chunks) {
+    writer.add<u32>(chunk.size());
+    writer.add_data(chunk.data(), chunk.size());
+    while (writer.get_size() & 3) {
+      writer.add<u8>(0);
+    }
+  }
+
+  auto result = (const u8*)writer.get_data();
+  return std::vector<u8>(result, result + writer.get_size());
+}
+
 }  // namespace file_util
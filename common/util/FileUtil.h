@@ -11,6 +11,19 @@
 #include "common/common_types.h"
 
 namespace file_util {
+
+/*!
+ * A single chunk of a compressed (oZlB) DGO. Chunks are independent and can be decompressed in
+ * any order.
+ */
+struct DgoChunk {
+  size_t in_offset = 0;    // offset of the chunk data in the compressed file
+  size_t in_size = 0;      // size of the chunk data in the compressed file
+  size_t out_offset = 0;   // offset in the decompressed data
+  size_t out_size = 0;     // size of the decompressed data
+  bool compressed = true;  // false if the chunk is stored as-is
+};
+
 std::filesystem::path get_user_home_dir();
 std::string get_project_path();
 std::string get_file_path(const std::vector<std::string>& input);
@@ -18,7 +31,29 @@ bool create_dir_if_needed(const std::string& path);
 void write_binary_file(const std::string& name, const void* data, size_t size);
 void write_rgba_png(const std::string& name, void* data, int w, int h);
 void write_text_file(const std::string& file_name, const std::string& text);
+bool write_text_file_if_changed(const std::string& file_name, const std::string& text);
 std::vector<uint8_t> read_binary_file(const std::string& filename);
+
+/*!
+ * A read-only view of an entire file. The file is memory mapped where supported, and read into
+ * memory otherwise.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const u8* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  const u8* m_data = nullptr;
+  size_t m_size = 0;
+  std::vector<u8> m_fallback;
+};
+
 std::string read_text_file(const std::string& path);
 bool is_printable_char(char c);
 std::string combine_path(const std::string& parent, const std::string& child);
@@ -30,5 +65,10 @@ void MakeISOName(char* dst, const char* src);
 void ISONameFromAnimationName(char* dst, const char* src);
 void assert_file_exists(const char* path, const char* error_message);
 bool dgo_header_is_compressed(const std::vector<u8>& data);
+bool dgo_header_is_compressed(const u8* data, size_t size);
+std::vector<DgoChunk> scan_dgo_chunks(const std::vector<u8>& data_in);
+std::vector<DgoChunk> scan_dgo_chunks(const u8* data_in, size_t size_in);
 std::vector<u8> decompress_dgo(const std::vector<u8>& data_in);
+std::vector<u8> decompress_dgo(const u8* data_in, size_t size_in);
+std::vector<u8> compress_dgo(const u8* data_in, size_t size_in);
 }  // namespace file_util
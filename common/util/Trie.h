@@ -1,6 +1,7 @@
 #pragma once
 
-#include <cassert>
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -12,6 +13,9 @@
  * Doing an insert will create a copy of your object.
  *
  * Other that deleting the whole thing, there is no support for removing a node.
+ *
+ * This is a radix tree: chains of nodes with a single child are merged into one node with a
+ * longer prefix, and each node only stores the children it has, sorted by first character.
  */
 template <typename T>
 class Trie {
@@ -34,152 +38,138 @@ class Trie {
 
   // Get all objects starting with the given prefix.
   std::vector<T*> lookup_prefix(const std::string& str);
-  ~Trie();
 
- private:
-  static constexpr int CHAR_START = ' ';
-  static constexpr int CHAR_END = '~' + 1;
-  static constexpr int CHAR_SIZE = CHAR_END - CHAR_START;
-
-  static int idx(char c) {
-    assert(c >= CHAR_START);
-    assert(c < CHAR_END);
-    return c - CHAR_START;
-  }
+  // Approximate memory used by the tree, not including the objects themselves.
+  size_t memory_usage() const { return sizeof(Trie) + m_root.memory_usage(); }
 
+ private:
   struct Node {
-    T* value = nullptr;
-    Node* children[CHAR_SIZE] = {0};
-
-    void delete_children() {
-      if (value) {
-        delete value;
-        value = nullptr;
-      }
-      for (auto child : children) {
-        if (child) {
-          child->delete_children();
-          delete child;
-          child = nullptr;
-        }
-      }
-    }
+    std::string prefix;  // characters between the parent and this node
+    std::unique_ptr<T> value;
+    std::vector<Node> children;  // sorted by the first character of their prefix
 
     /*!
-     * Return true if a new object was inserted.
+     * Find the child starting with c, or where it should be inserted.
      */
-    bool insert(const char* str, const T* obj) {
-      if (!*str) {
-        // we are the child!
-        if (value) {
-          delete value;
-          value = new T(*obj);
-          return false;  // didn't change the count.
-        } else {
-          value = new T(*obj);
-          return true;  // did change the count
-        }
-
-      } else {
-        // still more to go
-        char first = *str;
-        if (!children[idx(first)]) {
-          children[idx(first)] = new Node();
-        }
-        return children[idx(first)]->insert(str + 1, obj);
-      }
-    }
-
-    T* bracket_operator(const char* str, bool* inserted) {
-      if (!*str) {
-        // we are the child!
-        if (!value) {
-          value = new T();
-          *inserted = true;
-        } else {
-          *inserted = false;
-        }
-
-        return value;
-      } else {
-        // still more to go
-        char first = *str;
-        if (!children[idx(first)]) {
-          children[idx(first)] = new Node();
-        }
-        return children[idx(first)]->bracket_operator(str + 1, inserted);
-      }
-    }
-
-    T* lookup(const char* str) {
-      if (!*str) {
-        return value;
-      }
-      if (children[idx(*str)]) {
-        return children[idx(*str)]->lookup(str + 1);
-      }
-      return nullptr;
+    typename std::vector<Node>::iterator find_child(char c) {
+      return std::lower_bound(children.begin(), children.end(), c,
+                              [](const Node& n, char x) { return n.prefix.front() < x; });
     }
 
     void get_all_children(std::vector<T*>& result) {
       if (value) {
-        result.push_back(value);
+        result.push_back(value.get());
       }
-      for (auto child : children) {
-        if (child) {
-          child->get_all_children(result);
-        }
+      for (auto& child : children) {
+        child.get_all_children(result);
       }
     }
 
-    std::vector<T*> lookup_prefix(const char* str) {
-      if (!*str) {
-        std::vector<T*> result;
-        get_all_children(result);
-        return result;
-      } else {
-        if (children[idx(*str)]) {
-          return children[idx(*str)]->lookup_prefix(str + 1);
-        } else {
-          return {};
-        }
+    size_t memory_usage() const {
+      size_t result = children.capacity() * sizeof(Node);
+      if (prefix.capacity() > std::string().capacity()) {
+        result += prefix.capacity() + 1;  // not stored inline
+      }
+      for (auto& child : children) {
+        result += child.memory_usage();
       }
+      return result;
     }
   };
 
+  Node* find_node(const std::string& str, bool create);
+
   Node m_root;
   int m_size = 0;
 };
 
+/*!
+ * Find the node for the given string. If create is set, adds nodes as needed, otherwise returns
+ * nullptr if it doesn't exist.
+ */
 template <typename T>
-Trie<T>::~Trie<T>() {
-  m_root.delete_children();
-  m_size = 0;
+typename Trie<T>::Node* Trie<T>::find_node(const std::string& str, bool create) {
+  Node* node = &m_root;
+  size_t pos = 0;
+  while (pos < str.length()) {
+    auto child = node->find_child(str[pos]);
+    if (child == node->children.end() || child->prefix.front() != str[pos]) {
+      if (!create) {
+        return nullptr;
+      }
+      Node new_node;
+      new_node.prefix = str.substr(pos);
+      return &*node->children.insert(child, std::move(new_node));
+    }
+
+    // how much of the child's prefix matches?
+    size_t match = 1;
+    while (match < child->prefix.length() && pos + match < str.length() &&
+           child->prefix[match] == str[pos + match]) {
+      match++;
+    }
+
+    if (match < child->prefix.length()) {
+      if (!create) {
+        return nullptr;
+      }
+      // split the child, so there's a node at the end of the match.
+      Node split;
+      split.prefix = child->prefix.substr(0, match);
+      child->prefix.erase(0, match);
+      split.children.push_back(std::move(*child));
+      *child = std::move(split);
+    }
+
+    node = &*child;
+    pos += match;
+  }
+  return node;
 }
 
 template <typename T>
 void Trie<T>::insert(const std::string& str, const T& obj) {
-  if (m_root.insert(str.c_str(), &obj)) {
+  auto node = find_node(str, true);
+  if (!node->value) {
     m_size++;
   }
+  node->value = std::make_unique<T>(obj);
 }
 
 template <typename T>
 T* Trie<T>::lookup(const std::string& str) {
-  return m_root.lookup(str.c_str());
+  auto node = find_node(str, false);
+  return node ? node->value.get() : nullptr;
 }
 
 template <typename T>
 T* Trie<T>::operator[](const std::string& str) {
-  bool added = false;
-  auto result = m_root.bracket_operator(str.c_str(), &added);
-  if (added) {
+  auto node = find_node(str, true);
+  if (!node->value) {
+    node->value = std::make_unique<T>();
     m_size++;
   }
-  return result;
+  return node->value.get();
 }
 
 template <typename T>
 std::vector<T*> Trie<T>::lookup_prefix(const std::string& str) {
-  return m_root.lookup_prefix(str.c_str());
-}
\ No newline at end of file
+  std::vector<T*> result;
+  Node* node = &m_root;
+  size_t pos = 0;
+  while (pos < str.length()) {
+    auto child = node->find_child(str[pos]);
+    if (child == node->children.end() || child->prefix.front() != str[pos]) {
+      return result;
+    }
+    // the prefix we're looking for may end partway through the child's prefix.
+    size_t len = std::min(child->prefix.length(), str.length() - pos);
+    if (child->prefix.compare(0, len, str, pos, len) != 0) {
+      return result;
+    }
+    node = &*child;
+    pos += len;
+  }
+  node->get_all_children(result);
+  return result;
+}
@@ -18,7 +18,7 @@ void assert_string_empty_after(const char* str, int size) {
   }
 }
 
-std::string get_object_file_name(const std::string& original_name, u8* data, int size) {
+std::string get_object_file_name(const std::string& original_name, const u8* data, int size) {
   const std::string art_group_text =
       fmt::format("/src/next/data/art-group{}/",
                   versions::ART_FILE_VERSION);  // todo, this may change in other games
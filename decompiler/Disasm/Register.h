@@ -152,6 +152,11 @@ class Register {
   Reg::Cop2MacroSpecial get_cop2_macro_special() const;
   bool allowed_local_gpr() const;
 
+  // every register has a unique index in [0, MAX_INDEX), used to store sets of registers as bits.
+  static constexpr int MAX_INDEX = Reg::MAX_KIND * 32;
+  int index() const { return (id >> 8) * 32 + (id & 0xff); }
+  static Register from_index(int idx) { return Register(Reg::RegisterKind(idx / 32), idx % 32); }
+
   bool operator==(const Register& other) const;
   bool operator!=(const Register& other) const;
   bool operator<(const Register& other) const { return id < other.id; }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include "common/goos/PrettyPrinter.h"
 #include "decompiler/Disasm/InstructionMatching.h"
@@ -15,6 +16,7 @@ namespace decompiler {
  */
 void CfgVtx::parent_claim(CfgVtx* new_parent) {
   parent = new_parent;
+  new_parent->first_block_id = std::min(new_parent->first_block_id, first_block_id);
 
   // clear out all this junk - we don't need it now that we are a part of the "real" CFG!
   next = nullptr;
@@ -297,6 +299,8 @@ ControlFlowGraph::ControlFlowGraph() {
   // allocate the entry and exit vertices.
   m_entry = alloc<EntryVtx>();
   m_exit = alloc<ExitVtx>();
+  // these don't count as top level.
+  m_top_level.clear();
 }
 
 ControlFlowGraph::~ControlFlowGraph() {
@@ -348,11 +352,10 @@ bool ControlFlowGraph::is_fully_resolved() {
  */
 int ControlFlowGraph::get_top_level_vertices_count() {
   int count = 0;
-  for (auto* x : m_node_pool) {
-    if (!x->parent && x != entry() && x != exit()) {
-      count++;
-    }
-  }
+  for_each_top_level_vtx([&](CfgVtx*) {
+    count++;
+    return true;
+  });
   return count;
 }
 
@@ -361,13 +364,7 @@ int ControlFlowGraph::get_top_level_vertices_count() {
  */
 CfgVtx* ControlFlowGraph::get_single_top_level() {
   assert(get_top_level_vertices_count() == 1);
-  for (auto* x : m_node_pool) {
-    if (!x->parent && x != entry() && x != exit()) {
-      return x;
-    }
-  }
-  assert(false);
-  return nullptr;
+  return m_top_level.front();
 }
 
 /*!
@@ -379,11 +376,10 @@ goos::Object ControlFlowGraph::to_form() {
     return get_single_top_level()->to_form();
   } else {
     std::vector<goos::Object> forms = {pretty_print::to_symbol("ungrouped")};
-    for (auto* x : m_node_pool) {
-      if (!x->parent && x != entry() && x != exit()) {
-        forms.push_back(x->to_form());
-      }
-    }
+    for_each_top_level_vtx([&](CfgVtx* x) {
+      forms.push_back(x->to_form());
+      return true;
+    });
     return pretty_print::build_list(forms);
   }
 }
@@ -880,46 +876,6 @@ bool ControlFlowGraph::is_sequence(CfgVtx* b0, CfgVtx* b1) {
   return true;
 }
 
-bool ControlFlowGraph::is_sequence_of_non_sequences(CfgVtx* b0, CfgVtx* b1) {
-  if (!b0 || !b1)
-    return false;
-  if (dynamic_cast<SequenceVtx*>(b0) || dynamic_cast<SequenceVtx*>(b1))
-    return false;
-  return is_sequence(b0, b1);
-}
-
-bool ControlFlowGraph::is_sequence_of_sequence_and_non_sequence(CfgVtx* b0, CfgVtx* b1) {
-  if (!b0 || !b1)
-    return false;
-  if (!dynamic_cast<SequenceVtx*>(b0))
-    return false;
-  if (dynamic_cast<SequenceVtx*>(b1))
-    return false;
-  return is_sequence(b0, b1);
-}
-
-bool ControlFlowGraph::is_sequence_of_sequence_and_sequence(CfgVtx* b0, CfgVtx* b1) {
-  if (!b0 || !b1)
-    return false;
-  if (!dynamic_cast<SequenceVtx*>(b0))
-    return false;
-  if (!dynamic_cast<SequenceVtx*>(b1))
-    return false;
-  return is_sequence(b0, b1);
-}
-
-bool ControlFlowGraph::is_sequence_of_non_sequence_and_sequence(CfgVtx* b0, CfgVtx* b1) {
-  if (!b0 || !b1) {
-    return false;
-  }
-
-  if (dynamic_cast<SequenceVtx*>(b0))
-    return false;
-  if (!dynamic_cast<SequenceVtx*>(b1))
-    return false;
-  return is_sequence(b0, b1);
-}
-
 /*!
  * Find and insert at most one sequence. Return true if sequence is inserted.
  * To generate more readable debug output, we should aim to run this as infrequent and as
@@ -931,7 +887,15 @@ bool ControlFlowGraph::find_seq_top_level() {
     auto* b0 = vtx;
     auto* b1 = vtx->next;
 
-    if (is_sequence_of_non_sequences(b0, b1)) {  // todo, avoid nesting sequences.
+    // the four cases below only differ in which of b0/b1 are sequences, so check the shared
+    // structural condition once and pick the case from the vertex types.
+    if (!is_sequence(b0, b1)) {
+      return true;  // keep looking
+    }
+    bool b0_seq = dynamic_cast<SequenceVtx*>(b0);
+    bool b1_seq = dynamic_cast<SequenceVtx*>(b1);
+
+    if (!b0_seq && !b1_seq) {  // todo, avoid nesting sequences.
       replaced = true;
 
       auto* new_seq = alloc<SequenceVtx>();
@@ -964,7 +928,7 @@ bool ControlFlowGraph::find_seq_top_level() {
       return false;
     }
 
-    if (is_sequence_of_sequence_and_non_sequence(b0, b1)) {
+    if (b0_seq && !b1_seq) {
       //      printf("make seq type 2 %s %s\n", b0->to_string().c_str(), b1->to_string().c_str());
       replaced = true;
       auto* seq = dynamic_cast<SequenceVtx*>(b0);
@@ -987,7 +951,7 @@ bool ControlFlowGraph::find_seq_top_level() {
       return false;
     }
 
-    if (is_sequence_of_non_sequence_and_sequence(b0, b1)) {
+    if (!b0_seq && b1_seq) {
       replaced = true;
       auto* seq = dynamic_cast<SequenceVtx*>(b1);
       assert(seq);
@@ -1006,7 +970,7 @@ bool ControlFlowGraph::find_seq_top_level() {
       return false;
     }
 
-    if (is_sequence_of_sequence_and_sequence(b0, b1)) {
+    if (b0_seq && b1_seq) {
       //      printf("make seq type 3 %s %s\n", b0->to_string().c_str(), b1->to_string().c_str());
       replaced = true;
       auto* seq = dynamic_cast<SequenceVtx*>(b0);
@@ -1038,7 +1002,8 @@ bool ControlFlowGraph::find_seq_top_level() {
       return false;
     }
 
-    return true;  // keep looking
+    assert(false);
+    return true;
   });
 
   return replaced;
@@ -1046,16 +1011,14 @@ bool ControlFlowGraph::find_seq_top_level() {
 
 namespace {
 
-// is a found after b?
+// is a found after b? b must be a top level vertex.
+// Top level vertices are linked in code order, so compare the first block in each.
+// The entry and exit contain no blocks and aren't linked.
 bool is_found_after(CfgVtx* a, CfgVtx* b) {
-  b = b->next;
-  while (b) {
-    if (a == b) {
-      return true;
-    }
-    b = b->next;
+  if (a->parent || a->first_block_id == INT_MAX) {
+    return false;
   }
-  return false;
+  return a->first_block_id > b->first_block_id;
 }
 
 }  // namespace
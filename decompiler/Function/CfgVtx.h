@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <climits>
 
 namespace goos {
 class Object;
@@ -76,6 +77,7 @@ class CfgVtx {
   CfgVtx* prev = nullptr;         // previous code in memory
   std::vector<CfgVtx*> pred;      // all vertices which have us as succ_branch or succ_ft
   int uid = -1;
+  int first_block_id = INT_MAX;   // lowest block id we contain, orders top level vertices in code
 
   enum class DelaySlotKind { NO_BRANCH, SET_REG_FALSE, SET_REG_TRUE, NOP, OTHER, NO_DELAY };
 
@@ -150,7 +152,7 @@ class ExitVtx : public CfgVtx {
  */
 class BlockVtx : public CfgVtx {
  public:
-  explicit BlockVtx(int id) : block_id(id) {}
+  explicit BlockVtx(int id) : block_id(id) { first_block_id = id; }
   std::string to_string() const override;
   goos::Object to_form() const override;
   int block_id = -1;                 // which block are we?
@@ -314,18 +316,25 @@ class ControlFlowGraph {
   bool find_goto_not_end();
 
   /*!
-   * Apply a function f to each top-level vertex.
+   * Apply a function f to each top-level vertex, in the order they were allocated.
    * If f returns false, stops.
    */
   template <typename Func>
   void for_each_top_level_vtx(Func f) {
-    for (auto* x : m_node_pool) {
-      if (!x->parent && x != entry() && x != exit()) {
-        if (!f(x)) {
-          return;
-        }
+    // vertices claimed by a parent since the last time are removed from the list as we go.
+    size_t kept = 0;
+    for (size_t i = 0; i < m_top_level.size(); i++) {
+      auto* x = m_top_level[i];
+      if (x->parent) {
+        continue;
+      }
+      m_top_level[kept++] = x;
+      if (!f(x)) {
+        m_top_level.erase(m_top_level.begin() + kept, m_top_level.begin() + i + 1);
+        return;
       }
     }
+    m_top_level.resize(kept);
   }
 
   EntryVtx* entry() { return m_entry; }
@@ -338,6 +347,7 @@ class ControlFlowGraph {
   T* alloc(Args&&... args) {
     T* new_obj = new T(std::forward<Args>(args)...);
     m_node_pool.push_back(new_obj);
+    m_top_level.push_back(new_obj);
     new_obj->uid = m_uid++;
     return new_obj;
   }
@@ -346,16 +356,13 @@ class ControlFlowGraph {
   //  bool compact_one_in_top_level();
   //  bool is_if_else(CfgVtx* b0, CfgVtx* b1, CfgVtx* b2, CfgVtx* b3);
   bool is_sequence(CfgVtx* b0, CfgVtx* b1);
-  bool is_sequence_of_non_sequences(CfgVtx* b0, CfgVtx* b1);
-  bool is_sequence_of_sequence_and_non_sequence(CfgVtx* b0, CfgVtx* b1);
-  bool is_sequence_of_sequence_and_sequence(CfgVtx* b0, CfgVtx* b1);
-  bool is_sequence_of_non_sequence_and_sequence(CfgVtx* b0, CfgVtx* b1);
   bool is_while_loop(CfgVtx* b0, CfgVtx* b1, CfgVtx* b2);
   bool is_until_loop(CfgVtx* b1, CfgVtx* b2);
   bool is_goto_end_and_unreachable(CfgVtx* b0, CfgVtx* b1);
   bool is_goto_not_end_and_unreachable(CfgVtx* b0, CfgVtx* b1);
   std::vector<BlockVtx*> m_blocks;   // all block nodes, in order.
   std::vector<CfgVtx*> m_node_pool;  // all nodes allocated
+  std::vector<CfgVtx*> m_top_level;  // top level nodes in allocation order (and some old ones)
   EntryVtx* m_entry;                 // the entry vertex
   ExitVtx* m_exit;                   // the exit vertex
   int m_uid = 0;
@@ -245,15 +245,15 @@ TypeSpec Env::get_variable_type(const RegisterAccess& access, bool using_user_va
 /*!
  * Update the Env with the result of the type analysis pass.
  */
-void Env::set_types(const std::vector<TypeState>& block_init_types,
-                    const std::vector<TypeState>& op_end_types,
+void Env::set_types(std::vector<TypeState> block_init_types,
+                    std::vector<TypeState> op_end_types,
                     const FunctionAtomicOps& atomic_ops,
                     const TypeSpec& my_type) {
-  m_block_init_types = block_init_types;
-  m_op_end_types = op_end_types;
+  m_block_init_types = std::move(block_init_types);
+  m_op_end_types = std::move(op_end_types);
 
   // cache the init types (this ends up being faster)
-  m_op_init_types.resize(op_end_types.size(), nullptr);
+  m_op_init_types.resize(m_op_end_types.size(), nullptr);
   for (int block_idx = 0; block_idx < int(m_block_init_types.size()); block_idx++) {
     int first_op = atomic_ops.block_id_to_first_atomic_op.at(block_idx);
     int end_op = atomic_ops.block_id_to_end_atomic_op.at(block_idx);
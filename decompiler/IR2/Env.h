@@ -86,8 +86,8 @@ class Env {
     return m_block_init_types.at(block_id);
   }
 
-  void set_types(const std::vector<TypeState>& block_init_types,
-                 const std::vector<TypeState>& op_end_types,
+  void set_types(std::vector<TypeState> block_init_types,
+                 std::vector<TypeState> op_end_types,
                  const FunctionAtomicOps& atomic_ops,
                  const TypeSpec& my_type);
 
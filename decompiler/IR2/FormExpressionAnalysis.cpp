@@ -591,9 +591,10 @@ void SimpleExpressionElement::update_from_stack_add_i(const Env& env,
       if (out.success) {
         // it is. now we have to modify things
         // first, look for the index
-        auto arg0_matcher = Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
-                                        {Matcher::any(0), Matcher::integer(input.offset)});
-        auto match_result = match(arg0_matcher, args.at(0));
+        static const auto arg0_matcher =
+            Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
+                        {Matcher::any(0), Matcher::integer_param(0)});
+        auto match_result = match(arg0_matcher, args.at(0), {input.offset});
         if (match_result.matched) {
           bool used_index = false;
           std::vector<DerefToken> tokens;
@@ -625,12 +626,12 @@ void SimpleExpressionElement::update_from_stack_add_i(const Env& env,
         int p2;
         if (is_power_of_two(input.stride, &p2)) {
           // (+ (shl (-> a0-0 reg-count) 3) 28)
-          auto arg0_matcher =
+          static const auto arg0_matcher =
               Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
                           {Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::SHL),
-                                       {Matcher::any(0), Matcher::integer(p2)}),
-                           Matcher::integer(input.offset)});
-          auto match_result = match(arg0_matcher, args.at(0));
+                                       {Matcher::any(0), Matcher::integer_param(0)}),
+                           Matcher::integer_param(1)});
+          auto match_result = match(arg0_matcher, args.at(0), {p2, input.offset});
           if (match_result.matched) {
             bool used_index = false;
             std::vector<DerefToken> tokens;
@@ -651,12 +652,12 @@ void SimpleExpressionElement::update_from_stack_add_i(const Env& env,
                             args.at(0)->to_string(env)));
           }
         } else {
-          auto arg0_matcher =
+          static const auto arg0_matcher =
               Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
                           {Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::MULTIPLICATION),
-                                       {Matcher::integer(input.stride), Matcher::any(0)}),
-                           Matcher::integer(input.offset)});
-          auto match_result = match(arg0_matcher, args.at(0));
+                                       {Matcher::integer_param(0), Matcher::any(0)}),
+                           Matcher::integer_param(1)});
+          auto match_result = match(arg0_matcher, args.at(0), {input.stride, input.offset});
           if (match_result.matched) {
             bool used_index = false;
             std::vector<DerefToken> tokens;
@@ -875,7 +876,7 @@ void SimpleExpressionElement::update_from_stack_int_to_float(const Env& env,
   auto arg = pop_to_forms({var}, env, pool, stack, allow_side_effects).at(0);
   // if we convert from a GPR to FPR, then immediately to int to float, we can strip away the
   // the gpr->fpr operation beacuse it doesn't matter.
-  auto fpr_convert_matcher =
+  static const auto fpr_convert_matcher =
       Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::GPR_TO_FPR), {Matcher::any(0)});
   auto type = env.get_types_before_op(var.idx()).get(var.reg()).typespec();
   if (type == TypeSpec("int") || type == TypeSpec("uint")) {
@@ -1346,8 +1347,9 @@ void FunctionCallElement::update_from_stack(const Env& env,
   FormElement* new_form = nullptr;
   if (is_virtual_method) {
     //    fmt::print("STACK:\n{}\n\n", stack.print(env));
-    auto matcher = Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::METHOD_OF_OBJECT),
-                               {Matcher::any(0), Matcher::any(1)});
+    static const auto matcher =
+        Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::METHOD_OF_OBJECT),
+                    {Matcher::any(0), Matcher::any(1)});
     auto mr = match(matcher, unstacked.at(0));
     if (!mr.matched) {
       throw std::runtime_error("Failed to match method call. Got " +
@@ -1433,11 +1435,11 @@ void FunctionCallElement::update_from_stack(const Env& env,
     constexpr int type_for_method = 0;
     constexpr int method_name = 1;
 
-    auto deref_matcher = Matcher::deref(
+    static const auto deref_matcher = Matcher::deref(
         Matcher::any_symbol(type_for_method), false,
         {DerefTokenMatcher::string("methods-by-name"), DerefTokenMatcher::any_string(method_name)});
 
-    auto matcher = Matcher::op_with_rest(GenericOpMatcher::func(deref_matcher), {});
+    static const auto matcher = Matcher::op_with_rest(GenericOpMatcher::func(deref_matcher), {});
     auto temp_form = pool.alloc_single_form(nullptr, new_form);
     auto match_result = match(matcher, temp_form);
     if (match_result.matched) {
@@ -1477,11 +1479,10 @@ void FunctionCallElement::update_from_stack(const Env& env,
       } else if (name == "new") {
         constexpr int allocation = 2;
         constexpr int type_for_arg = 3;
-        auto alloc_matcher = Matcher::any_quoted_symbol(allocation);
-        auto type_arg_matcher = Matcher::any_symbol(type_for_arg);
-        matcher = Matcher::op_with_rest(GenericOpMatcher::func(deref_matcher),
-                                        {alloc_matcher, type_arg_matcher});
-        match_result = match(matcher, temp_form);
+        static const auto new_matcher = Matcher::op_with_rest(
+            GenericOpMatcher::func(deref_matcher),
+            {Matcher::any_quoted_symbol(allocation), Matcher::any_symbol(type_for_arg)});
+        match_result = match(new_matcher, temp_form);
         if (match_result.matched) {
           auto alloc = match_result.maps.strings.at(allocation);
           if (alloc != "global" && alloc != "debug" && alloc != "process") {
@@ -1531,11 +1532,11 @@ void FunctionCallElement::update_from_stack(const Env& env,
     constexpr int method_name = 0;
     constexpr int type_source = 1;
 
-    auto deref_matcher = Matcher::deref(
+    static const auto deref_matcher = Matcher::deref(
         Matcher::any(type_source), false,
         {DerefTokenMatcher::string("methods-by-name"), DerefTokenMatcher::any_string(method_name)});
 
-    auto matcher = Matcher::op_with_rest(GenericOpMatcher::func(deref_matcher), {});
+    static const auto matcher = Matcher::op_with_rest(GenericOpMatcher::func(deref_matcher), {});
     auto temp_form = pool.alloc_single_form(nullptr, new_form);
     auto match_result = match(matcher, temp_form);
     if (match_result.matched) {
@@ -1607,7 +1608,7 @@ void DerefElement::update_from_stack(const Env& env,
   // rewrite access to the method table to use method-of-object
   // (-> <some-object> type methods-by-name <method-name>)
   // (method-of-object <some-object> <method-name>)
-  auto get_method_matcher = Matcher::deref(
+  static const auto get_method_matcher = Matcher::deref(
       Matcher::any(0), false,
       {DerefTokenMatcher::string("type"), DerefTokenMatcher::string("methods-by-name"),
        DerefTokenMatcher::any_string(1)});
@@ -1978,9 +1979,9 @@ FormElement* ConditionElement::make_zero_check_generic(const Env&,
                                                        const std::vector<TypeSpec>&) {
   // (zero? (+ thing small-integer)) -> (= thing (- small-integer))
   assert(source_forms.size() == 1);
-  auto mr = match(Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
-                              {Matcher::any(0), Matcher::any_integer(1)}),
-                  source_forms.at(0));
+  static const auto matcher = Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
+                                          {Matcher::any(0), Matcher::any_integer(1)});
+  auto mr = match(matcher, source_forms.at(0));
   if (mr.matched) {
     s64 value = -mr.maps.ints.at(1);
     auto value_form = pool.alloc_single_element_form<SimpleAtomElement>(
@@ -2039,14 +2040,14 @@ FormElement* ConditionElement::make_less_than_zero_signed_check_generic(
   // (< (shl (the-as int iter) 62) 0) -> (pair? iter)
 
   // match (shl [(the-as int [x]) | [x]] 62)
-  auto shift_match =
-      match(Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::SHL),
-                        {
-                            Matcher::match_or({Matcher::cast("int", Matcher::any(0)),
-                                               Matcher::any(0)}),  // the val
-                            Matcher::integer(62)  // get the bit in the highest position.
-                        }),
-            source_forms.at(0));
+  static const auto shift_matcher =
+      Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::SHL),
+                  {
+                      Matcher::match_or({Matcher::cast("int", Matcher::any(0)),
+                                         Matcher::any(0)}),  // the val
+                      Matcher::integer(62)  // get the bit in the highest position.
+                  });
+  auto shift_match = match(shift_matcher, source_forms.at(0));
 
   if (shift_match.matched) {
     return pool.alloc_element<GenericElement>(GenericOperator::make_fixed(FixedOperatorKind::PAIRP),
@@ -2070,14 +2071,14 @@ FormElement* ConditionElement::make_geq_zero_signed_check_generic(
   // (>= (shl (the-as int iter) 62) 0) -> (not (pair? iter))
 
   // match (shl [(the-as int [x]) | [x]] 62)
-  auto shift_match =
-      match(Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::SHL),
-                        {
-                            Matcher::match_or({Matcher::cast("int", Matcher::any(0)),
-                                               Matcher::any(0)}),  // the val
-                            Matcher::integer(62)  // get the bit in the highest position.
-                        }),
-            source_forms.at(0));
+  static const auto shift_matcher =
+      Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::SHL),
+                  {
+                      Matcher::match_or({Matcher::cast("int", Matcher::any(0)),
+                                         Matcher::any(0)}),  // the val
+                      Matcher::integer(62)  // get the bit in the highest position.
+                  });
+  auto shift_match = match(shift_matcher, source_forms.at(0));
 
   if (shift_match.matched) {
     return pool.alloc_element<GenericElement>(
@@ -2386,14 +2387,16 @@ void DynamicMethodAccess::update_from_stack(const Env& env,
                                             bool allow_side_effects) {
   mark_popped();
   auto new_val = stack.pop_reg(m_source, {}, env, allow_side_effects);
-  auto reg0_matcher =
+  static const auto reg0_matcher =
       Matcher::match_or({Matcher::any_reg(0), Matcher::cast("uint", Matcher::any_reg(0))});
-  auto reg1_matcher =
+  static const auto reg1_matcher =
       Matcher::match_or({Matcher::any_reg(1), Matcher::cast("int", Matcher::any_reg(1))});
 
   // (+ (sll (the-as uint a1-0) 2) (the-as int a0-0))
-  auto sll_matcher = Matcher::fixed_op(FixedOperatorKind::SHL, {reg0_matcher, Matcher::integer(2)});
-  auto matcher = Matcher::fixed_op(FixedOperatorKind::ADDITION, {sll_matcher, reg1_matcher});
+  static const auto sll_matcher =
+      Matcher::fixed_op(FixedOperatorKind::SHL, {reg0_matcher, Matcher::integer(2)});
+  static const auto matcher =
+      Matcher::fixed_op(FixedOperatorKind::ADDITION, {sll_matcher, reg1_matcher});
   auto match_result = match(matcher, new_val);
   if (!match_result.matched) {
     throw std::runtime_error("Couldn't match DynamicMethodAccess values: " +
@@ -2429,23 +2432,25 @@ void ArrayFieldAccess::update_with_val(Form* new_val,
       // reg0 is base
       // reg1 is idx
 
-      auto reg0_matcher =
+      // the shift amount is integer parameter 0.
+      static const auto reg0_matcher =
           Matcher::match_or({Matcher::cast("int", Matcher::any(0)),
                              Matcher::cast("uint", Matcher::any(0)), Matcher::any(0)});
-      auto reg1_matcher =
+      static const auto reg1_matcher =
           Matcher::match_or({Matcher::cast("uint", Matcher::any(1)), Matcher::any(1)});
-      auto sll_matcher =
-          Matcher::fixed_op(FixedOperatorKind::SHL, {reg1_matcher, Matcher::integer(power_of_two)});
-      sll_matcher = Matcher::match_or({Matcher::cast("uint", sll_matcher), sll_matcher});
-      auto matcher = Matcher::match_or(
+      static const auto shift_matcher =
+          Matcher::fixed_op(FixedOperatorKind::SHL, {reg1_matcher, Matcher::integer_param(0)});
+      static const auto sll_matcher =
+          Matcher::match_or({Matcher::cast("uint", shift_matcher), shift_matcher});
+      static const auto matcher = Matcher::match_or(
           {Matcher::fixed_op(FixedOperatorKind::ADDITION, {reg0_matcher, sll_matcher}),
            Matcher::fixed_op(FixedOperatorKind::ADDITION_PTR, {reg0_matcher, sll_matcher})});
-      auto match_result = match(matcher, new_val);
+      static const auto swapped_matcher = Matcher::match_or(
+          {Matcher::fixed_op(FixedOperatorKind::ADDITION, {sll_matcher, reg0_matcher}),
+           Matcher::fixed_op(FixedOperatorKind::ADDITION_PTR, {sll_matcher, reg0_matcher})});
+      auto match_result = match(matcher, new_val, {power_of_two});
       if (!match_result.matched) {
-        matcher = Matcher::match_or(
-            {Matcher::fixed_op(FixedOperatorKind::ADDITION, {sll_matcher, reg0_matcher}),
-             Matcher::fixed_op(FixedOperatorKind::ADDITION_PTR, {sll_matcher, reg0_matcher})});
-        match_result = match(matcher, new_val);
+        match_result = match(swapped_matcher, new_val, {power_of_two});
         if (!match_result.matched) {
           fmt::print("power {}\n", power_of_two);
           throw std::runtime_error(
@@ -2474,12 +2479,13 @@ void ArrayFieldAccess::update_with_val(Form* new_val,
   } else {
     if (m_expected_stride == 1) {
       // reg0 is idx
-      auto reg0_matcher =
+      static const auto reg0_matcher =
           Matcher::match_or({Matcher::any(0), Matcher::cast("int", Matcher::any_reg(0))});
       // reg1 is base
-      auto reg1_matcher =
+      static const auto reg1_matcher =
           Matcher::match_or({Matcher::any_reg(1), Matcher::cast("int", Matcher::any_reg(1))});
-      auto matcher = Matcher::fixed_op(FixedOperatorKind::ADDITION, {reg0_matcher, reg1_matcher});
+      static const auto matcher =
+          Matcher::fixed_op(FixedOperatorKind::ADDITION, {reg0_matcher, reg1_matcher});
       auto match_result = match(matcher, new_val);
       if (!match_result.matched) {
         throw std::runtime_error("Couldn't match ArrayFieldAccess (stride 1) values: " +
@@ -2502,20 +2508,24 @@ void ArrayFieldAccess::update_with_val(Form* new_val,
     } else if (is_power_of_two(m_expected_stride, &power_of_two)) {
       // (+ (sll (the-as uint a1-0) 2) (the-as int a0-0))
       // (+ gp-0 (the-as uint (shl (the-as uint (shl (the-as uint s4-0) 2)) 2)))
-      auto reg0_matcher =
+      // the shift amount is integer parameter 0.
+      static const auto reg0_matcher =
           Matcher::match_or({Matcher::cast("uint", Matcher::any(0)), Matcher::any(0)});
-      auto reg1_matcher =
+      static const auto reg1_matcher =
           Matcher::match_or({Matcher::cast("uint", Matcher::any(1)),
                              Matcher::cast("int", Matcher::any(1)), Matcher::any(1)});
-      auto sll_matcher =
-          Matcher::fixed_op(FixedOperatorKind::SHL, {reg0_matcher, Matcher::integer(power_of_two)});
-      sll_matcher = Matcher::match_or({Matcher::cast("uint", sll_matcher), sll_matcher});
-      auto matcher = Matcher::fixed_op(FixedOperatorKind::ADDITION, {sll_matcher, reg1_matcher});
-      auto match_result = match(matcher, new_val);
+      static const auto shift_matcher =
+          Matcher::fixed_op(FixedOperatorKind::SHL, {reg0_matcher, Matcher::integer_param(0)});
+      static const auto sll_matcher =
+          Matcher::match_or({Matcher::cast("uint", shift_matcher), shift_matcher});
+      static const auto matcher =
+          Matcher::fixed_op(FixedOperatorKind::ADDITION, {sll_matcher, reg1_matcher});
+      static const auto swapped_matcher =
+          Matcher::fixed_op(FixedOperatorKind::ADDITION, {reg1_matcher, sll_matcher});
+      auto match_result = match(matcher, new_val, {power_of_two});
       // TODO - figure out why it sometimes happens the other way.
       if (!match_result.matched) {
-        matcher = Matcher::fixed_op(FixedOperatorKind::ADDITION, {reg1_matcher, sll_matcher});
-        match_result = match(matcher, new_val);
+        match_result = match(swapped_matcher, new_val, {power_of_two});
         if (!match_result.matched) {
           throw std::runtime_error("Couldn't match ArrayFieldAccess (stride power of 2) values: " +
                                    new_val->to_string(env));
@@ -2538,13 +2548,17 @@ void ArrayFieldAccess::update_with_val(Form* new_val,
       result->push_back(deref);
     } else {
       // (+ v0-0 (the-as uint (* 12 (+ a3-0 -1))))
-      auto mult_matcher = Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::MULTIPLICATION),
-                                      {Matcher::integer(m_expected_stride), Matcher::any(0)});
-      mult_matcher = Matcher::match_or({Matcher::cast("uint", mult_matcher), mult_matcher});
-      auto add_matcher = Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
-                                     {Matcher::any(1), mult_matcher});
-
-      auto mr = match(add_matcher, new_val);
+      // the stride is integer parameter 0.
+      static const auto mult_matcher =
+          Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::MULTIPLICATION),
+                      {Matcher::integer_param(0), Matcher::any(0)});
+      static const auto cast_mult_matcher =
+          Matcher::match_or({Matcher::cast("uint", mult_matcher), mult_matcher});
+      static const auto add_matcher = Matcher::op(
+          GenericOpMatcher::fixed(FixedOperatorKind::ADDITION),
+          {Matcher::any(1), cast_mult_matcher});
+
+      auto mr = match(add_matcher, new_val, {m_expected_stride});
       if (!mr.matched) {
         throw std::runtime_error("Failed to match non-power of two case: " +
                                  new_val->to_string(env));
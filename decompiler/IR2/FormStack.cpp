@@ -230,12 +230,18 @@ FormElement* FormStack::pop_back(FormPool& pool) {
 }
 
 namespace {
+/*!
+ * Build the matcher for (op <reg> <val>), used to detect (set! <reg> (op <reg> <val>)).
+ */
+Matcher make_in_place_matcher(FixedOperatorKind op) {
+  return Matcher::op(GenericOpMatcher::fixed(op), {Matcher::any_reg(0), Matcher::any(1)});
+}
+
 bool is_op_in_place(SetVarElement* elt,
-                    FixedOperatorKind op,
+                    const Matcher& matcher,
                     const Env& env,
                     RegisterAccess* base_out,
                     Form** val_out) {
-  auto matcher = Matcher::op(GenericOpMatcher::fixed(op), {Matcher::any_reg(0), Matcher::any(1)});
   auto result = match(matcher, elt->src());
   if (result.matched) {
     auto first = result.maps.regs.at(0);
@@ -267,12 +273,12 @@ bool is_op_in_place(SetVarElement* elt,
 FormElement* rewrite_set_op_in_place_for_kind(SetVarElement* in,
                                               const Env& env,
                                               FormPool& pool,
-                                              FixedOperatorKind first_kind,
+                                              const Matcher& first_matcher,
                                               FixedOperatorKind in_place_kind) {
   Form* val = nullptr;
   RegisterAccess base;
 
-  if (is_op_in_place(in, first_kind, env, &base, &val)) {
+  if (is_op_in_place(in, first_matcher, env, &base, &val)) {
     return pool.alloc_element<GenericElement>(
         GenericOperator::make_fixed(in_place_kind),
         std::vector<Form*>{
@@ -283,13 +289,15 @@ FormElement* rewrite_set_op_in_place_for_kind(SetVarElement* in,
 }
 
 FormElement* try_rewrites_in_place(SetVarElement* in, const Env& env, FormPool& pool) {
-  auto out = rewrite_set_op_in_place_for_kind(in, env, pool, FixedOperatorKind::ADDITION,
+  static const auto add_matcher = make_in_place_matcher(FixedOperatorKind::ADDITION);
+  static const auto add_ptr_matcher = make_in_place_matcher(FixedOperatorKind::ADDITION_PTR);
+  auto out = rewrite_set_op_in_place_for_kind(in, env, pool, add_matcher,
                                               FixedOperatorKind::ADDITION_IN_PLACE);
   if (out != in) {
     return out;
   }
 
-  out = rewrite_set_op_in_place_for_kind(in, env, pool, FixedOperatorKind::ADDITION_PTR,
+  out = rewrite_set_op_in_place_for_kind(in, env, pool, add_ptr_matcher,
                                          FixedOperatorKind::ADDITION_PTR_IN_PLACE);
   if (out != in) {
     return out;
@@ -1,17 +1,27 @@
 #include "GenericElementMatcher.h"
 
 namespace decompiler {
+namespace {
+/*!
+ * Captures are stored in fixed size arrays, so check the id once, when the pattern is built.
+ */
+int check_capture_id(int id) {
+  assert(id >= -1 && id < MatchResult::MAX_CAPTURES);
+  return id;
+}
+}  // namespace
+
 Matcher Matcher::any_reg(int match_id) {
   Matcher m;
   m.m_kind = Kind::ANY_REG;
-  m.m_reg_out_id = match_id;
+  m.m_reg_out_id = check_capture_id(match_id);
   return m;
 }
 
 Matcher Matcher::any_label(int match_id) {
   Matcher m;
   m.m_kind = Kind::ANY_LABEL;
-  m.m_label_out_id = match_id;
+  m.m_label_out_id = check_capture_id(match_id);
   return m;
 }
 
@@ -49,7 +59,7 @@ Matcher Matcher::match_or(const std::vector<Matcher>& args) {
 Matcher Matcher::cast(const std::string& type, Matcher value) {
   Matcher m;
   m.m_kind = Kind::CAST;
-  m.m_str = type;
+  m.m_type = TypeSpec(type);
   m.m_sub_matchers = {value};
   return m;
 }
@@ -57,7 +67,7 @@ Matcher Matcher::cast(const std::string& type, Matcher value) {
 Matcher Matcher::any(int match_id) {
   Matcher m;
   m.m_kind = Kind::ANY;
-  m.m_form_match = match_id;
+  m.m_form_match = check_capture_id(match_id);
   return m;
 }
 
@@ -68,24 +78,32 @@ Matcher Matcher::integer(std::optional<int> value) {
   return m;
 }
 
+Matcher Matcher::integer_param(int param_id) {
+  Matcher m;
+  m.m_kind = Kind::INT_PARAM;
+  assert(param_id >= 0 && param_id < MatchResult::MAX_CAPTURES);
+  m.m_int_param_id = param_id;
+  return m;
+}
+
 Matcher Matcher::any_integer(int match_id) {
   Matcher m;
   m.m_kind = Kind::ANY_INT;
-  m.m_int_out_id = match_id;
+  m.m_int_out_id = check_capture_id(match_id);
   return m;
 }
 
 Matcher Matcher::any_quoted_symbol(int match_id) {
   Matcher m;
   m.m_kind = Kind::ANY_QUOTED_SYMBOL;
-  m.m_string_out_id = match_id;
+  m.m_string_out_id = check_capture_id(match_id);
   return m;
 }
 
 Matcher Matcher::any_symbol(int match_id) {
   Matcher m;
   m.m_kind = Kind::ANY_SYMBOL;
-  m.m_string_out_id = match_id;
+  m.m_string_out_id = check_capture_id(match_id);
   return m;
 }
 
@@ -160,8 +178,7 @@ bool Matcher::do_match(Form* input, MatchResult::Maps* maps_out) const {
 
       if (got) {
         if (m_reg_out_id != -1) {
-          maps_out->regs.resize(std::max(size_t(m_reg_out_id + 1), maps_out->regs.size()));
-          maps_out->regs.at(m_reg_out_id) = result;
+          maps_out->regs[m_reg_out_id] = result;
         }
         return true;
       } else {
@@ -254,7 +271,7 @@ bool Matcher::do_match(Form* input, MatchResult::Maps* maps_out) const {
     case Kind::CAST: {
       auto as_cast = dynamic_cast<CastElement*>(input->try_as_single_element());
       if (as_cast) {
-        if (as_cast->type().print() == m_str) {
+        if (as_cast->type() == m_type) {
           return m_sub_matchers.at(0).do_match(as_cast->source(), maps_out);
         }
       }
@@ -286,6 +303,25 @@ bool Matcher::do_match(Form* input, MatchResult::Maps* maps_out) const {
       return false;
     } break;
 
+    case Kind::INT_PARAM: {
+      auto as_simple_atom = dynamic_cast<SimpleAtomElement*>(input->try_as_single_element());
+      if (as_simple_atom) {
+        if (as_simple_atom->atom().is_int()) {
+          return as_simple_atom->atom().get_int() == maps_out->int_params[m_int_param_id];
+        }
+      }
+
+      auto as_expr = dynamic_cast<SimpleExpressionElement*>(input->try_as_single_element());
+      if (as_expr && as_expr->expr().is_identity()) {
+        auto atom = as_expr->expr().get_arg(0);
+        if (atom.is_int()) {
+          return atom.get_int() == maps_out->int_params[m_int_param_id];
+        }
+      }
+
+      return false;
+    } break;
+
     case Kind::ANY_INT: {
       auto as_simple_atom = dynamic_cast<SimpleAtomElement*>(input->try_as_single_element());
       if (as_simple_atom) {
@@ -472,6 +508,17 @@ MatchResult match(const Matcher& spec, Form* input) {
   return result;
 }
 
+/*!
+ * Match with integer parameters. The i-th value is what Matcher::integer_param(i) must match.
+ */
+MatchResult match(const Matcher& spec, Form* input, std::initializer_list<s64> int_params) {
+  MatchResult result;
+  assert(int_params.size() <= result.maps.int_params.size());
+  std::copy(int_params.begin(), int_params.end(), result.maps.int_params.begin());
+  result.matched = spec.do_match(input, &result.maps);
+  return result;
+}
+
 DerefTokenMatcher DerefTokenMatcher::string(const std::string& str) {
   DerefTokenMatcher result;
   result.m_kind = Kind::STRING;
@@ -482,7 +529,7 @@ DerefTokenMatcher DerefTokenMatcher::string(const std::string& str) {
 DerefTokenMatcher DerefTokenMatcher::any_string(int match_id) {
   DerefTokenMatcher result;
   result.m_kind = Kind::ANY_STRING;
-  result.m_str_out_id = match_id;
+  result.m_str_out_id = check_capture_id(match_id);
   return result;
 }
 
@@ -2,9 +2,14 @@
  * @file GenericElementMatcher.h
  *
  * The Matcher is supposed to match up forms to templates, and extract the variables actually used.
+ *
+ * Matchers are meant to be built once and reused (for example, as a function-local static const),
+ * so matching never allocates. Values that are only known at match time, like an expected stride,
+ * are passed in as integer parameters instead of being baked into a new Matcher.
  */
 
 #pragma once
+#include <array>
 #include "Form.h"
 
 namespace decompiler {
@@ -12,13 +17,17 @@ class DerefTokenMatcher;
 class GenericOpMatcher;
 
 struct MatchResult {
+  // all capture ids and integer parameter ids must be less than this.
+  static constexpr int MAX_CAPTURES = 8;
   bool matched = false;
   struct Maps {
-    std::vector<std::optional<RegisterAccess>> regs;
-    std::unordered_map<int, std::string> strings;
-    std::unordered_map<int, Form*> forms;
-    std::unordered_map<int, int> label;
-    std::unordered_map<int, int> ints;
+    std::array<std::optional<RegisterAccess>, MAX_CAPTURES> regs;
+    std::array<std::string, MAX_CAPTURES> strings;
+    std::array<Form*, MAX_CAPTURES> forms = {};
+    std::array<int, MAX_CAPTURES> label = {};
+    std::array<int, MAX_CAPTURES> ints = {};
+    // inputs, compared against by Matcher::integer_param
+    std::array<s64, MAX_CAPTURES> int_params = {};
   } maps;
 };
 
@@ -34,6 +43,7 @@ class Matcher {
   static Matcher cast(const std::string& type, Matcher value);
   static Matcher any(int match_id = -1);
   static Matcher integer(std::optional<int> value);
+  static Matcher integer_param(int param_id);
   static Matcher any_integer(int match_id = -1);
   static Matcher any_reg_cast_to_int_or_uint(int match_id = -1);
   static Matcher any_quoted_symbol(int match_id = -1);
@@ -55,6 +65,7 @@ class Matcher {
     CAST,
     ANY,
     INT,
+    INT_PARAM,
     ANY_INT,
     ANY_QUOTED_SYMBOL,
     ANY_SYMBOL,
@@ -80,11 +91,14 @@ class Matcher {
   int m_form_match = -1;
   int m_label_out_id = -1;
   int m_int_out_id = -1;
+  int m_int_param_id = -1;
   std::optional<int> m_int_match;
   std::string m_str;
+  TypeSpec m_type;
 };
 
 MatchResult match(const Matcher& spec, Form* input);
+MatchResult match(const Matcher& spec, Form* input, std::initializer_list<s64> int_params);
 
 class DerefTokenMatcher {
  public:
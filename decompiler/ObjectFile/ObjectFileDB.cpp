@@ -11,14 +11,13 @@
 #include <cstring>
 #include <map>
 #include "common/link_types.h"
-#include "common/util/dgo_util.h"
+#include "common/util/DgoReader.h"
 #include "decompiler/data/tpage.h"
 #include "decompiler/data/game_text.h"
 #include "decompiler/data/StrFileReader.h"
 #include "decompiler/data/game_count.h"
 #include "LinkedObjectFileCreation.h"
 #include "decompiler/config.h"
-#include "common/util/BinaryReader.h"
 #include "common/util/Timer.h"
 #include "common/util/FileUtil.h"
 #include "decompiler/Function/BasicBlocks.h"
@@ -26,6 +25,7 @@
 #include "decompiler/Function/TypeInspector.h"
 #include "common/log/log.h"
 #include "common/util/json_util.h"
+#include "decompiler/util/OutputWriter.h"
 
 namespace decompiler {
 namespace {
@@ -127,9 +127,14 @@ ObjectFileDB::ObjectFileDB(const std::vector<std::string>& _dgos,
   }
 
   lg::info("-Loading {} DGOs...", _dgos.size());
+  Timer dgo_timer;
   for (auto& dgo : _dgos) {
     get_objs_from_dgo(dgo);
   }
+  lg::info(" Total {:.3f} MB of DGOs, kept {} of {} objects ({:.3f} MB) in {:.2f} ms",
+           stats.total_dgo_bytes / ((float)(1u << 20u)), stats.unique_obj_files,
+           stats.total_obj_files, stats.unique_obj_bytes / ((float)(1u << 20u)),
+           dgo_timer.getMs());
 
   lg::info("-Loading {} plain object files...", object_files.size());
   for (auto& obj : object_files) {
@@ -186,47 +191,30 @@ void ObjectFileDB::load_map_file(const std::string& map_data) {
   }
 }
 
-constexpr int MAX_CHUNK_SIZE = 0x8000;
 /*!
  * Load the objects stored in the given DGO into the ObjectFileDB
+ * The DGO is memory mapped (or decompressed, if needed) and objects are only copied out of it if
+ * they are new.
  */
 void ObjectFileDB::get_objs_from_dgo(const std::string& filename) {
-  auto dgo_data = file_util::read_binary_file(filename);
-  stats.total_dgo_bytes += dgo_data.size();
-
-  if (file_util::dgo_header_is_compressed(dgo_data)) {
-    dgo_data = file_util::decompress_dgo(dgo_data);
-  }
-
-  BinaryReader reader(dgo_data);
-  auto header = reader.read<DgoHeader>();
+  stats.total_dgo_bytes += std::filesystem::file_size(filename);
+  DgoReader reader(filename);
 
   auto dgo_base_name = file_util::base_name(filename);
-  assert(header.name == dgo_base_name);
-  assert_string_empty_after(header.name, 60);
+  assert(reader.internal_name() == dgo_base_name);
 
   // get all obj files...
-  for (uint32_t i = 0; i < header.object_count; i++) {
-    auto obj_header = reader.read<DgoHeader>();
-    assert(reader.bytes_left() >= obj_header.object_count);
-    assert_string_empty_after(obj_header.name, 60);
-
-    if (std::string(obj_header.name).find("-ag") != std::string::npos) {
+  for (auto& obj : reader.entries()) {
+    if (obj.internal_name.find("-ag") != std::string::npos) {
       lg::error(
           "Object file {} has \"-ag\" in its name. This will break any tools which use this to "
           "detect an art group",
-          obj_header.name);
+          obj.internal_name);
       assert(false);
     }
 
-    auto name = get_object_file_name(obj_header.name, reader.here(), obj_header.object_count);
-
-    add_obj_from_dgo(name, obj_header.name, reader.here(), obj_header.object_count, dgo_base_name);
-    reader.ffwd(obj_header.object_count);
+    add_obj_from_dgo(obj.object_name, obj.internal_name, obj.data, obj.size, dgo_base_name);
   }
-
-  // check we're at the end
-  assert(0 == reader.bytes_left());
 }
 
 /*!
@@ -272,10 +260,9 @@ void ObjectFileDB::add_obj_from_dgo(const std::string& obj_name,
     return;
   }
 
-  // nope, have to add a new one.
+  // nope, have to add a new one. This is the only time we copy the object data.
   ObjectFileData data;
-  data.data.resize(obj_size);
-  memcpy(data.data.data(), obj_data, obj_size);
+  data.data.assign(obj_data, obj_data + obj_size);
   data.record.hash = hash;
   data.record.name = obj_name;
   data.dgo_names.push_back(dgo_name);
@@ -460,42 +447,38 @@ void ObjectFileDB::write_disassembly(const std::string& output_dir,
                                      const std::string& file_suffix) {
   lg::info("- Writing functions...");
   Timer timer;
-  uint32_t total_bytes = 0, total_files = 0;
-
+  int total_files = 0;
   std::string asm_functions;
 
+  // formatting happens here, the writer only does the file I/O.
+  OutputWriter writer;
   for_each_obj([&](ObjectFileData& obj) {
     if (obj.linked_data.has_any_functions() || disassemble_objects_without_functions) {
-      auto file_text = obj.linked_data.print_disassembly();
       asm_functions += obj.linked_data.print_asm_function_disassembly(obj.to_unique_name());
-      auto file_name =
-          file_util::combine_path(output_dir, obj.to_unique_name() + file_suffix + ".asm");
 
       if (get_config().analyze_functions && write_json) {
-        auto json_asm_text = obj.linked_data.to_asm_json(obj.to_unique_name());
         auto json_asm_file_name =
             file_util::combine_path(output_dir, obj.to_unique_name() + "_asm.json");
-        file_util::write_text_file(json_asm_file_name, json_asm_text);
+        writer.write(json_asm_file_name, obj.linked_data.to_asm_json(obj.to_unique_name()));
         total_files++;
-        total_bytes += json_asm_text.size();
       }
 
-      total_bytes += file_text.size();
-      file_util::write_text_file(file_name, file_text);
+      auto file_name =
+          file_util::combine_path(output_dir, obj.to_unique_name() + file_suffix + ".asm");
+      writer.write(file_name, obj.linked_data.print_disassembly());
       total_files++;
     }
   });
 
-  total_bytes += asm_functions.size();
+  writer.write(file_util::combine_path(output_dir, "asm_functions.func"), std::move(asm_functions));
   total_files++;
-  file_util::write_text_file(file_util::combine_path(output_dir, "asm_functions.func"),
-                             asm_functions);
 
+  auto write_stats = writer.finish();
   lg::info("Wrote functions dumps:");
-  lg::info(" Total {} files", total_files);
-  lg::info(" Total {} MB", total_bytes / ((float)(1u << 20u)));
+  lg::info(" Total {} files ({} unchanged)", total_files, write_stats.files_unchanged);
+  lg::info(" Total {} MB", write_stats.bytes / ((float)(1u << 20u)));
   lg::info(" Total {} ms ({:.3f} MB/sec)", timer.getMs(),
-           total_bytes / ((1u << 20u) * timer.getSeconds()));
+           write_stats.bytes / ((1u << 20u) * timer.getSeconds()));
 }
 
 /*!
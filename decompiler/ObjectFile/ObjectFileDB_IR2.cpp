@@ -20,6 +20,7 @@
 #include "decompiler/analysis/anonymous_function_def.h"
 #include "common/goos/PrettyPrinter.h"
 #include "decompiler/IR2/Form.h"
+#include "decompiler/util/OutputWriter.h"
 
 namespace decompiler {
 
@@ -286,6 +287,7 @@ void ObjectFileDB::ir2_type_analysis_pass() {
   int non_asm_functions = 0;
   int attempted_functions = 0;
   int successful_functions = 0;
+  int ops_propagated = 0;
 
   for_each_function_def_order([&](Function& func, int segment_id, ObjectFileData& data) {
     (void)segment_id;
@@ -307,7 +309,7 @@ void ObjectFileDB::ir2_type_analysis_pass() {
           func.ir2.env.set_sloppy_pair_typing();
         }
         func.ir2.env.set_stack_var_hints(get_config().stack_var_hints_by_function[func_name]);
-        if (run_type_analysis_ir2(ts, dts, func)) {
+        if (run_type_analysis_ir2(ts, dts, func, &ops_propagated)) {
           successful_functions++;
           func.ir2.env.types_succeeded = true;
         } else {
@@ -321,8 +323,9 @@ void ObjectFileDB::ir2_type_analysis_pass() {
     }
   });
 
-  lg::info("{}/{}/{}/{} (success/attempted/non-asm/total) in {:.2f} ms\n", successful_functions,
-           attempted_functions, non_asm_functions, total_functions, timer.getMs());
+  lg::info("{}/{}/{}/{} (success/attempted/non-asm/total) in {:.2f} ms ({} ops propagated)\n",
+           successful_functions, attempted_functions, non_asm_functions, total_functions,
+           timer.getMs(), ops_propagated);
 }
 
 void ObjectFileDB::ir2_register_usage_pass() {
@@ -509,24 +512,24 @@ void ObjectFileDB::ir2_insert_anonymous_functions() {
 void ObjectFileDB::ir2_write_results(const std::string& output_dir) {
   Timer timer;
   lg::info("Writing IR2 results to file...");
-  int total_files = 0;
-  int total_bytes = 0;
+  int total_objs = 0;
+  // formatting happens here, the writer only does the file I/O.
+  OutputWriter writer;
   for_each_obj([&](ObjectFileData& obj) {
     if (obj.linked_data.has_any_functions()) {
-      // todo
-      total_files++;
-      auto file_text = ir2_to_file(obj);
-      total_bytes += file_text.length();
+      total_objs++;
       auto file_name = file_util::combine_path(output_dir, obj.to_unique_name() + "_ir2.asm");
-      file_util::write_text_file(file_name, file_text);
+      writer.write(file_name, ir2_to_file(obj));
 
-      auto final = ir2_final_out(obj);
       auto final_name = file_util::combine_path(output_dir, obj.to_unique_name() + "_disasm.gc");
-      file_util::write_text_file(final_name, final);
+      writer.write(final_name, ir2_final_out(obj));
     }
   });
-  lg::info("Wrote {} files ({:.2f} MB) in {:.2f} ms\n", total_files, total_bytes / float(1 << 20),
-           timer.getMs());
+  auto write_stats = writer.finish();
+  lg::info("Wrote IR2 results for {} objects ({} files changed, {} unchanged)", total_objs,
+           write_stats.files_written, write_stats.files_unchanged);
+  lg::info("Wrote {:.2f} MB in {:.2f} ms ({:.3f} MB/sec)\n", write_stats.bytes / float(1 << 20),
+           timer.getMs(), write_stats.bytes / ((1u << 20u) * timer.getSeconds()));
 }
 
 std::string ObjectFileDB::ir2_to_file(ObjectFileData& data) {
@@ -168,32 +168,35 @@ std::string write_from_top_level(const Function& top_level,
   // (set! identity L312)
   constexpr int func_name = 1;
   constexpr int label = 2;
-  Matcher function_def_matcher =
+  static const Matcher function_def_matcher =
       Matcher::set(Matcher::any_symbol(func_name), Matcher::any_label(label));
 
   // (method-set! vec4s 3 L352)
   constexpr int type_name = 1;
   //  constexpr int method_id = 2;
   constexpr int method_label = 3;
-  Matcher method_def_matcher = Matcher::op(
+  static const Matcher method_def_matcher = Matcher::op(
       GenericOpMatcher::func(Matcher::symbol("method-set!")),
       {Matcher::any_symbol(type_name), Matcher::integer({}), Matcher::any_label(method_label)});
 
   // (type-new 'vec4s uint128 (the-as int (l.d L366)))
-  Matcher deftype_matcher =
+  static const Matcher deftype_matcher =
       Matcher::op_with_rest(GenericOpMatcher::fixed(FixedOperatorKind::TYPE_NEW),
                             {Matcher::any_quoted_symbol(type_name)});
 
   // (if *debug-segment* (set! mem-print L347) (set! mem-print nothing))
-  auto debug_seg_matcher = Matcher::op(GenericOpMatcher::condition(IR2_Condition::Kind::TRUTHY),
-                                       {Matcher::symbol("*debug-segment*")});
-  auto debug_def_matcher = Matcher::set(Matcher::any_symbol(0), Matcher::any_label(1));
-  auto non_debug_def_matcher = Matcher::set(Matcher::any_symbol(2), Matcher::symbol("nothing"));
-  auto defun_debug_matcher =
+  static const auto debug_seg_matcher =
+      Matcher::op(GenericOpMatcher::condition(IR2_Condition::Kind::TRUTHY),
+                  {Matcher::symbol("*debug-segment*")});
+  static const auto debug_def_matcher =
+      Matcher::set(Matcher::any_symbol(0), Matcher::any_label(1));
+  static const auto non_debug_def_matcher =
+      Matcher::set(Matcher::any_symbol(2), Matcher::symbol("nothing"));
+  static const auto defun_debug_matcher =
       Matcher::if_with_else(debug_seg_matcher, debug_def_matcher, non_debug_def_matcher);
 
   // (set! sym-val <expr>)
-  auto define_symbol_matcher = Matcher::set(Matcher::any_symbol(0), Matcher::any(1));
+  static const auto define_symbol_matcher = Matcher::set(Matcher::any_symbol(0), Matcher::any(1));
 
   for (auto& x : top_form->elts()) {
     bool something_matched = false;
@@ -116,7 +116,7 @@ FormElement* rewrite_as_dotimes(LetElement* in, const Env& env, FormPool& pool)
 
   // still have to check body for the increment and have to check that the lt operates on the right
   // thing.
-  Matcher while_matcher =
+  static const Matcher while_matcher =
       Matcher::while_loop(Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::LT),
                                       {Matcher::any_reg(0), Matcher::any(1)}),
                           Matcher::any(2));
@@ -140,7 +140,7 @@ FormElement* rewrite_as_dotimes(LetElement* in, const Env& env, FormPool& pool)
   // kind hacky
   Form fake_form;
   fake_form.elts().push_back(last_in_body);
-  Matcher increment_matcher =
+  static const Matcher increment_matcher =
       Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ADDITION_IN_PLACE),
                   {Matcher::any_reg(0), Matcher::integer(1)});
 
@@ -182,7 +182,7 @@ FormElement* fix_up_abs(LetElement* in, const Env& env, FormPool& pool) {
 
   Form* src = in->entries().at(0).src;
 
-  auto body_matcher =
+  static const auto body_matcher =
       Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ABS), {Matcher::any_reg(0)});
   auto mr = match(body_matcher, in->body());
   if (!mr.matched) {
@@ -236,7 +236,7 @@ FormElement* fix_up_abs_2(LetElement* in, const Env& env, FormPool& pool) {
     return nullptr;
   }
 
-  auto matcher =
+  static const auto matcher =
       Matcher::op(GenericOpMatcher::fixed(FixedOperatorKind::ABS), {Matcher::any_reg(0)});
 
   auto mr = match(matcher, first_as_set->src());
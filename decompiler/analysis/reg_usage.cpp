@@ -1,3 +1,4 @@
+#include <deque>
 #include "reg_usage.h"
 #include "decompiler/Function/Function.h"
 
@@ -8,108 +9,106 @@ RegUsageInfo::RegUsageInfo(int n_blocks, int n_ops) {
 }
 
 namespace {
-bool in_set(RegSet& set, const Register& obj) {
-  return set.find(obj) != set.end();
-}
-
 void phase1(const FunctionAtomicOps& ops, int block_id, RegUsageInfo* out) {
   int end_op = ops.block_id_to_end_atomic_op.at(block_id);
   int start_op = ops.block_id_to_first_atomic_op.at(block_id);
+  auto& block = out->block.at(block_id);
 
   for (int i = end_op; i-- > start_op;) {
     const auto& instr = ops.ops.at(i);
-    auto read = instr->read_regs();
-    auto write = instr->write_regs();
-
     auto& lv = out->op.at(i).live;
     auto& dd = out->op.at(i).dead;
-    auto& block = out->block.at(block_id);
 
     // make all read live out
     lv.clear();
-    for (auto& x : read) {
+    for (auto& x : instr->read_regs()) {
       lv.insert(x);
     }
 
     // kill things which are overwritten
     dd.clear();
-    for (auto& x : write) {
-      if (!in_set(lv, x)) {
+    for (auto& x : instr->write_regs()) {
+      if (!lv.contains(x)) {
         dd.insert(x);
       }
     }
 
-    // b.use = i.liveout
-    RegSet use_old = block.use;
-    block.use.clear();
-    for (auto& x : lv) {
-      block.use.insert(x);
-    }
-    // | (bu.use & !i.dead)
-    for (auto& x : use_old) {
-      if (!in_set(dd, x)) {
-        block.use.insert(x);
-      }
-    }
-
-    // b.defs = i.dead
-    RegSet defs_old = block.defs;
-    block.defs.clear();
-    for (auto& x : dd) {
-      block.defs.insert(x);
-    }
-    // | b.defs & !i.lv
-    for (auto& x : defs_old) {
-      if (!in_set(lv, x)) {
-        block.defs.insert(x);
-      }
-    }
+    // b.use = i.liveout | (b.use & !i.dead)
+    block.use = lv | block.use.without(dd);
+    // b.defs = i.dead | (b.defs & !i.lv)
+    block.defs = dd | block.defs.without(lv);
   }
 }
 
 bool phase2(const std::vector<BasicBlock>& blocks, int block_id, RegUsageInfo* info) {
-  bool changed = false;
   auto& block_info = info->block.at(block_id);
   const auto& block_obj = blocks.at(block_id);
-  auto out = block_info.defs;  // copy
+  auto out = block_info.defs;
 
   for (auto s : {block_obj.succ_branch, block_obj.succ_ft}) {
-    if (s == -1) {
-      continue;
-    }
-    for (auto in : info->block.at(s).input) {
-      out.insert(in);
+    if (s != -1) {
+      out |= info->block.at(s).input;
     }
   }
 
-  RegSet in = block_info.use;
-  for (auto x : out) {
-    if (!in_set(block_info.defs, x)) {
-      in.insert(x);
-    }
-  }
+  auto in = block_info.use | out.without(block_info.defs);
 
   if (in != block_info.input || out != block_info.output) {
-    changed = true;
     block_info.input = in;
     block_info.output = out;
+    return true;
   }
 
-  return changed;
+  return false;
+}
+
+/*!
+ * Order to visit blocks in the backward dataflow: a post order of the CFG from the entry, so
+ * successors are usually done before their predecessors. Unreachable blocks go at the end.
+ */
+std::vector<int> block_post_order(const std::vector<BasicBlock>& blocks) {
+  std::vector<int> order;
+  std::vector<bool> visited(blocks.size(), false);
+  // block, index of next successor to visit
+  std::vector<std::pair<int, int>> stack;
+
+  auto visit_from = [&](int root) {
+    visited.at(root) = true;
+    stack.push_back({root, 0});
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      const auto& block = blocks.at(top.first);
+      int succs[2] = {block.succ_branch, block.succ_ft};
+      if (top.second < 2) {
+        int succ = succs[top.second++];
+        if (succ != -1 && !visited.at(succ)) {
+          visited.at(succ) = true;
+          stack.push_back({succ, 0});
+        }
+      } else {
+        order.push_back(top.first);
+        stack.pop_back();
+      }
+    }
+  };
+
+  for (int i = 0; i < int(blocks.size()); i++) {
+    if (!visited.at(i)) {
+      visit_from(i);
+    }
+  }
+  return order;
 }
 
 void phase3(const FunctionAtomicOps& ops,
             const std::vector<BasicBlock>& blocks,
             int block_id,
             RegUsageInfo* info) {
-  RegSet live_local;
+  RegBitSet live_local;
   const auto& block_obj = blocks.at(block_id);
   for (auto s : {block_obj.succ_branch, block_obj.succ_ft}) {
-    if (s == -1) {
-      continue;
-    }
-    for (auto i : info->block.at(s).input) {
-      live_local.insert(i);
+    if (s != -1) {
+      live_local |= info->block.at(s).input;
     }
   }
 
@@ -120,12 +119,7 @@ void phase3(const FunctionAtomicOps& ops,
     auto& lv = info->op.at(i).live;
     auto& dd = info->op.at(i).dead;
 
-    RegSet new_live = lv;
-    for (auto x : live_local) {
-      if (!in_set(dd, x)) {
-        new_live.insert(x);
-      }
-    }
+    RegBitSet new_live = lv | live_local.without(dd);
     lv = live_local;
     live_local = new_live;
   }
@@ -141,15 +135,36 @@ RegUsageInfo analyze_ir2_register_usage(const Function& function) {
     phase1(*ops, i, &result);
   }
 
-  bool changed = false;
-  do {
-    changed = false;
-    for (int i = 0; i < int(blocks.size()); i++) {
-      if (phase2(blocks, i, &result)) {
-        changed = true;
+  // solve for block input/output with a worklist. When the input of a block changes, only its
+  // predecessors need to be looked at again.
+  std::vector<std::vector<int>> preds(blocks.size());
+  for (int i = 0; i < int(blocks.size()); i++) {
+    for (auto s : {blocks.at(i).succ_branch, blocks.at(i).succ_ft}) {
+      if (s != -1) {
+        preds.at(s).push_back(i);
+      }
+    }
+  }
+
+  std::deque<int> worklist;
+  std::vector<bool> in_worklist(blocks.size(), true);
+  for (auto block_id : block_post_order(blocks)) {
+    worklist.push_back(block_id);
+  }
+
+  while (!worklist.empty()) {
+    int block_id = worklist.front();
+    worklist.pop_front();
+    in_worklist.at(block_id) = false;
+    if (phase2(blocks, block_id, &result)) {
+      for (auto pred : preds.at(block_id)) {
+        if (!in_worklist.at(pred)) {
+          in_worklist.at(pred) = true;
+          worklist.push_back(pred);
+        }
       }
     }
-  } while (changed);
+  }
 
   for (int i = 0; i < int(blocks.size()); i++) {
     phase3(*ops, blocks, i, &result);
@@ -169,20 +184,20 @@ RegUsageInfo analyze_ir2_register_usage(const Function& function) {
       for (auto succ : {blocks.at(block_id).succ_branch, blocks.at(block_id).succ_ft}) {
         if (succ != -1) {
           auto succ_id = ops->block_id_to_first_atomic_op.at(succ);  // todo?
-          result.op.at(succ_id).live_in.insert(last_live_out.begin(), last_live_out.end());
+          result.op.at(succ_id).live_in |= last_live_out;
         }
       }
     }
   }
 
   // special case for the very first op
-  auto& first_op_live_out = result.op.at(0).live;
-  RegSet first_op_live_in;
-  first_op_live_in.insert(first_op_live_out.begin(), first_op_live_out.end());
+  RegBitSet first_op_live_in = result.op.at(0).live;
   for (auto reg : ops->ops.at(0)->write_regs()) {
     first_op_live_in.erase(reg);
   }
-  first_op_live_in.insert(ops->ops.at(0)->read_regs().begin(), ops->ops.at(0)->read_regs().end());
+  for (auto reg : ops->ops.at(0)->read_regs()) {
+    first_op_live_in.insert(reg);
+  }
   result.op.at(0).live_in = first_op_live_in;
 
   // we want to know if an op "consumes" a register.
@@ -196,7 +211,7 @@ RegUsageInfo analyze_ir2_register_usage(const Function& function) {
 
     // look at each register we read from:
     for (auto reg : op->read_regs()) {
-      if (op_info.live.find(reg) == op_info.live.end()) {
+      if (!op_info.live.contains(reg)) {
         // not live out, this means we must consume it.
         op_info.consumes.insert(reg);
       } else {
@@ -211,7 +226,7 @@ RegUsageInfo analyze_ir2_register_usage(const Function& function) {
 
     // also useful to know, written and unused.
     for (auto reg : op->write_regs()) {
-      if (op_info.live.find(reg) == op_info.live.end()) {
+      if (!op_info.live.contains(reg)) {
         // fmt::print("op {} wau {}\n", op->to_string(function.ir2.env), reg.to_string());
         op_info.written_and_unused.insert(reg);
       }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bitset>
+#include <cstdint>
 #include <vector>
 #include <unordered_set>
 #include "decompiler/Disasm/Register.h"
@@ -10,13 +12,118 @@ class Function;
 
 using RegSet = std::unordered_set<Register, Register::hash>;
 
+/*!
+ * A set of registers, stored as one bit per register.
+ * The register file is small, so the whole set is a few words and the set operations used by the
+ * liveness analysis are a handful of word operations. Iterates in order of Register::index().
+ */
+class RegBitSet {
+ public:
+  static constexpr int WORD_COUNT = (Register::MAX_INDEX + 63) / 64;
+
+  class Iterator {
+   public:
+    Iterator(const uint64_t* words, int idx) : m_words(words), m_idx(idx) { skip_zeros(); }
+    Register operator*() const { return Register::from_index(m_idx); }
+    Iterator& operator++() {
+      m_idx++;
+      skip_zeros();
+      return *this;
+    }
+    bool operator!=(const Iterator& other) const { return m_idx != other.m_idx; }
+
+   private:
+    void skip_zeros() {
+      while (m_idx < WORD_COUNT * 64) {
+        uint64_t remaining = m_words[m_idx / 64] >> (m_idx % 64);
+        if (remaining) {
+          // count the zeros below the lowest set bit.
+          m_idx += std::bitset<64>((remaining & (~remaining + 1)) - 1).count();
+          return;
+        }
+        m_idx = (m_idx / 64 + 1) * 64;
+      }
+    }
+    const uint64_t* m_words = nullptr;
+    int m_idx = 0;
+  };
+
+  void insert(Register reg) { m_words[reg.index() / 64] |= bit(reg); }
+  void erase(Register reg) { m_words[reg.index() / 64] &= ~bit(reg); }
+  bool contains(Register reg) const { return m_words[reg.index() / 64] & bit(reg); }
+
+  void clear() {
+    for (auto& w : m_words) {
+      w = 0;
+    }
+  }
+
+  bool empty() const {
+    uint64_t any = 0;
+    for (auto w : m_words) {
+      any |= w;
+    }
+    return !any;
+  }
+
+  int size() const {
+    int count = 0;
+    for (auto w : m_words) {
+      count += std::bitset<64>(w).count();
+    }
+    return count;
+  }
+
+  RegBitSet& operator|=(const RegBitSet& other) {
+    for (int i = 0; i < WORD_COUNT; i++) {
+      m_words[i] |= other.m_words[i];
+    }
+    return *this;
+  }
+
+  RegBitSet operator|(const RegBitSet& other) const {
+    RegBitSet result = *this;
+    result |= other;
+    return result;
+  }
+
+  /*!
+   * The registers in this set that are not in other.
+   */
+  RegBitSet without(const RegBitSet& other) const {
+    RegBitSet result;
+    for (int i = 0; i < WORD_COUNT; i++) {
+      result.m_words[i] = m_words[i] & ~other.m_words[i];
+    }
+    return result;
+  }
+
+  bool operator==(const RegBitSet& other) const {
+    for (int i = 0; i < WORD_COUNT; i++) {
+      if (m_words[i] != other.m_words[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool operator!=(const RegBitSet& other) const { return !(*this == other); }
+
+  Iterator begin() const { return Iterator(m_words, 0); }
+  Iterator end() const { return Iterator(m_words, WORD_COUNT * 64); }
+
+ private:
+  static uint64_t bit(Register reg) { return uint64_t(1) << (reg.index() % 64); }
+  uint64_t m_words[WORD_COUNT] = {};
+};
+
 struct RegUsageInfo {
   struct PerBlock {
-    RegSet use, defs, input, output;
+    RegBitSet use, defs, input, output;
   };
 
   struct PerOp {
-    RegSet live, dead, consumes, written_and_unused, live_in;
+    RegBitSet live, dead, live_in;
+    RegSet consumes, written_and_unused;
   };
 
   int block_count() const { return int(block.size()); }
@@ -29,4 +136,4 @@ struct RegUsageInfo {
 };
 
 RegUsageInfo analyze_ir2_register_usage(const Function& function);
-}  // namespace decompiler
\ No newline at end of file
+}  // namespace decompiler
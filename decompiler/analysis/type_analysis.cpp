@@ -63,7 +63,10 @@ void try_modify_input_types_for_casts(
 }
 }  // namespace
 
-bool run_type_analysis_ir2(const TypeSpec& my_type, DecompilerTypeSystem& dts, Function& func) {
+bool run_type_analysis_ir2(const TypeSpec& my_type,
+                           DecompilerTypeSystem& dts,
+                           Function& func,
+                           int* ops_propagated) {
   // STEP 0 - set decompiler type system settings for this function. In config we can manually
   if (func.guessed_name.kind == FunctionName::FunctionKind::METHOD) {
     dts.type_prop_settings.current_method_type = func.guessed_name.type_name;
@@ -90,28 +93,48 @@ bool run_type_analysis_ir2(const TypeSpec& my_type, DecompilerTypeSystem& dts, F
   // STEP 2 - initialize type state for the first block to the function argument types.
   block_init_types.at(0) = construct_initial_typestate(my_type);
 
-  // STEP 3 - propagate types until the result stops changing
+  // STEP 3 - propagate types until the result stops changing.
+  // A block only needs to run again if the types at its entry changed. Each sweep runs the blocks
+  // that need it in topological order, so a block changed by an earlier block runs in the same
+  // sweep, and a block changed by a loop back edge runs in the next one.
+  const auto& casts = func.ir2.env.casts();
+  std::vector<bool> needs_run(func.basic_blocks.size(), false);
+  for (auto block_id : order.vist_order) {
+    needs_run.at(block_id) = true;
+  }
+
   bool run_again = true;
   while (run_again) {
     run_again = false;
     // do each block in the topological sort order:
     for (auto block_id : order.vist_order) {
+      if (!needs_run.at(block_id)) {
+        continue;
+      }
+      needs_run.at(block_id) = false;
+
       auto& block = func.basic_blocks.at(block_id);
       TypeState* init_types = &block_init_types.at(block_id);
       for (int op_id = aop->block_id_to_first_atomic_op.at(block_id);
            op_id < aop->block_id_to_end_atomic_op.at(block_id); op_id++) {
+        auto op_casts = casts.empty() ? casts.end() : casts.find(op_id);
         std::unordered_map<Register, TP_Type, Register::hash> restore_cast_types;
-        try_modify_input_types_for_casts(op_id, func.ir2.env.casts(), init_types,
-                                         &restore_cast_types, dts);
+        if (op_casts != casts.end()) {
+          modify_input_types_for_casts(op_casts->second, init_types, &restore_cast_types, dts);
+        }
 
         auto& op = aop->ops.at(op_id);
 
         try {
           op_types.at(op_id) = op->propagate_types(*init_types, func.ir2.env, dts);
+          if (ops_propagated) {
+            (*ops_propagated)++;
+          }
         } catch (std::runtime_error& e) {
           lg::warn("Function {} failed type prop: {}", func.guessed_name.to_string(), e.what());
           func.warnings.type_prop_warning("{}", e.what());
-          func.ir2.env.set_types(block_init_types, op_types, *func.ir2.atomic_ops, my_type);
+          func.ir2.env.set_types(std::move(block_init_types), std::move(op_types),
+                                 *func.ir2.atomic_ops, my_type);
           return false;
         }
 
@@ -135,6 +158,7 @@ bool run_type_analysis_ir2(const TypeSpec& my_type, DecompilerTypeSystem& dts, F
           // set types to LCA (current, new)
           if (dts.tp_lca(&block_init_types.at(succ_block_id), *init_types)) {
             // if something changed, run again!
+            needs_run.at(succ_block_id) = true;
             run_again = true;
           }
         }
@@ -162,7 +186,8 @@ bool run_type_analysis_ir2(const TypeSpec& my_type, DecompilerTypeSystem& dts, F
     }
   }
 
-  func.ir2.env.set_types(block_init_types, op_types, *func.ir2.atomic_ops, my_type);
+  func.ir2.env.set_types(std::move(block_init_types), std::move(op_types), *func.ir2.atomic_ops,
+                         my_type);
 
   return true;
 }
@@ -9,5 +9,12 @@
 #include "decompiler/ObjectFile/LinkedObjectFile.h"
 
 namespace decompiler {
-bool run_type_analysis_ir2(const TypeSpec& my_type, DecompilerTypeSystem& dts, Function& func);
+/*!
+ * Propagate types through the function. If ops_propagated is set, it is incremented by the number
+ * of times an op had its types propagated.
+ */
+bool run_type_analysis_ir2(const TypeSpec& my_type,
+                           DecompilerTypeSystem& dts,
+                           Function& func,
+                           int* ops_propagated = nullptr);
 }
\ No newline at end of file
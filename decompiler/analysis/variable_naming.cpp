@@ -28,6 +28,7 @@ VarSSA VarMapSSA::allocate(Register reg) {
   Entry new_entry;
   new_entry.reg = reg;
   new_entry.entry_id = int(m_entries.size());
+  new_entry.parent = new_entry.entry_id;
   new_entry.var_id = get_next_var_id(reg);
   VarSSA result(reg, new_entry.entry_id);
   m_entries.push_back(new_entry);
@@ -42,6 +43,7 @@ VarSSA VarMapSSA::allocate_init_phi(Register reg, int block_id) {
   Entry new_entry;
   new_entry.reg = reg;
   new_entry.entry_id = int(m_entries.size());
+  new_entry.parent = new_entry.entry_id;
   new_entry.var_id = -block_id;
   VarSSA result(reg, new_entry.entry_id);
   m_entries.push_back(new_entry);
@@ -55,61 +57,63 @@ int VarMapSSA::get_next_var_id(Register reg) {
   return ++m_reg_next_id[reg];
 }
 
+/*!
+ * Find the entry which holds the var_id for the variable containing the given entry.
+ * Variables are sets of entries, stored as a union-find forest.
+ */
+int VarMapSSA::root(int entry_id) const {
+  while (m_entries[entry_id].parent != entry_id) {
+    entry_id = m_entries[entry_id].parent;
+  }
+  return entry_id;
+}
+
+/*!
+ * Combine the variables with the given roots into one, with the given var_id.
+ */
+void VarMapSSA::join(int root_a, int root_b, int var_id) {
+  auto* a = &m_entries.at(root_a);
+  auto* b = &m_entries.at(root_b);
+  assert(a->reg == b->reg);
+  if (a->size < b->size) {
+    std::swap(a, b);
+  }
+  b->parent = a->entry_id;
+  a->size += b->size;
+  a->var_id = var_id;
+}
+
 /*!
  * Combine the two variables into one. The final name is:
  * - B0, if either is B0
  * - otherwise b's name.
  */
 void VarMapSSA::merge(const VarSSA& var_a, const VarSSA& var_b) {
-  auto& a = m_entries.at(var_a.m_entry_id);
-  auto b = m_entries.at(var_b.m_entry_id);
-  assert(a.reg == b.reg);
-  if (b.var_id == 0) {
-    //    fmt::print("Merge {} <- {}\n", to_string(var_b), to_string(var_a));
-
-    for (auto& entry : m_entries) {
-      if (entry.var_id == a.var_id && entry.reg == a.reg) {
-        entry.var_id = b.var_id;
-      }
-    }
-    a.var_id = b.var_id;
-  } else {
-    //    fmt::print("Merge {} <- {}\n", to_string(var_a), to_string(var_b));
-
-    for (auto& entry : m_entries) {
-      if (entry.var_id == b.var_id && entry.reg == b.reg) {
-        entry.var_id = a.var_id;
-      }
-    }
-    b.var_id = a.var_id;
+  int a = root(var_a.m_entry_id);
+  int b = root(var_b.m_entry_id);
+  if (a == b) {
+    return;
   }
+  //    fmt::print("Merge {} <- {}\n", to_string(var_b), to_string(var_a));
+  int b_id = m_entries.at(b).var_id;
+  join(a, b, b_id == 0 ? b_id : m_entries.at(a).var_id);
 }
 
 /*!
  * Make all Bs A.
  */
 void VarMapSSA::merge_to_first(const VarSSA& var_a, const VarSSA& var_b) {
-  auto& a = m_entries.at(var_a.m_entry_id);
-  auto b = m_entries.at(var_b.m_entry_id);
-
+  int a = root(var_a.m_entry_id);
+  int b = root(var_b.m_entry_id);
   //  fmt::print("Merge-to-first {} <- {}\n", to_string(var_a), to_string(var_b));
-  assert(a.reg == b.reg);
-
-  //  for (auto& entry : m_entries) {
-  for (size_t i = 0; i < m_entries.size(); i++) {
-    auto& entry = m_entries.at(i);
-    if (entry.var_id == b.var_id && entry.reg == b.reg) {
-      //      fmt::print("remap extra {} var_id from {} to {}\n", i, entry.var_id, a.var_id);
-      entry.var_id = a.var_id;
-    } else {
-      //      fmt::print("no remap at {} (prev is {} {})\n", i, entry.reg.to_charp(), entry.var_id);
-    }
+  if (a == b) {
+    return;
   }
-  b.var_id = a.var_id;
+  join(a, b, m_entries.at(a).var_id);
 }
 
 std::string VarMapSSA::to_string(const VarSSA& var) const {
-  auto var_id = m_entries.at(var.m_entry_id).var_id;
+  auto var_id = this->var_id(var);
   if (var_id > 0) {
     return fmt::format("{}-{}", var.m_reg.to_charp(), var_id);
   } else {
@@ -121,15 +125,14 @@ std::string VarMapSSA::to_string(const VarSSA& var) const {
  * Do these two SSA variables represent the same "program variable"
  */
 bool VarMapSSA::same(const VarSSA& var_a, const VarSSA& var_b) const {
-  return var_a.m_reg == var_b.m_reg &&
-         m_entries.at(var_a.m_entry_id).var_id == m_entries.at(var_b.m_entry_id).var_id;
+  return var_a.m_reg == var_b.m_reg && var_id(var_a) == var_id(var_b);
 }
 
 /*!
  * Get program variable ID from an SSA variable.
  */
 int VarMapSSA::var_id(const VarSSA& var) const {
-  return m_entries.at(var.m_entry_id).var_id;
+  return m_entries.at(root(var.m_entry_id)).var_id;
 }
 
 /*!
@@ -141,7 +144,7 @@ int VarMapSSA::var_id(const VarSSA& var) const {
  */
 void VarMapSSA::remap_reg(Register reg, const std::unordered_map<int, int>& remap) {
   for (auto& entry : m_entries) {
-    if (entry.reg == reg) {
+    if (entry.reg == reg && entry.parent == entry.entry_id) {
       auto kv = remap.find(entry.var_id);
       if (kv == remap.end()) {
         entry.var_id = INT32_MIN;
@@ -154,7 +157,8 @@ void VarMapSSA::remap_reg(Register reg, const std::unordered_map<int, int>& rema
 
 void VarMapSSA::debug_print_map() const {
   for (auto& entry : m_entries) {
-    fmt::print("[{:02d}] {} {}\n", entry.entry_id, entry.reg.to_charp(), entry.var_id);
+    fmt::print("[{:02d}] {} {}\n", entry.entry_id, entry.reg.to_charp(),
+               m_entries.at(root(entry.entry_id)).var_id);
   }
 }
 
@@ -80,10 +80,14 @@ class VarMapSSA {
 
  private:
   int get_next_var_id(Register reg);
+  int root(int entry_id) const;
+  void join(int root_a, int root_b, int var_id);
 
   struct Entry {
-    int var_id = -1;
+    int var_id = -1;  // only valid on the root entry of a variable
     int entry_id = -1;
+    int parent = -1;  // next entry toward the root, or ourself if we are the root
+    int size = 1;     // entries in our tree, if we are the root
     Register reg;
   };
 
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include "OutputWriter.h"
+#include "common/util/FileUtil.h"
+
+namespace decompiler {
+
+OutputWriter::OutputWriter() {
+  unsigned thread_count = std::min(std::max(1u, std::thread::hardware_concurrency()), MAX_THREADS);
+  for (unsigned i = 0; i < thread_count; i++) {
+    m_threads.emplace_back([this]() { run(); });
+  }
+}
+
+OutputWriter::~OutputWriter() {
+  stop();
+}
+
+/*!
+ * Let the I/O threads finish the queue, then wait for them to exit.
+ */
+void OutputWriter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+  }
+  m_work_cv.notify_all();
+  for (auto& t : m_threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+/*!
+ * Add a file to the queue. Blocks if too much data is already waiting to be written.
+ */
+void OutputWriter::write(std::string file_name, std::string text) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_space_cv.wait(lock, [&]() {
+    return m_queued_bytes == 0 || m_queued_bytes + text.size() <= MAX_QUEUED_BYTES;
+  });
+  m_queued_bytes += text.size();
+  m_queue.emplace_back(std::move(file_name), std::move(text));
+  lock.unlock();
+  m_work_cv.notify_one();
+}
+
+/*!
+ * Wait for all files to be written and stop the I/O threads.
+ * Rethrows the first error from writing a file.
+ */
+OutputWriter::Stats OutputWriter::finish() {
+  stop();
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+  return m_stats;
+}
+
+void OutputWriter::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_work_cv.wait(lock, [&]() { return m_done || !m_queue.empty(); });
+    if (m_queue.empty()) {
+      return;
+    }
+
+    auto file = std::move(m_queue.front());
+    m_queue.pop_front();
+    bool failed = m_error != nullptr;
+    lock.unlock();
+
+    bool written = false;
+    std::exception_ptr error;
+    if (!failed) {
+      try {
+        written = file_util::write_text_file_if_changed(file.first, file.second);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+
+    lock.lock();
+    if (error && !m_error) {
+      m_error = error;
+    }
+    if (written) {
+      m_stats.files_written++;
+    } else {
+      m_stats.files_unchanged++;
+    }
+    m_stats.bytes += file.second.size();
+    m_queued_bytes -= file.second.size();
+    m_space_cv.notify_all();
+  }
+}
+}  // namespace decompiler
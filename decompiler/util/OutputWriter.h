@@ -0,0 +1,59 @@
+#pragma once
+
+/*!
+ * @file OutputWriter.h
+ * Writes decompiler output files from background threads.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace decompiler {
+/*!
+ * Queue of text files to write. Files are written by a few I/O threads, so the caller can format
+ * the next file while earlier ones are written. Files may finish in any order, so each file should
+ * be added once. Files whose contents haven't changed are not rewritten.
+ * write can be called from multiple threads.
+ */
+class OutputWriter {
+ public:
+  struct Stats {
+    int files_written = 0;
+    int files_unchanged = 0;
+    size_t bytes = 0;
+  };
+
+  OutputWriter();
+  ~OutputWriter();
+  OutputWriter(const OutputWriter&) = delete;
+  OutputWriter& operator=(const OutputWriter&) = delete;
+
+  void write(std::string file_name, std::string text);
+  Stats finish();
+
+ private:
+  void run();
+
+  void stop();
+
+  // stop accepting new files when this much is waiting to be written
+  static constexpr size_t MAX_QUEUED_BYTES = 256 * 1024 * 1024;
+  static constexpr unsigned MAX_THREADS = 4;
+
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_space_cv;
+  std::deque<std::pair<std::string, std::string>> m_queue;
+  size_t m_queued_bytes = 0;
+  bool m_done = false;
+  Stats m_stats;
+  std::exception_ptr m_error;
+  std::vector<std::thread> m_threads;
+};
+}  // namespace decompiler
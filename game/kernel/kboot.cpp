@@ -5,14 +5,13 @@
  */
 
 #include <cstring>
-#include <chrono>
 #include <stdio.h>
 #include <stdlib.h>
-#include <thread>
 
 #include "common/common_types.h"
 #include "common/util/Timer.h"
 #include "game/sce/libscf.h"
+#include "game/system/frame_stats.h"
 #include "kboot.h"
 #include "kmachine.h"
 #include "kscheme.h"
@@ -139,7 +138,9 @@ void KernelCheckAndDispatch() {
 
   while (!MasterExit) {
     // try to get a message from the listener, and process it if needed
+    Timer listener_timer;
     Ptr<char> new_message = WaitForMessageAndAck();
+    auto listener_ms = listener_timer.getMs();
     if (new_message.offset) {
       ProcessListenerMessage(new_message);
     }
@@ -180,7 +181,8 @@ void KernelCheckAndDispatch() {
       SendAck();
     }
 
-    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+    // record frame times and wait for the frame limiter.
+    frame_stats_finish_frame(listener_ms, time_ms);
   }
 }
 
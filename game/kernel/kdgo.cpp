@@ -18,6 +18,8 @@
 #include "game/common/play_rpc_types.h"
 #include "game/common/str_rpc_types.h"
 #include "common/log/log.h"
+#include "common/util/Timer.h"
+#include "game/system/frame_stats.h"
 
 using namespace ee;
 
@@ -92,6 +94,7 @@ u32 RpcBusy(s32 channel) {
  */
 void RpcSync(s32 channel) {
   if (RpcBusy(channel)) {
+    Timer stall_timer;
     if (sShowStallMsg) {
       Msg(6, "STALL: [kernel] waiting for IOP on RPC port #%d\n", channel);
     }
@@ -102,6 +105,7 @@ void RpcSync(s32 channel) {
         i++;
       }
     }
+    frame_stats_add_rpc_wait(stall_timer.getMs());
   }
 }
 
@@ -317,6 +321,7 @@ void load_and_link_dgo(u64 name_gstr, u64 heap_info, u64 flag, u64 buffer_size)
 void load_and_link_dgo_from_c(const char* name, Ptr<kheapinfo> heap, u32 linkFlag, s32 bufferSize) {
   lg::debug("[Load and Link DGO From C] {}", name);
   u32 oldShowStall = sShowStallMsg;
+  auto oldLedgerGroup = kmalloc_ledger_set_group(name);
 
   // remember where the heap top point is so we can clear temporary allocations
   auto oldHeapTop = heap->top;
@@ -373,4 +378,5 @@ void load_and_link_dgo_from_c(const char* name, Ptr<kheapinfo> heap, u32 linkFla
     }
   }
   sShowStallMsg = oldShowStall;
+  kmalloc_ledger_set_group(oldLedgerGroup);
 }
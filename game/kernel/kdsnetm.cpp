@@ -7,6 +7,7 @@
 #include <cstring>
 #include <cstdio>
 #include <cassert>
+#include <algorithm>
 #include "game/sce/deci2.h"
 #include "game/system/deci_common.h"  // todo, reorganize to avoid this include
 #include "kdsnetm.h"
@@ -82,6 +83,10 @@ void GoalProtoHandler(int event, int param, void* opt) {
   switch (event) {
     // get some data - param is the size
     case DECI2_READ:
+      // a message arrives in several reads if it's large. If one part failed, ignore the rest.
+      if (pb->receive_error) {
+        break;
+      }
       // sanity check the size
       if (pb->receive_progress + param <= (int)DEBUG_MESSAGE_BUFFER_SIZE) {
         // actually get data from DECI2
@@ -90,16 +95,14 @@ void GoalProtoHandler(int event, int param, void* opt) {
 
         if (received < 0) {
           // receive failure
-          pb->last_receive_size = -1;
-          protoBlock.receive_progress = 0;  // why use protoBlock instead of pb here?
+          pb->receive_error = true;
           printf("gproto: read error with sceDeci2ExRecv\n");
         } else {
           pb->receive_progress += received;
         }
       } else {
         // size was too large
-        pb->last_receive_size = -1;
-        protoBlock.receive_progress = 0;  // why use protoBlock here?
+        pb->receive_error = true;
         printf("gproto: read error, message too large!\n");
       }
       break;
@@ -107,27 +110,35 @@ void GoalProtoHandler(int event, int param, void* opt) {
     // read is finished!
     case DECI2_READDONE:
       // set last_receive_size to indicate that there is a pending message in the buffer.
-      pb->last_receive_size = pb->receive_progress;
+      // a failed message is passed on as RECEIVE_FAILED, so it is released like any other.
+      pb->last_receive_size = (pb->receive_error || !pb->receive_progress)
+                                  ? GoalProtoBlock::RECEIVE_FAILED
+                                  : pb->receive_progress;
       pb->receive_progress = 0;
+      pb->receive_error = false;
       break;
 
     // send some data
-    case DECI2_WRITE: {
-      // note that we should not attempt to send more than 0xffff bytes at a time, or this will be
-      // wrong.  This is correctly checked for prints, but not for outputs.
-      assert(pb->send_remaining < 0xffff);
-      // why and it with 0xffff?  Seems like saturation would be better.  Either way some data
-      // will be lost, so I guess it doesn't matter.
-      s32 sent = sceDeci2ExSend(pb->socket, (void*)pb->send_ptr, pb->send_remaining & 0xffff);
-      if (sent < 0) {
-        // if we got an error, put it in send status, signaling a send error (negative)
-        pb->send_status = sent;
-      } else {
+    case DECI2_WRITE:
+      // DECI2 sends are at most 0xffff bytes, so larger messages are sent in several parts.
+      while (pb->send_remaining > 0 && pb->send_status > 0) {
+        s32 sent = sceDeci2ExSend(pb->socket, (void*)pb->send_ptr,
+                                  std::min(pb->send_remaining, DECI2_MAX_TRANSFER));
+        if (sent <= 0) {
+          // if we got an error or nothing was sent, stop instead of trying again forever.
+          // put a negative value in send status to signal a send error, and let go of the buffer.
+          // SendFromBufferD will retry the whole message.
+          printf("gproto: write error with sceDeci2ExSend (%d)\n", sent);
+          pb->send_status = sent < 0 ? sent : -1;
+          pb->send_buffer = nullptr;
+          pb->send_ptr = nullptr;
+          break;
+        }
         // otherwise don't touch send status, leave it positive to indicate we're still sending
         pb->send_ptr += sent;
         pb->send_remaining -= sent;
       }
-    } break;
+      break;
 
     // done sending!
     case DECI2_WRITEDONE:
@@ -181,7 +192,6 @@ s32 SendFromBufferD(s32 msg_kind, u64 msg_id, char* data, s32 size) {
 
     // set DECI2 message header
     header->deci2_header.len = protoBlock.send_remaining;
-    header->deci2_header.rsvd = 0;
     header->deci2_header.proto = DECI2_PROTOCOL;
     header->deci2_header.src = 'E';  // from EE
     header->deci2_header.dst = 'H';  // to HOST
@@ -218,5 +228,5 @@ s32 SendFromBufferD(s32 msg_kind, u64 msg_id, char* data, s32 size) {
  */
 void GoalProtoStatus() {
   Msg(6, "gproto: got %d %d\n", protoBlock.most_recent_event, protoBlock.most_recent_param);
-  Msg(6, "gproto: %d %d\n", protoBlock.last_receive_size, protoBlock.send_remaining);
+  Msg(6, "gproto: %d %d\n", protoBlock.last_receive_size.load(), protoBlock.send_remaining);
 }
@@ -9,6 +9,7 @@
 #ifndef JAK_KDSNETM_H
 #define JAK_KDSNETM_H
 
+#include <atomic>
 #include "Ptr.h"
 #include "common/listener_common.h"
 
@@ -21,16 +22,35 @@ struct GoalProtoBlock {
   s32 send_status =
       0;  // positive means send in progress, negative means send error, 0 means complete.
 
-  // size of pending receive to process.
-  s32 last_receive_size = 0;
+  // size of pending receive to process, -1 or 0 if there isn't one, or RECEIVE_FAILED.
+  // Written by the DECI2 thread, read by the kernel.
+  std::atomic<s32> last_receive_size = {0};
   s32 receive_progress = 0;
+  bool receive_error = false;  // the current message failed, drop the rest of it
   u32 most_recent_event = 0;
   u32 most_recent_param = 0;
   u32 msg_kind = 0;
   u64 msg_id = 0;
   Ptr<s32> deci2count;
 
-  void reset() { *this = GoalProtoBlock(); }
+  static constexpr s32 RECEIVE_FAILED = -2;  // a message arrived, but couldn't be received
+
+  void reset() {
+    socket = 0;
+    send_buffer = nullptr;
+    receive_buffer = nullptr;
+    send_ptr = nullptr;
+    send_remaining = 0;
+    send_status = 0;
+    last_receive_size = 0;
+    receive_progress = 0;
+    receive_error = false;
+    most_recent_event = 0;
+    most_recent_param = 0;
+    msg_kind = 0;
+    msg_id = 0;
+    deci2count.offset = 0;
+  }
 };
 
 /*!
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <cassert>
 #include <cstdio>
+#include <vector>
 #include <common/versions.h>
 #include "klink.h"
 #include "fileio.h"
@@ -17,6 +18,9 @@
 #include "kprint.h"
 #include "common/symbols.h"
 #include "common/goal_constants.h"
+#include "common/log/log.h"
+#include "common/util/Timer.h"
+#include "game/system/frame_stats.h"
 
 namespace {
 // turn on printf's for debugging linking issues.
@@ -74,6 +78,8 @@ void link_control::begin(Ptr<uint8_t> object_file,
     m_code_start = object_file;
     m_state = 0;
     m_segment_process = 0;
+    m_link_ms = 0;
+    m_symbol_cache.clear();
 
     ObjectFileHeader* ofh = m_link_block_ptr.cast<ObjectFileHeader>().c();
     if (ofh->goal_version_major != versions::GOAL_VERSION_MAJOR) {
@@ -170,6 +176,8 @@ void link_control::begin(Ptr<uint8_t> object_file,
     m_code_start = object_file;
     m_state = 0;
     m_segment_process = 0;
+    m_link_ms = 0;
+    m_symbol_cache.clear();
 
     const auto* header = (LinkHeaderV2*)(m_link_block_ptr.c() - 4);
 
@@ -236,6 +244,7 @@ void link_control::begin(Ptr<uint8_t> object_file,
  * Make progress on linking.
  */
 uint32_t link_control::work() {
+  Timer link_timer;
   auto old_debug_segment = DebugSegment;
   if (m_keep_debug) {
     DebugSegment = s7.offset + FIX_SYM_TRUE;
@@ -259,30 +268,52 @@ uint32_t link_control::work() {
   }
 
   DebugSegment = old_debug_segment;
+  auto link_ms = link_timer.getMs();
+  m_link_ms += link_ms;
+  frame_stats_add_link(link_ms);
   return rv;
 }
 
+namespace {
+/*!
+ * A single patch from a v3 link table. A segment's link table is decoded into these ahead of time
+ * so the patches can be applied in a tight loop.
+ */
+struct LinkPatchV3 {
+  enum class Kind : u8 { WORD, DWORD, SYMBOL } kind;
+  u32 loc;       // address to patch
+  s32 value;     // value to write. For symbols, the offset from s7.
+  u32 sym_addr;  // for symbols, the value to write if the location holds -1.
+};
+
+// reused between segments so we don't allocate on each link.
+std::vector<LinkPatchV3> link_patches_v3;
+
+/*!
+ * Read a null terminated name from the link table. Returns the length, including the terminator.
+ */
+uint32_t read_link_name_v3(Ptr<uint8_t> link, std::string_view* name) {
+  auto str = (const char*)link.c();
+  auto len = strlen(str);
+  assert(len < 256);
+  *name = std::string_view(str, len);
+  return len + 1;
+}
+
 /*!
- * Link type pointers for a single type in "v3 equivalent" link data
- * Returns a pointer to the link table data after the typelinking data.
+ * Decode type pointers for a single type in "v3 equivalent" link data.
+ * Returns the number of bytes of link table used.
  */
-uint32_t typelink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
+uint32_t typelink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data, std::vector<LinkPatchV3>* patches) {
   // get the name of the type
-  uint32_t seek = 0;
-  char sym_name[256];
-  while (link.c()[seek]) {
-    sym_name[seek] = link.c()[seek];
-    seek++;
-    assert(seek < 256);
-  }
-  sym_name[seek] = 0;
-  seek++;
+  std::string_view sym_name;
+  uint32_t seek = read_link_name_v3(link, &sym_name);
 
   // determine the number of methods
   uint8_t method_count = link.c()[seek++];
 
   // intern the GOAL type, creating the vtable if it doesn't exist.
-  auto type_ptr = intern_type_from_c(sym_name, method_count);
+  auto type_ptr = intern_type_from_c(sym_name.data(), method_count);
 
   // prepare to read the locations of the type pointers
   Ptr<uint32_t> offsets = link.cast<uint32_t>() + seek;
@@ -290,9 +321,10 @@ uint32_t typelink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
   offsets = offsets + 4;
   seek += 4;
 
-  // write the type pointers into memory
+  // the type pointers get written into memory
   for (uint32_t i = 0; i < offset_count; i++) {
-    *(data + offsets.c()[i]).cast<int32_t>() = type_ptr.offset;
+    patches->push_back({LinkPatchV3::Kind::WORD, data.offset + offsets.c()[i],
+                        (s32)type_ptr.offset, 0});
     seek += 4;
   }
 
@@ -300,25 +332,28 @@ uint32_t typelink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
 }
 
 /*!
- * Link symbols (both offsets and pointers) in "v3 equivalent" link data.
- * Returns a pointer to the link table data after the linking data for this symbol.
+ * Decode symbol links (both offsets and pointers) in "v3 equivalent" link data.
+ * Each symbol is only interned once per object file.
+ * Returns the number of bytes of link table used.
  */
-uint32_t symlink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
+uint32_t symlink_v3(Ptr<uint8_t> link,
+                    Ptr<uint8_t> data,
+                    std::unordered_map<std::string_view, u32>* symbol_cache,
+                    std::vector<LinkPatchV3>* patches) {
   // get the symbol name
-  uint32_t seek = 0;
-  char sym_name[256];
-  while (link.c()[seek]) {
-    sym_name[seek] = link.c()[seek];
-    seek++;
-    assert(seek < 256);
-  }
-  sym_name[seek] = 0;
-  seek++;
+  std::string_view sym_name;
+  uint32_t seek = read_link_name_v3(link, &sym_name);
 
   // intern
-  auto sym = intern_from_c(sym_name);
-  int32_t sym_offset = sym.cast<u32>() - s7;
-  uint32_t sym_addr = sym.cast<u32>().offset;
+  auto cached = symbol_cache->find(sym_name);
+  u32 sym_addr;
+  if (cached == symbol_cache->end()) {
+    sym_addr = intern_from_c(sym_name.data()).offset;
+    symbol_cache->insert({sym_name, sym_addr});
+  } else {
+    sym_addr = cached->second;
+  }
+  int32_t sym_offset = sym_addr - s7.offset;
 
   // prepare to read locations of symbol links
   Ptr<uint32_t> offsets = link.cast<uint32_t>() + seek;
@@ -327,29 +362,22 @@ uint32_t symlink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
   seek += 4;
 
   for (uint32_t i = 0; i < offset_count; i++) {
-    uint32_t offset = offsets.c()[i];
+    patches->push_back(
+        {LinkPatchV3::Kind::SYMBOL, data.offset + offsets.c()[i], sym_offset, sym_addr});
     seek += 4;
-    auto data_ptr = (data + offset).cast<int32_t>();
-
-    if (*data_ptr == -1) {
-      // a "-1" indicates that we should store the address.
-      *(data + offset).cast<int32_t>() = sym_addr;
-    } else {
-      // otherwise store the offset to st.  Eventually this should become an s16 instead.
-      *(data + offset).cast<int32_t>() = sym_offset;
-    }
   }
 
   return seek;
 }
 
 /*!
- * Link a single relative offset (used for RIP)
+ * Decode a single relative offset (used for RIP)
  */
 uint32_t cross_seg_dist_link_v3(Ptr<uint8_t> link,
                                 ObjectFileHeader* ofh,
                                 int current_seg,
-                                int size) {
+                                int size,
+                                std::vector<LinkPatchV3>* patches) {
   // target seg, dist into mine, dist into target, patch loc in mine
   uint8_t target_seg = *link;
   assert(target_seg < ofh->segment_count);
@@ -367,15 +395,13 @@ uint32_t cross_seg_dist_link_v3(Ptr<uint8_t> link,
     // method-set! to things that are in unloaded segments and it'll just keep the old method.
     diff = -mine;
   }
-  // printf("link object in seg %d diff %d at %d (%d + %d)\n", target_seg, diff, offset_of_patch,
-  // link_data[2], ofh->code_infos[current_seg].offset);
 
   // both 32-bit and 64-bit pointer links are supported, though 64-bit ones are no longer in use.
   // we still support it just in case we want to run ancient code.
   if (size == 4) {
-    *Ptr<int32_t>(offset_of_patch).c() = diff;
+    patches->push_back({LinkPatchV3::Kind::WORD, offset_of_patch, diff, 0});
   } else if (size == 8) {
-    *Ptr<int64_t>(offset_of_patch).c() = diff;
+    patches->push_back({LinkPatchV3::Kind::DWORD, offset_of_patch, diff, 0});
   } else {
     assert(false);
   }
@@ -383,14 +409,40 @@ uint32_t cross_seg_dist_link_v3(Ptr<uint8_t> link,
   return 1 + 3 * 4;
 }
 
-uint32_t ptr_link_v3(Ptr<u8> link, ObjectFileHeader* ofh, int current_seg) {
+uint32_t ptr_link_v3(Ptr<u8> link,
+                     ObjectFileHeader* ofh,
+                     int current_seg,
+                     std::vector<LinkPatchV3>* patches) {
   auto* link_data = link.cast<u32>().c();
   u32 patch_loc = link_data[0] + ofh->code_infos[current_seg].offset;
   u32 patch_value = link_data[1] + ofh->code_infos[current_seg].offset;
-  *Ptr<u32>(patch_loc).c() = patch_value;
+  patches->push_back({LinkPatchV3::Kind::WORD, patch_loc, (s32)patch_value, 0});
   return 8;
 }
 
+/*!
+ * Apply decoded patches to memory.
+ */
+void apply_link_patches_v3(const std::vector<LinkPatchV3>& patches) {
+  u8* mem = g_ee_main_mem;
+  for (auto& patch : patches) {
+    switch (patch.kind) {
+      case LinkPatchV3::Kind::WORD:
+        *(s32*)(mem + patch.loc) = patch.value;
+        break;
+      case LinkPatchV3::Kind::DWORD:
+        *(s64*)(mem + patch.loc) = patch.value;
+        break;
+      case LinkPatchV3::Kind::SYMBOL: {
+        auto data_ptr = (s32*)(mem + patch.loc);
+        // a "-1" indicates that we should store the address. Otherwise store the offset to st.
+        *data_ptr = (*data_ptr == -1) ? (s32)patch.sym_addr : patch.value;
+      } break;
+    }
+  }
+}
+}  // namespace
+
 /*!
  * Run the linker. For now, all linking is done in two runs.  If this turns out to be too slow,
  * this should be modified to do incremental linking over multiple runs.
@@ -475,30 +527,34 @@ uint32_t link_control::work_v3() {
     if (m_segment_process < ofh->segment_count) {
       if (ofh->code_infos[m_segment_process].offset) {
         Ptr<u8> lp(ofh->link_infos[m_segment_process].offset);
+        Ptr<u8> seg_data(ofh->code_infos[m_segment_process].offset);
+        auto& patches = link_patches_v3;
+        patches.clear();
 
+        // decode the link table and resolve symbols/types, in link table order.
         while (*lp) {
           switch (*lp) {
             case LINK_TABLE_END:
               break;
             case LINK_SYMBOL_OFFSET:
               lp = lp + 1;
-              lp = lp + symlink_v3(lp, Ptr<u8>(ofh->code_infos[m_segment_process].offset));
+              lp = lp + symlink_v3(lp, seg_data, &m_symbol_cache, &patches);
               break;
             case LINK_TYPE_PTR:
               lp = lp + 1;  // seek past id
-              lp = lp + typelink_v3(lp, Ptr<u8>(ofh->code_infos[m_segment_process].offset));
+              lp = lp + typelink_v3(lp, seg_data, &patches);
               break;
             case LINK_DISTANCE_TO_OTHER_SEG_64:
               lp = lp + 1;
-              lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 8);
+              lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 8, &patches);
               break;
             case LINK_DISTANCE_TO_OTHER_SEG_32:
               lp = lp + 1;
-              lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 4);
+              lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 4, &patches);
               break;
             case LINK_PTR:
               lp = lp + 1;
-              lp = lp + ptr_link_v3(lp, ofh, m_segment_process);
+              lp = lp + ptr_link_v3(lp, ofh, m_segment_process, &patches);
               break;
             default:
               printf("unknown link table thing %d\n", *lp);
@@ -506,6 +562,9 @@ uint32_t link_control::work_v3() {
               break;
           }
         }
+
+        // patch!
+        apply_link_patches_v3(patches);
       }
 
       m_segment_process++;
@@ -594,6 +653,7 @@ uint32_t link_control::work_v2() {
         MsgErr("dkernel: heap overflow\n");  // game has ~% instead of \n :P
         return 1;
       }
+      kmalloc_ledger_record(m_heap, m_code_size, m_heap_gap, false, "data-segment");
     } else {  // not close enough, need to move the object
 
       // on the first run of this state...
@@ -770,6 +830,8 @@ uint32_t link_control::work_v2() {
  * Complete linking. This will execute the top-level code for v3 object files, if requested.
  */
 void link_control::finish() {
+  lg::debug("[link] {} linked in {:.3f} ms", m_object_name, m_link_ms);
+  m_symbol_cache.clear();
   CacheFlush(m_code_start.c(), m_code_size);
   auto old_debug_segment = DebugSegment;
   if (m_keep_debug) {
@@ -9,6 +9,8 @@
 #ifndef JAK_KLINK_H
 #define JAK_KLINK_H
 
+#include <string_view>
+#include <unordered_map>
 #include "Ptr.h"
 #include "kmalloc.h"
 #include "common/link_types.h"
@@ -47,6 +49,11 @@ struct link_control {
   int m_table_toggle;
 
   bool m_opengoal;
+  double m_link_ms = 0;  //! time spent in work(), not including the top-level
+
+  // symbols already resolved for this object file, by name. The names point into the link table.
+  std::unordered_map<std::string_view, u32> m_symbol_cache;
+
   void begin(Ptr<uint8_t> object_file,
              const char* name,
              int32_t size,
@@ -72,6 +79,8 @@ struct link_control {
     m_state = 0;
     m_segment_process = 0;
     m_version = 0;
+    m_link_ms = 0;
+    m_symbol_cache.clear();
   }
 };
 
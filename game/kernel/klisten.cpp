@@ -72,7 +72,6 @@ void ClearPending() {
       if (OutputPending.offset != 0) {
         Ptr<char> msg = OutputBufArea.cast<char>() + sizeof(ListenerMessageHeader);
         auto size = strlen(msg.c());
-        // note - if size is ever greater than 2^16 this will cause an issue.
         SendFromBuffer(msg.c(), size);
         clear_output();
       }
@@ -80,15 +79,8 @@ void ClearPending() {
       if (PrintPending.offset != 0) {
         char* msg = PrintBufArea.cast<char>().c() + sizeof(ListenerMessageHeader);
         auto size = strlen(msg);
-        while (size > 0) {
-          // sends larger than 64 kB are broken by the GoalProtoBuffer thing, so they are split
-          auto send_size = size;
-          if (send_size > 64000) {
-            send_size = 64000;
-          }
-          SendFromBufferD(2, 0, msg, send_size);
-          size -= send_size;
-          msg += send_size;
+        if (size > 0) {
+          SendFromBufferD(2, 0, msg, size);
         }
         clear_print();
       }
@@ -142,6 +134,8 @@ void ProcessListenerMessage(Ptr<char> msg) {
     case LTT_MSG_CODE: {
       auto buffer = kmalloc(kdebugheap, MessCount, 0, "listener-link-block");
       memcpy(buffer.c(), msg.c(), MessCount);
+      // we have our own copy, so the next message can come in while this one is linked.
+      ReleaseMessageBuffer();
       ListenerLinkBlock->value = buffer.offset + 4;
       // note - this will stash the linked code in the top level and free it.
       // it will then be used-after-free, but this is OK because nobody else will allocate.
@@ -160,5 +154,6 @@ void ProcessListenerMessage(Ptr<char> msg) {
       MsgErr("dkernel: unknown message error: <%d> of %d bytes\n", protoBlock.msg_kind, MessCount);
       break;
   }
+  ReleaseMessageBuffer();
   SendAck();
 }
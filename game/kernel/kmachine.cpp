@@ -7,7 +7,13 @@
 
 #include <string>
 #include <cstring>
+#include <cstdlib>
 #include <cassert>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 #include "kmachine.h"
 #include "kboot.h"
 #include "kprint.h"
@@ -29,6 +35,8 @@
 #include "game/sce/libpad.h"
 #include "common/symbols.h"
 #include "common/log/log.h"
+#include "game/system/profiler.h"
+#include "game/system/frame_stats.h"
 using namespace ee;
 
 /*!
@@ -143,6 +151,22 @@ void InitParms(int argc, const char* const* argv) {
       Msg(6, "dkernel: level %s\n", levelName.c_str());
       kstrcpy(DebugBootLevel, levelName.c_str());
     }
+
+    // Added for OpenGOAL
+    // the "-fps [frames]" mode limits how often the kernel is dispatched.
+    if (arg == "-fps" && i + 1 < argc) {
+      i++;
+      int fps = atoi(argv[i]);
+      Msg(6, "dkernel: frame limit %d\n", fps);
+      frame_stats_set_limit(fps);
+    }
+
+    // Added for OpenGOAL
+    // the "-kmalloc-ledger" mode records all kmalloc allocations, starting at boot.
+    if (arg == "-kmalloc-ledger") {
+      Msg(6, "dkernel: kmalloc ledger\n");
+      kmalloc_ledger_enable(true);
+    }
   }
 }
 
@@ -556,6 +580,79 @@ void PutDisplayEnv() {
   assert(false);
 }
 
+/*!
+ * Start the sampling profiler. Added for OpenGOAL.
+ */
+void ProfileStart(u32 hz) {
+  profiler_start(hz);
+}
+
+/*!
+ * Stop the sampling profiler and send the results to the compiler. Added for OpenGOAL.
+ */
+void ProfileStop() {
+  u32 total_samples, dropped_samples;
+  auto stacks = profiler_stop(&total_samples, &dropped_samples);
+  output_profile(stacks, total_samples, dropped_samples);
+}
+
+/*!
+ * Print the frame time statistics. Added for OpenGOAL.
+ */
+void FrameStatsPrint() {
+  cprintf("%s", frame_stats_report().c_str());
+}
+
+/*!
+ * Forget all recorded frame times. Added for OpenGOAL.
+ */
+void FrameStatsReset() {
+  frame_stats_reset();
+}
+
+/*!
+ * Log a frame time summary every frames frames, or never if 0. Added for OpenGOAL.
+ */
+void FrameStatsLog(u32 frames) {
+  frame_stats_set_log_interval(frames);
+}
+
+/*!
+ * Limit the kernel dispatch loop to fps frames per second, or remove the limit if 0.
+ * Added for OpenGOAL.
+ */
+void SetFrameLimit(u32 fps) {
+  frame_stats_set_limit(fps);
+}
+
+/*!
+ * Clear the kmalloc ledger and start recording allocations. Added for OpenGOAL.
+ */
+void KmallocLedgerStart() {
+  kmalloc_ledger_enable(true);
+}
+
+/*!
+ * Stop recording allocations. The ledger is kept. Added for OpenGOAL.
+ */
+void KmallocLedgerStop() {
+  kmalloc_ledger_enable(false);
+}
+
+/*!
+ * Print the kmalloc ledger for all heaps. Added for OpenGOAL.
+ */
+void KmallocLedgerReport() {
+  cprintf("%s", kmalloc_ledger_report(Ptr<kheapinfo>(0)).c_str());
+}
+
+/*!
+ * Read the CPU's time stamp counter, for timing benchmarks. Added for OpenGOAL.
+ */
+u64 ReadTsc() {
+  return __rdtsc();
+}
+
 /*!
  * Final initialization of the system after the kernel is loaded.
  * This is called from InitHeapAndSymbol at the very end.
@@ -594,6 +691,16 @@ void InitMachineScheme() {
   make_function_symbol_from_c("dma-to-iop", (void*)dma_to_iop);                           // unused
   make_function_symbol_from_c("kernel-shutdown", (void*)KernelShutdown);                  // used
   make_function_symbol_from_c("aybabtu", (void*)sceCdMmode);                              // used
+  make_function_symbol_from_c("profile-start", (void*)ProfileStart);                      // added
+  make_function_symbol_from_c("profile-stop", (void*)ProfileStop);                        // added
+  make_function_symbol_from_c("frame-stats-print", (void*)FrameStatsPrint);               // added
+  make_function_symbol_from_c("frame-stats-reset", (void*)FrameStatsReset);               // added
+  make_function_symbol_from_c("frame-stats-log", (void*)FrameStatsLog);                   // added
+  make_function_symbol_from_c("set-frame-limit", (void*)SetFrameLimit);                   // added
+  make_function_symbol_from_c("kmalloc-ledger-start", (void*)KmallocLedgerStart);         // added
+  make_function_symbol_from_c("kmalloc-ledger-stop", (void*)KmallocLedgerStop);           // added
+  make_function_symbol_from_c("kmalloc-ledger-report", (void*)KmallocLedgerReport);       // added
+  make_function_symbol_from_c("read-tsc", (void*)ReadTsc);                                // added
   InitSoundScheme();
   intern_from_c("*stack-top*")->value = 0x07ffc000;
   intern_from_c("*stack-base*")->value = 0x07ffffff;
@@ -5,8 +5,12 @@
  * DONE
  */
 
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
+#include <map>
+#include <tuple>
+#include <vector>
 #include "common/goal_constants.h"
 #include "kmalloc.h"
 #include "kprint.h"
@@ -16,10 +20,164 @@
 Ptr<kheapinfo> kglobalheap;
 Ptr<kheapinfo> kdebugheap;
 
+namespace {
+/*!
+ * The allocation ledger. Added for OpenGOAL.
+ * Allocations are added up by heap, group (the DGO being loaded), side and name.
+ */
+struct LedgerEntry {
+  u32 count = 0;
+  u32 bytes = 0;
+  u32 padding = 0;  // lost to alignment
+};
+
+// heap, group, top, name
+using LedgerKey = std::tuple<u32, std::string, bool, std::string>;
+
+bool ledger_enabled = false;
+std::map<LedgerKey, LedgerEntry> ledger;
+std::string ledger_group;
+
+// only print this many names per group, the rest are added up.
+constexpr int LEDGER_REPORT_NAMES = 16;
+
+const char* heap_name(u32 heap) {
+  if (heap == kglobalheap.offset) {
+    return " (global)";
+  } else if (heap == kdebugheap.offset) {
+    return " (debug)";
+  } else {
+    return "";
+  }
+}
+
+/*!
+ * Print the ledger entries for one heap.
+ */
+void ledger_report_heap(u32 heap, std::string& result) {
+  char buffer[256];
+  auto info = Ptr<kheapinfo>(heap);
+  u32 size = info->top_base - info->base;
+  u32 used_bot = info->current - info->base;
+  u32 used_top = info->top_base - info->top;
+  sprintf(buffer, "heap #x%x%s: %d of %d bytes used (%d bottom, %d top), %d free\n", heap,
+          heap_name(heap), used_bot + used_top, size, used_bot, used_top,
+          size - used_bot - used_top);
+  result += buffer;
+
+  // find the entries for this heap. they're sorted by group.
+  auto it = ledger.lower_bound(LedgerKey(heap, "", false, ""));
+  while (it != ledger.end() && std::get<0>(it->first) == heap) {
+    const auto& group = std::get<1>(it->first);
+    std::vector<std::pair<const LedgerKey*, const LedgerEntry*>> entries;
+    u32 bot_bytes = 0, top_bytes = 0, padding = 0;
+    for (; it != ledger.end() && std::get<0>(it->first) == heap && std::get<1>(it->first) == group;
+         ++it) {
+      entries.emplace_back(&it->first, &it->second);
+      (std::get<2>(it->first) ? top_bytes : bot_bytes) += it->second.bytes;
+      padding += it->second.padding;
+    }
+    sprintf(buffer, "  %s: %d bytes bottom, %d bytes top, %d bytes padding\n",
+            group.empty() ? "(no dgo)" : group.c_str(), bot_bytes, top_bytes, padding);
+    result += buffer;
+
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+      return a.second->bytes > b.second->bytes;
+    });
+    LedgerEntry rest;
+    for (size_t i = 0; i < entries.size(); i++) {
+      auto& entry = *entries[i].second;
+      if (i < LEDGER_REPORT_NAMES) {
+        sprintf(buffer, "    %-32s %-6s %6d %10d %8d\n", std::get<3>(*entries[i].first).c_str(),
+                std::get<2>(*entries[i].first) ? "top" : "bottom", entry.count, entry.bytes,
+                entry.padding);
+        result += buffer;
+      } else {
+        rest.count += entry.count;
+        rest.bytes += entry.bytes;
+        rest.padding += entry.padding;
+      }
+    }
+    if (entries.size() > LEDGER_REPORT_NAMES) {
+      auto more = "(" + std::to_string(entries.size() - LEDGER_REPORT_NAMES) + " more)";
+      sprintf(buffer, "    %-32s %-6s %6d %10d %8d\n", more.c_str(), "", rest.count, rest.bytes,
+              rest.padding);
+      result += buffer;
+    }
+  }
+}
+}  // namespace
+
 void kmalloc_init_globals() {
   // _globalheap and _debugheap
   kglobalheap.offset = GLOBAL_HEAP_INFO_ADDR;
   kdebugheap.offset = DEBUG_HEAP_INFO_ADDR;
+  ledger_enabled = false;
+  ledger.clear();
+  ledger_group.clear();
+}
+
+/*!
+ * Start or stop recording allocations in the ledger. Starting clears the ledger.
+ * Added for OpenGOAL.
+ */
+void kmalloc_ledger_enable(bool enable) {
+  if (enable) {
+    ledger.clear();
+  }
+  ledger_enabled = enable;
+}
+
+/*!
+ * Set the group for allocations, usually the name of the DGO being loaded. Returns the old group.
+ * Added for OpenGOAL.
+ */
+std::string kmalloc_ledger_set_group(const std::string& group) {
+  auto old = ledger_group;
+  ledger_group = group;
+  return old;
+}
+
+/*!
+ * Add an allocation to the ledger. This is done by kmalloc, but code that takes memory from a heap
+ * without kmalloc should call this too.
+ * Added for OpenGOAL.
+ */
+void kmalloc_ledger_record(Ptr<kheapinfo> heap, u32 size, u32 padding, bool top, const char* name) {
+  if (!ledger_enabled) {
+    return;
+  }
+  auto& entry = ledger[LedgerKey(heap.offset, ledger_group, top, name ? name : "(none)")];
+  entry.count++;
+  entry.bytes += size;
+  entry.padding += padding;
+}
+
+/*!
+ * Get a report of the ledger for the given heap, or all heaps if heap is null.
+ * Added for OpenGOAL.
+ */
+std::string kmalloc_ledger_report(Ptr<kheapinfo> heap) {
+  std::string result;
+  if (!ledger_enabled && ledger.empty()) {
+    return "kmalloc ledger is not enabled\n";
+  }
+  if (heap.offset) {
+    ledger_report_heap(heap.offset, result);
+    return result;
+  }
+
+  // always show global and debug, even if they have no entries.
+  std::vector<u32> heaps = {kglobalheap.offset, kdebugheap.offset};
+  for (auto& entry : ledger) {
+    if (std::find(heaps.begin(), heaps.end(), std::get<0>(entry.first)) == heaps.end()) {
+      heaps.push_back(std::get<0>(entry.first));
+    }
+  }
+  for (auto h : heaps) {
+    ledger_report_heap(h, result);
+  }
+  return result;
 }
 
 /*!
@@ -139,9 +297,15 @@ Ptr<u8> kmalloc(Ptr<kheapinfo> heap, s32 size, u32 flags, char const* name) {
     if (heap->top.offset < memend) {
       kheapstatus(heap);
       Msg(6, "kmalloc: !alloc mem %s (%d bytes) heap %x\n", name, size, heap.offset);
+      if (ledger_enabled) {
+        Msg(6, "%s", kmalloc_ledger_report(heap).c_str());
+      }
       return Ptr<u8>(0);
     }
 
+    if (ledger_enabled) {
+      kmalloc_ledger_record(heap, size, memstart - heap->current.offset, false, name);
+    }
     heap->current.offset = memend;
     if (flags & KMALLOC_MEMSET)
       std::memset(Ptr<u8>(memstart).c(), 0, (size_t)size);
@@ -162,9 +326,15 @@ Ptr<u8> kmalloc(Ptr<kheapinfo> heap, s32 size, u32 flags, char const* name) {
     if (heap->current.offset >= memstart) {
       Msg(6, "kmalloc: !alloc mem from top %s (%d bytes) heap %x\n", name, size, heap.offset);
       kheapstatus(heap);
+      if (ledger_enabled) {
+        Msg(6, "%s", kmalloc_ledger_report(heap).c_str());
+      }
       return Ptr<u8>(0);
     }
 
+    if (ledger_enabled) {
+      kmalloc_ledger_record(heap, size, heap->top.offset - size - memstart, true, name);
+    }
     heap->top.offset = memstart;
 
     if (flags & 0x1000)
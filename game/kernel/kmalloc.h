@@ -10,6 +10,7 @@
 #ifndef JAK_KMALLOC_H
 #define JAK_KMALLOC_H
 
+#include <string>
 #include "common/common_types.h"
 #include "Ptr.h"
 #include "kmachine.h"
@@ -43,6 +44,12 @@ u32 kheapused(Ptr<kheapinfo> heap);
 Ptr<u8> kmalloc(Ptr<kheapinfo> heap, s32 size, u32 flags, char const* name);
 void kfree(Ptr<u8> a);
 
+// allocation ledger
+void kmalloc_ledger_enable(bool enable);
+std::string kmalloc_ledger_set_group(const std::string& group);
+void kmalloc_ledger_record(Ptr<kheapinfo> heap, u32 size, u32 padding, bool top, const char* name);
+std::string kmalloc_ledger_report(Ptr<kheapinfo> heap);
+
 void kmalloc_init_globals();
 
 #endif  // JAK_KMALLOC_H
@@ -8,6 +8,9 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "common/goal_constants.h"
 #include "common/common_types.h"
@@ -45,6 +48,13 @@ Ptr<u8> OutputBufArea;
 // Pointer to print buffer, the buffer for printing and string formatting.
 Ptr<u8> PrintBufArea;
 
+// End of the data in the output buffer, if OutputPending is set.
+Ptr<u8> OutputEnd;
+
+// End of the data in the print buffer, if PrintPending is set. The original game found the end of
+// the buffers with strend each time something was printed. We keep track of it instead.
+Ptr<u8> PrintEnd;
+
 // integer printing conversion table
 char ConvertTable[16];
 
@@ -61,6 +71,9 @@ void kprint_init_globals() {
   MessBufArea.offset = 0;
   OutputBufArea.offset = 0;
   PrintBufArea.offset = 0;
+  OutputEnd.offset = 0;
+  PrintEnd.offset = 0;
+  clear_format_cache();
   memcpy(ConvertTable, "0123456789abcdef", 16);
   memset(AckBufArea, 0, sizeof(AckBufArea));
 }
@@ -98,6 +111,7 @@ void clear_output() {
   if (MasterDebug) {
     kstrcpy((char*)Ptr<u8>(OutputBufArea + sizeof(ListenerMessageHeader)).c(), "");
     OutputPending = Ptr<u8>(0);
+    OutputEnd = Ptr<u8>(0);
   }
 }
 
@@ -109,6 +123,40 @@ void clear_output() {
 void clear_print() {
   *Ptr<u8>(PrintBufArea + sizeof(ListenerMessageHeader)) = 0;
   PrintPending = Ptr<u8>(0);
+  PrintEnd = Ptr<u8>(0);
+}
+
+/*!
+ * Get the end of the data in the output buffer, where the next output message should be written.
+ * Added, replaces strend on the entire output buffer.
+ */
+static char* output_end() {
+  if (!OutputPending.offset) {
+    OutputEnd = OutputBufArea + sizeof(ListenerMessageHeader);
+  }
+  assert(*OutputEnd == 0);
+  return OutputEnd.cast<char>().c();
+}
+
+/*!
+ * Get the end of the data in the print buffer, where the next print should be written, and set
+ * PrintPending to it.
+ * Added, replaces the strend from PrintPending at the start of each print.
+ */
+char* start_print() {
+  if (!PrintPending.offset) {
+    PrintEnd = PrintBufArea + sizeof(ListenerMessageHeader);
+  }
+  assert(*PrintEnd == 0);
+  PrintPending = PrintEnd;
+  return PrintPending.cast<char>().c();
+}
+
+/*!
+ * Set the end of the data in the print buffer, after something was printed or truncated.
+ */
+void set_print_end(char* end) {
+  PrintEnd = make_ptr(end).cast<u8>();
 }
 
 /*!
@@ -123,9 +171,11 @@ void reset_output() {
     // s7.offset);
 
     // modified for OpenGOAL:
-    sprintf(OutputBufArea.cast<char>().c() + sizeof(ListenerMessageHeader), "reset #x%x #x%lx %s\n",
-            s7.offset, (uintptr_t)g_ee_main_mem, xdbg::get_current_thread_id().to_string().c_str());
+    int len = sprintf(OutputBufArea.cast<char>().c() + sizeof(ListenerMessageHeader),
+                      "reset #x%x #x%lx %s\n", s7.offset, (uintptr_t)g_ee_main_mem,
+                      xdbg::get_current_thread_id().to_string().c_str());
     OutputPending = OutputBufArea + sizeof(ListenerMessageHeader);
+    OutputEnd = OutputPending + len;
   }
 }
 
@@ -135,9 +185,10 @@ void reset_output() {
  */
 void output_unload(const char* name) {
   if (MasterDebug) {
-    sprintf(strend(OutputBufArea.cast<char>().c() + sizeof(ListenerMessageHeader)),
-            "unload \"%s\"\n", name);
+    char* buffer = output_end();
+    int len = sprintf(buffer, "unload \"%s\"\n", name);
     OutputPending = OutputBufArea + sizeof(ListenerMessageHeader);
+    OutputEnd = make_ptr(buffer + len).cast<u8>();
   }
 }
 
@@ -146,16 +197,47 @@ void output_unload(const char* name) {
  */
 void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags) {
   if (MasterDebug) {
-    char* buffer = strend(OutputBufArea.cast<char>().c() + sizeof(ListenerMessageHeader));
+    char* buffer = output_end();
     char true_str[] = "t";
     char false_str[] = "nil";
     char* flag_str = (flags & LINK_FLAG_OUTPUT_TRUE) ? true_str : false_str;
     auto lbp = link_block.cast<ObjectFileHeader>();
     // modified to also include segment sizes.
-    sprintf(buffer, "load \"%s\" %s #x%x #x%x #x%x #x%x #x%x #x%x\n", name, flag_str,
-            lbp->code_infos[0].offset, lbp->code_infos[1].offset, lbp->code_infos[2].offset,
-            lbp->code_infos[0].size, lbp->code_infos[1].size, lbp->code_infos[2].size);
+    int len = sprintf(buffer, "load \"%s\" %s #x%x #x%x #x%x #x%x #x%x #x%x\n", name, flag_str,
+                      lbp->code_infos[0].offset, lbp->code_infos[1].offset,
+                      lbp->code_infos[2].offset, lbp->code_infos[0].size,
+                      lbp->code_infos[1].size, lbp->code_infos[2].size);
+    OutputPending = OutputBufArea + sizeof(ListenerMessageHeader);
+    OutputEnd = make_ptr(buffer + len).cast<u8>();
+  }
+}
+
+/*!
+ * Buffer message to compiler with the results of the profiler. Added for OpenGOAL.
+ * There is a line for each call stack, and the stacks which don't fit in the buffer are counted
+ * as dropped.
+ */
+void output_profile(const std::vector<ProfileStack>& stacks,
+                    u32 total_samples,
+                    u32 dropped_samples) {
+  if (MasterDebug) {
+    char* buffer = output_end();
+    char* buffer_end = (OutputBufArea + DEBUG_OUTPUT_BUFFER_SIZE).cast<char>().c();
+    for (auto& stack : stacks) {
+      // "profile" and the count, then " #x" and up to 8 digits per frame, then room for the end.
+      if (buffer_end - buffer < 32 + 11 * int(stack.frames.size()) + 64) {
+        dropped_samples += stack.count;
+        continue;
+      }
+      buffer += sprintf(buffer, "profile %d", stack.count);
+      for (auto frame : stack.frames) {
+        buffer += sprintf(buffer, " #x%x", frame);
+      }
+      buffer += sprintf(buffer, "\n");
+    }
+    buffer += sprintf(buffer, "profile-end %d %d\n", total_samples, dropped_samples);
     OutputPending = OutputBufArea + sizeof(ListenerMessageHeader);
+    OutputEnd = make_ptr(buffer).cast<u8>();
   }
 }
 
@@ -163,16 +245,14 @@ void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags) {
  * Print to the GOAL print buffer from C
  * seeks PrintPending to begining of what was just printed.
  * This is a different behavior from all the other prints!
- * DONE, EXACT
+ * DONE, uses start_print instead of strend
  */
 void cprintf(const char* format, ...) {
   va_list args;
   va_start(args, format);
-  char* str = PrintPending.cast<char>().c();
-  if (!PrintPending.offset)
-    str = PrintBufArea.cast<char>().c() + sizeof(ListenerMessageHeader);
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-  vsprintf((char*)PrintPending.c(), format, args);
+  char* str = start_print();
+  int len = vsprintf(str, format, args);
+  set_print_end(str + (len > 0 ? len : 0));
 
   va_end(args);
 }
@@ -574,79 +654,41 @@ struct format_struct {
 };
 
 /*!
- * The GOAL "format" function.  The actual function is named "format".  However, GOAL's calling
- * convention differs from x86-64, so GOAL cannot directly call format.  There is an assembly
- * function in format_wrapper.nasm named format. It takes the GOAL argument registers, stores them
- * in an array on the stack, and calls this function with a pointer to that array.
- *
- * This function is a disaster. The Ghidra analyzer completely fails on it, so this is done by hand.
- *
- * To make this work correctly from GOAL with up to 8 arguments, there is an assembly function
- * defined in format_wrapper.nasm that places the GOAL arguments on the stack and calls this
- * format_impl function with a single argument that is a pointer to the argument array.
+ * A format string, split up into plain text and commands so it only needs to be parsed once.
+ * Added, the original format parsed the string on every call.
  */
-s32 format_impl(uint64_t* args) {
-  // first two args are dest, format string
-  uint64_t* arg_regs = args + 2;
+struct ParsedFormat {
+  struct Element {
+    bool is_command = false;
+    char command = 0;    // the command character, after the arguments
+    bool last = false;   // nothing follows the command in the format string
+    u32 text_start = 0;  // plain text, or all of the command for commands that are passed through
+    u32 text_length = 0;
+    format_struct argument_data[3];  // no command uses more than the first three arguments
+  };
+
+  std::string text;
+  std::vector<Element> elements;
+};
+
+/*!
+ * Split a format string into plain text and commands. Arguments are read exactly like the
+ * original format did.
+ */
+static std::shared_ptr<const ParsedFormat> parse_format(const char* format_cstring) {
+  auto result = std::make_shared<ParsedFormat>();
+  result->text = format_cstring;
+  const char* format_base = result->text.c_str();
+  const char* format_ptr = format_base;
 
   // data for arguments in a format command
   format_struct argument_data[8];
 
-  u32 arg_reg_idx = 0;
-
-  // the gstring
-  char* format_gstring = Ptr<char>(args[1]).c();
-
-  u32 original_dest = args[0];
-
-  // set up print pending
-  char* print_temp = PrintPending.cast<char>().c();
-  if (!PrintPending.offset) {
-    print_temp = PrintBufArea.cast<char>().c() + sizeof(ListenerMessageHeader);
-  }
-  PrintPending = make_ptr(strend(print_temp)).cast<u8>();
-
-  // what we write to
-  char* output_ptr = PrintPending.cast<char>().c();
-
-  // convert gstring to cstring
-  char* format_cstring = format_gstring + 4;
-
-  // mysteries
-  char* PrintPendingLocal2 = PrintPending.cast<char>().c();
-  char* PrintPendingLocal3 = output_ptr;
-
-  // start by computing indentation
-  u32 indentation = 0;
-
-  // read goal binteger
-  if (print_column.offset) {
-    // added the if check so we can format even if the kernel didn't load right.
-    indentation = (*print_column) >> 3;
-  }
-
-  // which arg we're on
-  u32 arg_idx = 0;
-
-  // if last char was newline and we have tabs, do tabs
-  if (indentation && output_ptr[-1] == '\n') {
-    for (u32 i = 0; i < indentation; i++) {
-      *output_ptr = ' ';
-      output_ptr++;
-    }
-  }
-
-  // input pointer
-  char* format_ptr = format_cstring;
-
-  // loop over the format string
   while (*format_ptr) {
-    // got a command?
     if (*format_ptr == '~') {
-      char* arg_start = format_ptr;
+      const char* arg_start = format_ptr;
       // get some arguments
-      arg_idx = 0;
-      u8 justify = 0;
+      u32 arg_idx = 0;
       for (auto& x : argument_data) {
         x.reset();
       }
@@ -718,15 +760,129 @@ s32 format_impl(uint64_t* args) {
         format_ptr++;
       }  // end argument while
 
+      ParsedFormat::Element command;
+      command.is_command = true;
+      command.command = format_ptr[1];
+      command.text_start = arg_start - format_base;
+      command.text_length = format_ptr + 2 - arg_start;
+      memcpy(command.argument_data, argument_data, sizeof(command.argument_data));
+      if (!command.command) {
+        // format string ends in the middle of a command. This is an error when it's printed.
+        result->elements.push_back(command);
+        break;
+      }
+      command.last = !format_ptr[2];
+      result->elements.push_back(command);
+      format_ptr += 2;
+    } else {
+      // got normal char, add it to the plain text
+      if (result->elements.empty() || result->elements.back().is_command) {
+        result->elements.emplace_back();
+        result->elements.back().text_start = format_ptr - format_base;
+      }
+      result->elements.back().text_length++;
+      format_ptr++;
+    }
+  }
+
+  return result;
+}
+
+namespace {
+constexpr u32 FORMAT_CACHE_SIZE = 256;
+struct FormatCacheEntry {
+  u32 gstring = 0;
+  std::shared_ptr<const ParsedFormat> format;
+};
+FormatCacheEntry format_cache[FORMAT_CACHE_SIZE];
+}  // namespace
+
+/*!
+ * Forget all parsed format strings.
+ */
+void clear_format_cache() {
+  for (auto& entry : format_cache) {
+    entry = FormatCacheEntry();
+  }
+}
+
+/*!
+ * Get a parsed format string. These are cached by the address of the GOAL string, but a string
+ * can be modified or freed, so the text is checked before a cached one is used.
+ */
+static std::shared_ptr<const ParsedFormat> get_parsed_format(u32 gstring) {
+  const char* text = Ptr<char>(gstring).c() + 4;
+  auto& entry = format_cache[(gstring >> 4) % FORMAT_CACHE_SIZE];
+  if (entry.gstring != gstring || !entry.format || strcmp(entry.format->text.c_str(), text)) {
+    entry.gstring = gstring;
+    entry.format = parse_format(text);
+  }
+  return entry.format;
+}
+
+/*!
+ * The GOAL "format" function.  The actual function is named "format".  However, GOAL's calling
+ * convention differs from x86-64, so GOAL cannot directly call format.  There is an assembly
+ * function in format_wrapper.nasm named format. It takes the GOAL argument registers, stores them
+ * in an array on the stack, and calls this function with a pointer to that array.
+ *
+ * This function is a disaster. The Ghidra analyzer completely fails on it, so this is done by hand.
+ *
+ * To make this work correctly from GOAL with up to 8 arguments, there is an assembly function
+ * defined in format_wrapper.nasm that places the GOAL arguments on the stack and calls this
+ * format_impl function with a single argument that is a pointer to the argument array.
+ */
+s32 format_impl(uint64_t* args) {
+  // first two args are dest, format string
+  uint64_t* arg_regs = args + 2;
+
+  u32 arg_reg_idx = 0;
+
+  // the gstring, split into text and commands.
+  auto format = get_parsed_format(args[1]);
+
+  u32 original_dest = args[0];
+
+  // set up print pending, what we write to
+  char* output_ptr = start_print();
+
+  // mysteries
+  char* PrintPendingLocal2 = PrintPending.cast<char>().c();
+  char* PrintPendingLocal3 = output_ptr;
+
+  // start by computing indentation
+  u32 indentation = 0;
+
+  // read goal binteger
+  if (print_column.offset) {
+    // added the if check so we can format even if the kernel didn't load right.
+    indentation = (*print_column) >> 3;
+  }
+
+  // if last char was newline and we have tabs, do tabs
+  if (indentation && output_ptr[-1] == '\n') {
+    for (u32 i = 0; i < indentation; i++) {
+      *output_ptr = ' ';
+      output_ptr++;
+    }
+  }
+
+  // loop over the format string
+  for (auto& element : format->elements) {
+    const char* element_text = format->text.c_str() + element.text_start;
+    if (element.is_command) {
+      const format_struct* argument_data = element.argument_data;
+      u8 justify = 0;
+
       // switch on command
-      switch (format_ptr[1]) {
+      switch (element.command) {
           // offset of 0x25
 
         case '%':  // newline
           *output_ptr = '\n';
           output_ptr++;
           // indent the next line if there is one
-          if (indentation && format_ptr[2]) {
+          if (indentation && !element.last) {
             for (u32 i = 0; i < indentation; i++) {
               *output_ptr = ' ';
               output_ptr++;
@@ -758,13 +914,8 @@ s32 format_impl(uint64_t* args) {
         case 'w':
         case 'y':
         case 'z':
-          while (arg_start < format_ptr + 1) {
-            *output_ptr = *arg_start;
-            arg_start++;
-            output_ptr++;
-          }
-          *output_ptr = format_ptr[1];
-          output_ptr++;
+          memcpy(output_ptr, element_text, element.text_length);
+          output_ptr += element.text_length;
           break;
 
         case 'G':  // like %s, prints a C string
@@ -781,6 +932,7 @@ s32 format_impl(uint64_t* args) {
           s8 arg0 = argument_data[0].data[0];
           s32 desired_length = arg0;
           *output_ptr = 0;
+          set_print_end(output_ptr);
           u32 in = arg_regs[arg_reg_idx++];
           print_object(in);
           if (desired_length != -1) {
@@ -824,6 +976,7 @@ s32 format_impl(uint64_t* args) {
           s8 arg0 = argument_data[0].data[0];
           s32 desired_length = arg0;
           *output_ptr = 0;
+          set_print_end(output_ptr);
           u32 in = arg_regs[arg_reg_idx++];
 
           // if it's a string
@@ -880,6 +1033,7 @@ s32 format_impl(uint64_t* args) {
         case 'P':  // like ~A, but can specify type explicitly
         case 'p': {
           *output_ptr = 0;
+          set_print_end(output_ptr);
           s8 arg0 = argument_data[0].data[0];
           u32 in = arg_regs[arg_reg_idx++];
           if (arg0 == -1) {
@@ -901,6 +1055,7 @@ s32 format_impl(uint64_t* args) {
         case 'I':  // like ~P, but calls inpsect
         case 'i': {
           *output_ptr = 0;
+          set_print_end(output_ptr);
           s8 arg0 = argument_data[0].data[0];
           u32 in = arg_regs[arg_reg_idx++];
           if (arg0 == -1) {
@@ -1033,21 +1188,20 @@ s32 format_impl(uint64_t* args) {
         } break;
 
         default:
-          MsgErr("format: unknown code 0x%02x\n", format_ptr[1]);
+          MsgErr("format: unknown code 0x%02x\n", element.command);
           assert(false);
           break;
       }
-      format_ptr++;
     } else {
-      // got normal char, just copy it
-      *output_ptr = *format_ptr;
-      output_ptr++;
+      // got normal text, just copy it
+      memcpy(output_ptr, element_text, element.text_length);
+      output_ptr += element.text_length;
     }
-    format_ptr++;
-  }  // end format string while
+  }  // end format string loop
 
   // end
   *output_ptr = 0;
+  set_print_end(output_ptr);
   output_ptr++;
 
   if (original_dest == s7.offset + FIX_SYM_TRUE) {
@@ -1058,12 +1212,14 @@ s32 format_impl(uint64_t* args) {
     u32 string = make_string_from_c(PrintPendingLocal3);
     PrintPending = make_ptr(PrintPendingLocal2).cast<u8>();
     *PrintPendingLocal3 = 0;
+    set_print_end(PrintPendingLocal3);
     return string;
   } else if (original_dest == 0) {
     printf("%s", PrintPendingLocal3);
     fflush(stdout);
     PrintPending = make_ptr(PrintPendingLocal2).cast<u8>();
     *PrintPendingLocal3 = 0;
+    set_print_end(PrintPendingLocal3);
     return 0;
   } else {
     if ((original_dest & OFFSET_MASK) == BASIC_OFFSET) {
@@ -1074,6 +1230,7 @@ s32 format_impl(uint64_t* args) {
         kstrncat(str, PrintPendingLocal3, len);
         PrintPending = make_ptr(PrintPendingLocal2).cast<u8>();
         *PrintPendingLocal3 = 0;
+        set_print_end(PrintPendingLocal3);
         return 0;
       } else if (type == *Ptr<Ptr<Type>>(s7.offset + FIX_SYM_FILE_STREAM_TYPE)) {
         assert(false);  // file stream nyi
@@ -8,9 +8,11 @@
 #ifndef RUNTIME_KPRINT_H
 #define RUNTIME_KPRINT_H
 
+#include <vector>
 #include "kmachine.h"
+#include "common/listener_common.h"
+#include "game/system/profiler.h"
 
-constexpr u32 DEBUG_MESSAGE_BUFFER_SIZE = 0x80000;
 constexpr u32 DEBUG_OUTPUT_BUFFER_SIZE = 0x80000;
 constexpr u32 DEBUG_PRINT_BUFFER_SIZE = 0x200000;
 constexpr u32 PRINT_BUFFER_SIZE = 0x2000;
@@ -64,6 +66,29 @@ void output_unload(const char* name);
  */
 void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags);
 
+/*!
+ * Buffer message to compiler with the results of the profiler.
+ */
+void output_profile(const std::vector<ProfileStack>& stacks,
+                    u32 total_samples,
+                    u32 dropped_samples);
+
+/*!
+ * Get the end of the data in the print buffer, where the next print should be written, and set
+ * PrintPending to it.
+ */
+char* start_print();
+
+/*!
+ * Set the end of the data in the print buffer, after something was printed or truncated.
+ */
+void set_print_end(char* end);
+
+/*!
+ * Forget all parsed format strings.
+ */
+void clear_format_cache();
+
 #ifdef __linux__
 /*!
  * Print to the GOAL print buffer from C
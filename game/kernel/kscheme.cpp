@@ -1271,13 +1271,9 @@ u64 print_pair(u32 obj) {
  */
 u64 print_integer(u64 obj) {
   // not sure why this is any better than cprintf("%ld") or similar. Maybe a tiny bit faster?
-  char* str = PrintPending.cast<char>().c();
-  if (!str) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
-  }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-  kitoa((char*)PrintPending.c(), obj, 10, 0xffffffff, '0', 0);
+  char* str = start_print();
+  kitoa(str, obj, 10, 0xffffffff, '0', 0);
+  set_print_end(strend(str));
   return obj;
 }
 
@@ -1285,13 +1281,9 @@ u64 print_integer(u64 obj) {
  * Print a boxed integer. Works correctly for 64-bit integers. Assumes signed.
  */
 u64 print_binteger(u64 obj) {
-  char* str = PrintPending.cast<char>().c();
-  if (!PrintPending.offset) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
-  }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-  kitoa((char*)PrintPending.c(), ((s64)obj) >> 3, 10, 0xffffffff, '0', 0);
+  char* str = start_print();
+  kitoa(str, ((s64)obj) >> 3, 10, 0xffffffff, '0', 0);
+  set_print_end(strend(str));
   return obj;
 }
 
@@ -1302,14 +1294,10 @@ u64 print_float(u32 f) {
   // again not sure why this is any better than cprintf("%f") or similar. Maybe a tiny bit faster?
   float ff;
   *(u32*)&ff = f;
-  char* str = PrintPending.cast<char>().c();
-  if (!PrintPending.offset) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
-  }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
+  char* str = start_print();
 
-  ftoa((char*)PrintPending.c(), ff, 0xffffffff, ' ', 4, 0);
+  ftoa(str, ff, 0xffffffff, ' ', 4, 0);
+  set_print_end(strend(str));
   return f;
 }
 
@@ -1482,14 +1470,10 @@ u64 inspect_float(u32 f) {
   cprintf("[%8x] float ", f);
 
   // likely copy-pasta - no need for this check because of the cprintf immediately before.
-  char* str = PrintPending.cast<char>().c();
-  if (!str) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
-  }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
+  char* str = start_print();
 
-  ftoa(PrintPending.cast<char>().c(), ff, -1, ' ', 4, 0);
+  ftoa(str, ff, -1, ' ', 4, 0);
+  set_print_end(strend(str));
   cprintf("\n");
   return f;
 }
@@ -10,6 +10,7 @@
 #include "kboot.h"
 #include "fileio.h"
 #include "klisten.h"
+#include "game/sce/deci2.h"
 
 /*!
  * Update GOAL message header after receiving and verify message is ok.
@@ -21,9 +22,17 @@
 u32 ReceiveToBuffer(char* buff) {
   (void)buff;
 
-  // if we received less than the size of the message header, we either got nothing, or there was an
-  // error
-  if (protoBlock.last_receive_size < (int)sizeof(ListenerMessageHeader)) {
+  s32 receive_size = protoBlock.last_receive_size;
+  if (receive_size == 0 || receive_size == -1) {
+    // nothing received yet.
+    return -1;
+  }
+
+  // if we received less than the size of the message header, there was an error
+  if (receive_size < (int)sizeof(ListenerMessageHeader)) {
+    // we got a message, but it failed to receive. Drop it so we can get the next one.
+    protoBlock.last_receive_size = -1;
+    ReleaseMessageBuffer();
     return -1;
   }
 
@@ -43,15 +52,27 @@ u32 ReceiveToBuffer(char* buff) {
   } else {
     // not our protocol, something has gone wrong.
     MsgErr("dkernel: got a bad packet to goal proto (goal #x%lx bytes %d %d %d %ld %d)\n",
-           (int64_t)protoBlock.receive_buffer, protoBlock.last_receive_size,
+           (int64_t)protoBlock.receive_buffer, receive_size,
            u32(protoBlock.receive_buffer->msg_kind), protoBlock.receive_buffer->u6,
            protoBlock.receive_buffer->msg_id, msg_size);
     protoBlock.last_receive_size = -1;
+    ReleaseMessageBuffer();
     return -1;
   }
   return msg_size;
 }
 
+/*!
+ * Tell DECI2 we are done with the message in MessBufArea, so the next one can be received into it.
+ * Added. The listener may send several messages without waiting, and they are held by the
+ * Deci2Server until this is called.
+ */
+void ReleaseMessageBuffer() {
+  if (protoBlock.socket > 0) {
+    ee::LIBRARY_sceDeci2_receive_done(protoBlock.socket);
+  }
+}
+
 /*!
  * Do a DECI2 send and block until it is complete.
  * The message type is OUTPUT
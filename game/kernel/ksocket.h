@@ -20,6 +20,11 @@
  */
 u32 ReceiveToBuffer(char* buff);
 
+/*!
+ * Tell DECI2 we are done with the message in MessBufArea, so the next one can be received into it.
+ */
+void ReleaseMessageBuffer();
+
 /*!
  * Do a DECI2 send and block until it is complete.
  * The message type is OUTPUT
@@ -36,6 +36,7 @@
 #include "game/kernel/kdgo.h"
 
 #include "game/system/iop_thread.h"
+#include "game/system/frame_stats.h"
 
 #include "game/overlord/dma.h"
 #include "game/overlord/iso.h"
@@ -152,6 +153,7 @@ void ee_runner(SystemThreadInterface& iface) {
   klisten_init_globals();
   kmemcard_init_globals();
   kprint_init_globals();
+  frame_stats_init_globals();
 
   // Added for OpenGOAL's debugger
   xdbg::allow_debugging();
@@ -56,6 +56,16 @@ void LIBRARY_sceDeci2_register(::Deci2Server* s) {
   server = s;
 }
 
+/*!
+ * Tell the server that the driver for socket s is done with the message it last received.
+ * Not in the real library. The server delivers one message at a time to a driver, and holds any
+ * others the listener has in flight until this is called.
+ */
+void LIBRARY_sceDeci2_receive_done(s32 s) {
+  assert(s - 1 < protocol_count);
+  server->receive_done(&protocols[s - 1]);
+}
+
 /*!
  * Open a new socket with given protocol number and handler.
  * The "opt" pointer is passed to the handler function.
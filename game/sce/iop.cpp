@@ -124,6 +124,7 @@ void sceSifRegisterRpc(sceSifServeData* serve,
   assert(!cfunc);
   assert(!cbuff);
   qd->serve_data = serve;
+  iop->kernel.sif_register(qd);
 }
 
 void sceSifRpcLoop(sceSifQueueData* pd) {
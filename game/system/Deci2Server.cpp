@@ -7,6 +7,8 @@
 #include <cstdio>
 #include <cassert>
 #include <utility>
+#include <algorithm>
+#include <chrono>
 
 // TODO - i think im not including the dependency right..?
 #include "common/cross_sockets/xsocket.h"
@@ -180,6 +182,22 @@ void Deci2Server::send_proto_ready(Deci2Driver* drivers, int* driver_count) {
   cv.notify_all();
 }
 
+/*!
+ * Inform server that a driver is done with its last message, so it can be given the next one.
+ */
+void Deci2Server::receive_done(Deci2Driver* driver) {
+  lock();
+  driver->receive_busy = false;
+  unlock();
+  cv.notify_all();
+}
+
+/*!
+ * Receive a single message from the listener and pass it to the protocol handler.
+ * The message is streamed: it is handed to the driver in chunks as it arrives, so it doesn't need
+ * to fit in our buffer. If the driver still holds the previous message, this waits, leaving any
+ * messages the listener has pipelined in the socket.
+ */
 void Deci2Server::run() {
   int desired_size = (int)sizeof(Deci2Header);
   int got = 0;
@@ -194,13 +212,12 @@ void Deci2Server::run() {
   }
 
   auto* hdr = (Deci2Header*)(buffer);
-  fprintf(stderr, "[DECI2] Got message: %d %d 0x%x %c -> %c\n", hdr->len, hdr->rsvd, hdr->proto,
-          hdr->src, hdr->dst);
-
-  hdr->rsvd = got;
+  fprintf(stderr, "[DECI2] Got message: %d 0x%x %c -> %c\n", hdr->len, hdr->proto, hdr->src,
+          hdr->dst);
+  u32 len = hdr->len;
 
   // see what protocol we got:
-  lock();
+  std::unique_lock<std::mutex> lk(deci_mutex);
 
   int handler = -1;
   for (int i = 0; i < *d2_driver_count; i++) {
@@ -215,38 +232,52 @@ void Deci2Server::run() {
 
   if (handler == -1) {
     printf("[DECI2] Warning: no handler for this message, ignoring...\n");
-    unlock();
     return;
   }
 
   auto& driver = d2_drivers[handler];
+  while (driver.receive_busy) {
+    if (want_exit()) {
+      return;
+    }
+    cv.wait_for(lk, std::chrono::milliseconds(100));
+  }
 
+  u32 received = got;  // total bytes of this message read from the network
+  int buffered = got;  // bytes in buffer
   int sent_to_program = 0;
-  while (!want_exit() && (hdr->rsvd < hdr->len || sent_to_program < hdr->rsvd)) {
+  while (!want_exit() && (received < len || sent_to_program < buffered)) {
     // send what we have to the program
-    if (sent_to_program < hdr->rsvd) {
-      //      driver.next_recv_size = 0;
-      //      driver.next_recv = nullptr;
+    if (sent_to_program < buffered) {
       driver.recv_buffer = buffer + sent_to_program;
-      driver.available_to_receive = hdr->rsvd - sent_to_program;
+      driver.available_to_receive = std::min(buffered - sent_to_program, DECI2_MAX_TRANSFER);
+      driver.recv_size = 0;
       (driver.handler)(DECI2_READ, driver.available_to_receive, driver.opt);
-      //      memcpy(driver.next_recv, buffer + sent_to_program, driver.next_recv_size);
-      sent_to_program += driver.recv_size;
+      // if the driver didn't take anything, it is dropping this message, so skip the data.
+      sent_to_program += driver.recv_size ? driver.recv_size : driver.available_to_receive;
+    }
+
+    // the program has everything, start over at the beginning of the buffer.
+    if (sent_to_program == buffered) {
+      sent_to_program = 0;
+      buffered = 0;
     }
 
     // receive from network
-    if (hdr->rsvd < hdr->len) {
-      auto x = read_from_socket(new_sock, buffer + hdr->rsvd, hdr->len - hdr->rsvd);
+    if (received < len && buffered < BUFFER_SIZE) {
+      auto x = read_from_socket(new_sock, buffer + buffered,
+                                std::min(len - received, u32(BUFFER_SIZE - buffered)));
       if (want_exit()) {
         return;
       }
-      got += x > 0 ? x : 0;
-      hdr->rsvd = got;
+      x = x > 0 ? x : 0;
+      received += x;
+      buffered += x;
     }
   }
 
   (driver.handler)(DECI2_READDONE, 0, driver.opt);
-  unlock();
+  driver.receive_busy = true;
 }
 
 /*!
@@ -260,8 +291,9 @@ void Deci2Server::accept_thread_func() {
     new_sock = accept(server_socket, (sockaddr*)&addr, &l);
     if (new_sock >= 0) {
       set_socket_timeout(new_sock, 100000);
-      u32 versions[2] = {versions::GOAL_VERSION_MAJOR, versions::GOAL_VERSION_MINOR};
-      write_to_socket(new_sock, (char*)&versions, 8);  // todo, check result?
+      u32 versions[3] = {versions::GOAL_VERSION_MAJOR, versions::GOAL_VERSION_MINOR,
+                         LISTENER_PROTOCOL_VERSION};
+      write_to_socket(new_sock, (char*)&versions, sizeof(versions));  // todo, check result?
       server_connected = true;
       return;
     }
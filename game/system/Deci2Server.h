@@ -33,6 +33,7 @@ class Deci2Server {
   void unlock();
   void wait_for_protos_ready();
   void send_proto_ready(Deci2Driver* drivers, int* driver_count);
+  void receive_done(Deci2Driver* driver);
 
   void run();
 
@@ -166,34 +166,71 @@ void IopThreadRecord::waitForDispatch() {
   kernelToThreadCV->wait(lck, [this] { return runThreadReady; });
 }
 
+/*!
+ * Create an RPC channel for the given queue. The channel can't be used by the EE until the queue
+ * has a serve_data registered with sif_register.
+ */
 void IOP_Kernel::set_rpc_queue(iop::sceSifQueueData* qd, u32 thread) {
-  for (const auto& r : sif_records) {
-    assert(!(r.qd == qd || r.thread_to_wake == thread));
+  std::lock_guard<std::mutex> lck(sif_mtx);
+  for (const auto& c : sif_channels) {
+    assert(!(c->qd == qd || c->thread_to_wake == thread));
   }
-  SifRecord rec;
-  rec.thread_to_wake = thread;
-  rec.qd = qd;
-  sif_records.push_back(rec);
+  auto chan = std::make_unique<SifRpcChannel>();
+  chan->thread_to_wake = thread;
+  chan->qd = qd;
+  sif_channels.push_back(std::move(chan));
 }
 
-typedef void* (*sif_rpc_handler)(unsigned int, void*, int);
+/*!
+ * Publish the channel for a queue in the lookup table, once its serve_data (and RPC ID) is known.
+ */
+void IOP_Kernel::sif_register(iop::sceSifQueueData* qd) {
+  std::lock_guard<std::mutex> lck(sif_mtx);
+  auto chan = sif_channel_for_queue(qd);
+  assert(chan);
+  assert(qd->serve_data);
+  chan->id = qd->serve_data->command;
+  auto& slot = sif_table[chan->id % SIF_RPC_TABLE_SIZE];
+  assert(!slot.load());  // RPC IDs collide in the table.
+  slot.store(chan, std::memory_order_release);
+}
 
-bool IOP_Kernel::sif_busy(u32 id) {
-  sif_mtx.lock();
-  bool rv = false;
-  bool found = false;
-  for (auto& r : sif_records) {
-    if (r.qd->serve_data->command == id) {
-      rv = !r.cmd.finished;
-      found = true;
-      break;
+/*!
+ * Find the channel for an RPC ID, or nullptr if there isn't one. Safe to call from the EE without
+ * locking.
+ */
+SifRpcChannel* IOP_Kernel::sif_channel(u32 id) {
+  auto chan = sif_table[id % SIF_RPC_TABLE_SIZE].load(std::memory_order_acquire);
+  if (!chan || chan->id != id) {
+    return nullptr;
+  }
+  return chan;
+}
+
+/*!
+ * Find the channel for an RPC queue.
+ */
+SifRpcChannel* IOP_Kernel::sif_channel_for_queue(iop::sceSifQueueData* qd) {
+  for (auto& c : sif_channels) {
+    if (c->qd == qd) {
+      return c.get();
     }
   }
-  assert(found);
-  sif_mtx.unlock();
-  return rv;
+  return nullptr;
+}
+
+typedef void* (*sif_rpc_handler)(unsigned int, void*, int);
+
+bool IOP_Kernel::sif_busy(u32 id) {
+  auto chan = sif_channel(id);
+  return chan && chan->busy();
 }
 
+/*!
+ * Queue an RPC command. If the send and receive buffers are the same (the usual case for DGO and
+ * RAMDISK commands), the IOP handler will work directly on the EE's buffer and no copying is done.
+ * Otherwise small commands are staged in the ring and large commands use the serve buffer.
+ */
 void IOP_Kernel::sif_rpc(s32 rpcChannel,
                          u32 fno,
                          bool async,
@@ -202,75 +239,66 @@ void IOP_Kernel::sif_rpc(s32 rpcChannel,
                          void* recvBuff,
                          s32 recvSize) {
   assert(async);
-  sif_mtx.lock();
   // step 1 - find entry
-  SifRecord* rec = nullptr;
-  for (auto& e : sif_records) {
-    if (e.qd->serve_data->command == (u32)rpcChannel) {
-      rec = &e;
-    }
+  auto chan = sif_channel(rpcChannel);
+  assert(chan);
+
+  // step 2 - check there's room in the ring
+  u32 head = chan->head.load(std::memory_order_relaxed);
+  u32 tail = chan->tail.load(std::memory_order_acquire);
+  assert(head - tail < SIF_RPC_RING_SIZE);
+  auto& cmd = chan->ring[head % SIF_RPC_RING_SIZE];
+
+  // step 3 - get the data to the IOP
+  if (sendBuff == recvBuff && sendBuff) {
+    cmd.buff = sendBuff;
+  } else if (sendSize <= SIF_RPC_INLINE_SIZE && recvSize <= SIF_RPC_INLINE_SIZE) {
+    // the handler may reply in the buffer it was given, so the reply has to fit too.
+    memcpy(cmd.inline_buff, sendBuff, sendSize);
+    cmd.buff = cmd.inline_buff;
+  } else {
+    // the serve buffer is shared, so this only works when nothing else is queued.
+    assert(head == tail);
+    memcpy(chan->qd->serve_data->buff, sendBuff, sendSize);
+    cmd.buff = chan->qd->serve_data->buff;
   }
-  assert(rec);
-
-  // step 2 - check entry is safe to give command to
-  assert(rec->cmd.finished && rec->cmd.started);
-
-  // step 3 - memcpy!
-  memcpy(rec->qd->serve_data->buff, sendBuff, sendSize);
 
   // step 4 - setup command
-  rec->cmd.buff = rec->qd->serve_data->buff;
-  rec->cmd.size = sendSize;
-  rec->cmd.fno = fno;
-  rec->cmd.copy_back_buff = recvBuff;
-  rec->cmd.copy_back_size = recvSize;
-  rec->cmd.started = false;
-  rec->cmd.finished = false;
-
-  sif_mtx.unlock();
+  cmd.size = sendSize;
+  cmd.fno = fno;
+  cmd.copy_back_buff = recvBuff;
+  cmd.copy_back_size = recvSize;
+
+  // step 5 - publish
+  chan->head.store(head + 1, std::memory_order_release);
 }
 
 void IOP_Kernel::rpc_loop(iop::sceSifQueueData* qd) {
+  SifRpcChannel* chan = nullptr;
+  {
+    std::lock_guard<std::mutex> lck(sif_mtx);
+    chan = sif_channel_for_queue(qd);
+  }
+  assert(chan);
+
   while (true) {
-    bool got_cmd = false;
-    SifRpcCommand cmd;
-    sif_rpc_handler func = nullptr;
-
-    // get command and mark it as started if we get it
-    sif_mtx.lock();
-    for (auto& r : sif_records) {
-      if (r.qd == qd) {
-        cmd = r.cmd;
-        got_cmd = true;
-        r.cmd.started = true;
-        func = r.qd->serve_data->func;
-      }
+    if (chan->shutdown_now.load()) {
+      return;
     }
-    sif_mtx.unlock();
-
-    // handle command
-    if (got_cmd) {
-      if (cmd.shutdown_now) {
-        return;
-      }
 
-      if (!cmd.started) {
-        // cf
-        assert(func);
-        auto data = func(cmd.fno, cmd.buff, cmd.size);
-        if (cmd.copy_back_buff && cmd.copy_back_size) {
-          memcpy(cmd.copy_back_buff, data, cmd.copy_back_size);
-        }
-
-        sif_mtx.lock();
-        for (auto& r : sif_records) {
-          if (r.qd == qd) {
-            assert(r.cmd.started);
-            r.cmd.finished = true;
-          }
-        }
-        sif_mtx.unlock();
+    // handle all queued commands
+    u32 tail = chan->tail.load(std::memory_order_relaxed);
+    while (tail != chan->head.load(std::memory_order_acquire)) {
+      auto& cmd = chan->ring[tail % SIF_RPC_RING_SIZE];
+      sif_rpc_handler func = qd->serve_data->func;
+      assert(func);
+      auto data = func(cmd.fno, cmd.buff, cmd.size);
+      if (cmd.copy_back_buff && cmd.copy_back_size && data && data != cmd.copy_back_buff) {
+        assert(data != cmd.inline_buff || cmd.copy_back_size <= SIF_RPC_INLINE_SIZE);
+        memcpy(cmd.copy_back_buff, data, cmd.copy_back_size);
       }
+      tail++;
+      chan->tail.store(tail, std::memory_order_release);
     }
     SuspendThread();
   }
@@ -291,8 +319,8 @@ void IOP_Kernel::read_disc_sectors(u32 sector, u32 sectors, void* buffer) {
 
 void IOP_Kernel::shutdown() {
   // shutdown most threads
-  for (auto& r : sif_records) {
-    r.cmd.shutdown_now = true;
+  for (auto& c : sif_channels) {
+    c->shutdown_now = true;
   }
 
   for (auto& t : threads) {
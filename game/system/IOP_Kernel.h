@@ -10,6 +10,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <memory>
 #include <cassert>
 #include "common/common_types.h"
 
@@ -18,23 +19,44 @@ namespace iop {
 struct sceSifQueueData;
 }
 
-struct SifRpcCommand {
-  bool started = true;
-  bool finished = true;
-  bool shutdown_now = false;
+// the number of RPC commands which can be queued on a single channel.
+constexpr int SIF_RPC_RING_SIZE = 4;
+// commands up to this size are copied into the ring slot instead of the shared serve buffer.
+constexpr int SIF_RPC_INLINE_SIZE = 128;
+// size of the table used to look up channels by RPC ID. All RPC IDs (0xdebX) fit without
+// collisions.
+constexpr int SIF_RPC_TABLE_SIZE = 16;
 
+struct SifRpcCommand {
   void* buff;
   int fno;
   int size;
 
   void* copy_back_buff;
   int copy_back_size;
+
+  // staging area for small commands that can't be handled zero-copy.
+  u8 inline_buff[SIF_RPC_INLINE_SIZE];
 };
 
-struct SifRecord {
-  iop::sceSifQueueData* qd;
-  SifRpcCommand cmd;
-  u32 thread_to_wake;
+/*!
+ * A single RPC channel, with a single-producer (EE) single-consumer (IOP thread) command ring.
+ * The EE pushes commands by advancing head, the IOP thread completes them by advancing tail.
+ * The channel is busy as long as head != tail.
+ */
+struct SifRpcChannel {
+  iop::sceSifQueueData* qd = nullptr;
+  u32 thread_to_wake = 0;
+  u32 id = 0;
+
+  SifRpcCommand ring[SIF_RPC_RING_SIZE];
+  std::atomic<u32> head = {0};  // written by EE only
+  std::atomic<u32> tail = {0};  // written by IOP only
+  std::atomic<bool> shutdown_now = {false};
+
+  bool busy() const {
+    return head.load(std::memory_order_relaxed) != tail.load(std::memory_order_acquire);
+  }
 };
 
 struct IopThreadRecord {
@@ -92,6 +114,7 @@ class IOP_Kernel {
   void WakeupThread(s32 id);
   void dispatchAll();
   void set_rpc_queue(iop::sceSifQueueData* qd, u32 thread);
+  void sif_register(iop::sceSifQueueData* qd);
   void rpc_loop(iop::sceSifQueueData* qd);
   void shutdown();
 
@@ -171,7 +194,10 @@ class IOP_Kernel {
   std::atomic<s32> _currentThread = {-1};
   std::vector<IopThreadRecord> threads;
   std::vector<std::queue<void*>> mbxs;
-  std::vector<SifRecord> sif_records;
+  SifRpcChannel* sif_channel(u32 id);
+  SifRpcChannel* sif_channel_for_queue(iop::sceSifQueueData* qd);
+  std::vector<std::unique_ptr<SifRpcChannel>> sif_channels;
+  std::atomic<SifRpcChannel*> sif_table[SIF_RPC_TABLE_SIZE] = {};
   bool mainThreadSleep = false;
   FILE* iso_disc_file = nullptr;
   std::mutex sif_mtx;
@@ -14,8 +14,12 @@ struct Deci2Driver {
   int recv_size = 0;
   int available_to_receive = 0;
   char pending_send = 0;
+  bool receive_busy = false;  // still holds the last message, see LIBRARY_sceDeci2_receive_done
 };
 
+// the most data that is passed to a handler in a single read or write (lengths are 16-bit).
+constexpr int DECI2_MAX_TRANSFER = 0xffff;
+
 // handler event values
 #define DECI2_READ 1
 #define DECI2_READDONE 2
@@ -0,0 +1,189 @@
+/*!
+ * @file frame_stats.cpp
+ * Frame time statistics and frame limiting for the kernel dispatch loop.
+ * The last WINDOW_SIZE frames are kept so percentiles can be computed when they are requested.
+ * Everything here is only used from the EE thread.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "frame_stats.h"
+#include "common/log/log.h"
+
+namespace {
+constexpr int WINDOW_SIZE = 512;
+
+using Clock = std::chrono::steady_clock;
+
+struct FrameTimes {
+  double frame_ms = 0;     // time from the start of this frame to the start of the next
+  double dispatch_ms = 0;  // running the GOAL kernel dispatcher
+  double listener_ms = 0;  // in WaitForMessageAndAck
+  double rpc_wait_ms = 0;  // waiting for the IOP in RpcSync
+  double link_ms = 0;      // linking object files
+};
+
+FrameTimes window[WINDOW_SIZE];
+FrameTimes current;   // accumulates the frame in progress
+FrameTimes totals;    // sums since the last reset
+u64 frame_count = 0;  // frames since the last reset
+
+int frame_limit = 0;  // frames per second, 0 for no limit.
+int log_interval = 0;
+Clock::time_point frame_start;
+Clock::time_point next_frame;
+
+double ms_since(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/*!
+ * Get the p-th percentile of a field over the frames in the window, by nearest rank.
+ */
+double percentile(double FrameTimes::*field, double p) {
+  int count = (int)std::min(frame_count, (u64)WINDOW_SIZE);
+  if (count == 0) {
+    return 0;
+  }
+  double values[WINDOW_SIZE];
+  for (int i = 0; i < count; i++) {
+    values[i] = window[i].*field;
+  }
+  int rank = std::clamp((int)(p * count + 0.999999) - 1, 0, count - 1);
+  std::nth_element(values, values + rank, values + count);
+  return values[rank];
+}
+
+/*!
+ * Wait until the next frame should start. Without a frame limit this is a short sleep so the loop
+ * doesn't use a whole core, otherwise it waits for the next frame period.
+ */
+void wait_for_next_frame() {
+  if (frame_limit <= 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+    return;
+  }
+
+  auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.) /
+                                                            frame_limit);
+  next_frame += period;
+  auto now = Clock::now();
+  if (next_frame < now) {
+    // we're behind by more than a frame, don't try to catch up.
+    next_frame = now;
+  } else {
+    std::this_thread::sleep_until(next_frame);
+  }
+}
+}  // namespace
+
+void frame_stats_init_globals() {
+  frame_limit = 0;
+  log_interval = 0;
+  frame_stats_reset();
+}
+
+void frame_stats_add_rpc_wait(double ms) {
+  current.rpc_wait_ms += ms;
+}
+
+void frame_stats_add_link(double ms) {
+  current.link_ms += ms;
+}
+
+/*!
+ * End the current frame: wait for the frame limiter, then record the frame's times.
+ */
+void frame_stats_finish_frame(double listener_ms, double dispatch_ms) {
+  wait_for_next_frame();
+
+  current.listener_ms += listener_ms;
+  current.dispatch_ms += dispatch_ms;
+  current.frame_ms = ms_since(frame_start);
+  frame_start = Clock::now();
+
+  window[frame_count % WINDOW_SIZE] = current;
+  frame_count++;
+  totals.frame_ms += current.frame_ms;
+  totals.dispatch_ms += current.dispatch_ms;
+  totals.listener_ms += current.listener_ms;
+  totals.rpc_wait_ms += current.rpc_wait_ms;
+  totals.link_ms += current.link_ms;
+  current = FrameTimes();
+
+  if (log_interval > 0 && frame_count % log_interval == 0) {
+    lg::info("[frame] frame p50 {:.3f} p99 {:.3f} ms, dispatch p50 {:.3f} p99 {:.3f} ms",
+             percentile(&FrameTimes::frame_ms, 0.5), percentile(&FrameTimes::frame_ms, 0.99),
+             percentile(&FrameTimes::dispatch_ms, 0.5),
+             percentile(&FrameTimes::dispatch_ms, 0.99));
+  }
+}
+
+/*!
+ * Forget all recorded frames.
+ */
+void frame_stats_reset() {
+  for (auto& frame : window) {
+    frame = FrameTimes();
+  }
+  totals = FrameTimes();
+  frame_count = 0;
+  frame_start = Clock::now();
+  next_frame = frame_start;
+}
+
+/*!
+ * Limit the dispatch loop to fps frames per second. 0 removes the limit.
+ */
+void frame_stats_set_limit(int fps) {
+  frame_limit = std::max(fps, 0);
+  next_frame = Clock::now();
+}
+
+/*!
+ * Log a summary every frames frames. 0 turns the log off.
+ */
+void frame_stats_set_log_interval(int frames) {
+  log_interval = std::max(frames, 0);
+}
+
+/*!
+ * Get a table of the frame times, for printing.
+ */
+std::string frame_stats_report() {
+  char buffer[256];
+  std::string result;
+  int window_count = (int)std::min(frame_count, (u64)WINDOW_SIZE);
+  if (frame_limit > 0) {
+    sprintf(buffer, "%llu frames, last %d shown, limited to %d fps\n",
+            (unsigned long long)frame_count, window_count, frame_limit);
+  } else {
+    sprintf(buffer, "%llu frames, last %d shown, no frame limit\n",
+            (unsigned long long)frame_count, window_count);
+  }
+  result += buffer;
+  sprintf(buffer, "%-10s %10s %10s %10s %12s\n", "(ms)", "p50", "p99", "max", "total");
+  result += buffer;
+
+  struct Row {
+    const char* name;
+    double FrameTimes::*field;
+  };
+  Row rows[] = {{"frame", &FrameTimes::frame_ms},
+                {"dispatch", &FrameTimes::dispatch_ms},
+                {"listener", &FrameTimes::listener_ms},
+                {"rpc-wait", &FrameTimes::rpc_wait_ms},
+                {"link", &FrameTimes::link_ms}};
+  for (auto& row : rows) {
+    double max = 0;
+    for (int i = 0; i < window_count; i++) {
+      max = std::max(max, window[i].*row.field);
+    }
+    sprintf(buffer, "%-10s %10.3f %10.3f %10.3f %12.3f\n", row.name,
+            percentile(row.field, 0.5), percentile(row.field, 0.99), max, totals.*row.field);
+    result += buffer;
+  }
+  return result;
+}
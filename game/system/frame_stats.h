@@ -0,0 +1,23 @@
+#pragma once
+
+/*!
+ * @file frame_stats.h
+ * Frame time statistics and frame limiting for the kernel dispatch loop.
+ * Everything here is only used from the EE thread.
+ */
+
+#include <string>
+#include "common/common_types.h"
+
+void frame_stats_init_globals();
+
+// time spent outside of the dispatcher, added to the current frame
+void frame_stats_add_rpc_wait(double ms);
+void frame_stats_add_link(double ms);
+
+void frame_stats_finish_frame(double listener_ms, double dispatch_ms);
+
+void frame_stats_reset();
+void frame_stats_set_limit(int fps);
+void frame_stats_set_log_interval(int frames);
+std::string frame_stats_report();
@@ -0,0 +1,230 @@
+/*!
+ * @file profiler.cpp
+ * Sampling profiler for GOAL code running on the EE thread.
+ * Samples are taken from a SIGPROF handler on a timer that counts the EE thread's CPU time.
+ * GOAL code doesn't keep frame pointers, so the call stack is found by searching the stack for
+ * anything that looks like a return address into GOAL code. This may occasionally find a stale
+ * return address, but is good enough to see where time is going.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include "profiler.h"
+#include "common/goal_constants.h"
+#include "game/runtime.h"
+
+#ifdef __linux__
+#include <ctime>
+#include <pthread.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// older glibc doesn't have a name for this.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+namespace {
+// max frames in one sample, including the sampled instruction
+constexpr int MAX_FRAMES = 32;
+// how far up the stack to search for return addresses
+constexpr u64 MAX_STACK_SCAN = 16 * 1024;
+// samples after this many are dropped.
+constexpr int MAX_SAMPLES = 64 * 1024;
+
+struct Sample {
+  u32 frame_count;
+  u32 frames[MAX_FRAMES];
+};
+
+std::unique_ptr<Sample[]> samples;
+// these are only modified by the EE thread, either in the signal handler or with the timer stopped.
+volatile sig_atomic_t profiling = 0;
+volatile int sample_count = 0;
+volatile int dropped_count = 0;
+
+// x86 addresses of GOAL memory that may contain code
+u64 code_start = 0;
+u64 code_end = 0;
+// x86 addresses of the EE thread's stack.
+u64 thread_stack_start = 0;
+u64 thread_stack_end = 0;
+
+#ifdef __linux__
+timer_t timer;
+
+bool is_code(u64 addr) {
+  return addr >= code_start && addr < code_end;
+}
+
+/*!
+ * Could this be a return address into GOAL code? GOAL always calls with call r64 (FF /2), which
+ * is FF D0+r, or 41 FF D0+r for r8 to r15.
+ */
+bool is_return_address(u64 addr) {
+  if (!is_code(addr) || !is_code(addr - 2)) {
+    return false;
+  }
+  auto* instr = (const u8*)(addr - 2);
+  return instr[0] == 0xff && (instr[1] & 0xf8) == 0xd0;
+}
+
+void sigprof_handler(int sig, siginfo_t* info, void* context) {
+  (void)sig;
+  (void)info;
+  if (!profiling) {
+    return;
+  }
+
+  if (sample_count >= MAX_SAMPLES) {
+    dropped_count = dropped_count + 1;
+    return;
+  }
+
+  auto& regs = ((ucontext_t*)context)->uc_mcontext.gregs;
+  u64 rip = regs[REG_RIP];
+  u64 rsp = regs[REG_RSP];
+  u64 ee_base = (u64)g_ee_main_mem;
+
+  auto& sample = samples[sample_count];
+  sample.frames[0] = is_code(rip) ? u32(rip - ee_base) : 0;
+  sample.frame_count = 1;
+
+  // GOAL process stacks are in GOAL memory, everything else uses the thread's stack.
+  u64 stack_end = 0;
+  if (rsp >= ee_base && rsp < ee_base + EE_MAIN_MEM_SIZE) {
+    stack_end = ee_base + EE_MAIN_MEM_SIZE;
+  } else if (rsp >= thread_stack_start && rsp < thread_stack_end) {
+    stack_end = thread_stack_end;
+  }
+  stack_end = std::min(stack_end, rsp + MAX_STACK_SCAN);
+
+  for (u64 addr = rsp; addr + 8 <= stack_end && sample.frame_count < MAX_FRAMES; addr += 8) {
+    u64 value;
+    memcpy(&value, (const void*)addr, 8);
+    if (is_return_address(value)) {
+      sample.frames[sample.frame_count++] = u32(value - ee_base);
+    }
+  }
+
+  sample_count = sample_count + 1;
+}
+#endif
+}  // namespace
+
+/*!
+ * Start sampling the calling thread, which should be the EE thread, hz times per second of CPU
+ * time. Returns false if the profiler couldn't be started.
+ */
+bool profiler_start(int hz) {
+#ifdef __linux__
+  if (profiling) {
+    printf("[Profiler] Already running\n");
+    return false;
+  }
+
+  hz = std::clamp(hz, 1, 10000);
+  code_start = (u64)g_ee_main_mem + EE_MAIN_MEM_LOW_PROTECT;
+  code_end = (u64)g_ee_main_mem + EE_MAIN_MEM_SIZE;
+
+  thread_stack_start = 0;
+  thread_stack_end = 0;
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    void* stack_addr = nullptr;
+    size_t stack_size = 0;
+    if (pthread_attr_getstack(&attr, &stack_addr, &stack_size) == 0) {
+      thread_stack_start = (u64)stack_addr;
+      thread_stack_end = thread_stack_start + stack_size;
+    }
+    pthread_attr_destroy(&attr);
+  }
+
+  if (!samples) {
+    samples = std::make_unique<Sample[]>(MAX_SAMPLES);
+  }
+  sample_count = 0;
+  dropped_count = 0;
+
+  struct sigaction action = {};
+  action.sa_sigaction = sigprof_handler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) < 0) {
+    printf("[Profiler] Failed to install SIGPROF handler: %s\n", strerror(errno));
+    return false;
+  }
+
+  sigevent event = {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = syscall(SYS_gettid);
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) < 0) {
+    printf("[Profiler] Failed to create timer: %s\n", strerror(errno));
+    return false;
+  }
+
+  itimerspec spec = {};
+  long period_ns = 1000000000L / hz;
+  spec.it_interval.tv_sec = period_ns / 1000000000L;
+  spec.it_interval.tv_nsec = period_ns % 1000000000L;
+  spec.it_value = spec.it_interval;
+
+  profiling = 1;
+  if (timer_settime(timer, 0, &spec, nullptr) < 0) {
+    printf("[Profiler] Failed to start timer: %s\n", strerror(errno));
+    profiling = 0;
+    timer_delete(timer);
+    return false;
+  }
+  printf("[Profiler] Sampling at %d Hz\n", hz);
+  return true;
+#else
+  (void)hz;
+  printf("[Profiler] Not supported on this platform\n");
+  return false;
+#endif
+}
+
+/*!
+ * Stop the profiler and get the recorded call stacks, most common first.
+ * Must be called from the same thread as profiler_start.
+ */
+std::vector<ProfileStack> profiler_stop(u32* total_samples, u32* dropped_samples) {
+  std::vector<ProfileStack> result;
+  *total_samples = 0;
+  *dropped_samples = 0;
+#ifdef __linux__
+  if (!profiling) {
+    printf("[Profiler] Not running\n");
+    return result;
+  }
+
+  // the handler is left installed, so a late signal will see this and do nothing.
+  profiling = 0;
+  timer_delete(timer);
+
+  std::map<std::vector<u32>, u32> counts;
+  for (int i = 0; i < sample_count; i++) {
+    const auto& sample = samples[i];
+    counts[std::vector<u32>(sample.frames, sample.frames + sample.frame_count)]++;
+  }
+
+  for (auto& kv : counts) {
+    result.push_back({kv.second, kv.first});
+  }
+  std::stable_sort(result.begin(), result.end(),
+                   [](const ProfileStack& a, const ProfileStack& b) { return a.count > b.count; });
+
+  *total_samples = sample_count;
+  *dropped_samples = dropped_count;
+#endif
+  return result;
+}
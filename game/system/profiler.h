@@ -0,0 +1,14 @@
+#pragma once
+
+/*!
+ * @file profiler.h
+ * Sampling profiler for GOAL code running on the EE thread.
+ * Samples are taken from a SIGPROF handler on a timer that counts the EE thread's CPU time.
+ */
+
+#include <vector>
+#include "common/common_types.h"
+#include "common/listener_common.h"
+
+bool profiler_start(int hz);
+std::vector<ProfileStack> profiler_stop(u32* total_samples, u32* dropped_samples);
@@ -46,7 +46,10 @@ std::vector<u8> CodeGenerator::run(const TypeSystem* ts) {
   }
 
   // generate a v3 object. TODO - support for v4 "data" objects.
-  return m_gen.generate_data_v3(ts).to_vector();
+  auto result = m_gen.generate_data_v3(ts).to_vector();
+  // the functions were given their offsets in the object while generating it.
+  m_debug_info->invalidate_index();
+  return result;
 }
 
 void CodeGenerator::do_function(FunctionEnv* env, int f_idx) {
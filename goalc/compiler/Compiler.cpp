@@ -80,6 +80,13 @@ ReplStatus Compiler::execute_repl() {
         }
       }
 
+      // wait for anything else still in flight, like files loaded with (ml ...)
+      if (m_listener.is_connected() && !m_listener.wait_for_all_acks()) {
+        print_compiler_warning("Runtime is not responding. Did it crash?\n");
+      }
+      // the runtime sends the profiler results before it acks the code that stopped the profiler.
+      m_debugger.report_received_profile();
+
     } catch (std::exception& e) {
       print_compiler_warning("REPL Error: {}\n", e.what());
     }
@@ -178,6 +185,10 @@ Val* Compiler::compile_error_guard(const goos::Object& code, Env* env) {
 
 void Compiler::color_object_file(FileEnv* env) {
   for (auto& f : env->functions()) {
+    if (m_settings.optimize_loops) {
+      optimize_loops(f.get(), &m_loop_stats);
+    }
+
     AllocationInput input;
     input.is_asm_function = f->is_asm_func;
     for (auto& i : f->code()) {
@@ -207,6 +218,7 @@ std::vector<u8> Compiler::codegen_object_file(FileEnv* env) {
     CodeGenerator gen(env, debug_info);
     bool ok = true;
     auto result = gen.run(&m_ts);
+    m_code_stats.add(gen.code_stats());
     for (auto& f : env->functions()) {
       if (f->settings.print_asm) {
         fmt::print("{}\n", debug_info->disassemble_function_by_name(f->name(), &ok));
@@ -226,6 +238,7 @@ bool Compiler::codegen_and_disassemble_object_file(FileEnv* env,
   debug_info->clear();
   CodeGenerator gen(env, debug_info);
   *data_out = gen.run(&m_ts);
+  m_code_stats.add(gen.code_stats());
   bool ok = true;
   *asm_out = debug_info->disassemble_all_functions(&ok);
   return ok;
@@ -239,6 +252,7 @@ void Compiler::compile_and_send_from_string(const std::string& source_code) {
 
   auto code = m_goos.reader.read_from_string(source_code);
   auto compiled = compile_object_file("test-code", code, true);
+  m_listener.wait_for_all_acks();
   assert(!compiled->is_empty());
   color_object_file(compiled);
   auto data = codegen_object_file(compiled);
@@ -246,6 +260,7 @@ void Compiler::compile_and_send_from_string(const std::string& source_code) {
   if (!m_listener.most_recent_send_was_acked()) {
     print_compiler_warning("Runtime is not responding after sending test code. Did it crash?\n");
   }
+  m_debugger.report_received_profile();
 }
 
 std::vector<std::string> Compiler::run_test_from_file(const std::string& source_code) {
@@ -256,6 +271,8 @@ std::vector<std::string> Compiler::run_test_from_file(const std::string& source_
 
     auto code = m_goos.reader.read_from_file({source_code});
     auto compiled = compile_object_file("test-code", code, true);
+    // let anything loaded while compiling, like (ml ...), finish before we start recording.
+    m_listener.wait_for_all_acks();
     if (compiled->is_empty()) {
       return {};
     }
@@ -266,6 +283,7 @@ std::vector<std::string> Compiler::run_test_from_file(const std::string& source_
     if (!m_listener.most_recent_send_was_acked()) {
       print_compiler_warning("Runtime is not responding after sending test code. Did it crash?\n");
     }
+    m_debugger.report_received_profile();
     return m_listener.stop_recording_messages();
   } catch (std::exception& e) {
     fmt::print("[Compiler] Failed to compile test program {}: {}\n", source_code, e.what());
@@ -282,6 +300,8 @@ std::vector<std::string> Compiler::run_test_from_string(const std::string& src,
 
     auto code = m_goos.reader.read_from_string({src});
     auto compiled = compile_object_file(obj_name, code, true);
+    // let anything loaded while compiling, like (ml ...), finish before we start recording.
+    m_listener.wait_for_all_acks();
     if (compiled->is_empty()) {
       return {};
     }
@@ -292,6 +312,7 @@ std::vector<std::string> Compiler::run_test_from_string(const std::string& src,
     if (!m_listener.most_recent_send_was_acked()) {
       print_compiler_warning("Runtime is not responding after sending test code. Did it crash?\n");
     }
+    m_debugger.report_received_profile();
     return m_listener.stop_recording_messages();
   } catch (std::exception& e) {
     fmt::print("[Compiler] Failed to compile test program from string {}: {}\n", src, e.what());
@@ -322,6 +343,7 @@ bool Compiler::connect_to_target() {
 void Compiler::run_front_end_on_string(const std::string& src) {
   auto code = m_goos.reader.read_from_string({src});
   compile_object_file("run-on-string", code, true);
+  m_listener.wait_for_all_acks();
 }
 
 /*!
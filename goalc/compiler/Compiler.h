@@ -13,6 +13,7 @@
 #include "goalc/debugger/Debugger.h"
 #include "goalc/emitter/Register.h"
 #include "CompilerSettings.h"
+#include "LoopOptimizer.h"
 #include "third-party/fmt/core.h"
 #include "third-party/fmt/color.h"
 #include "CompilerException.h"
@@ -30,6 +31,9 @@ class Compiler {
   ReplStatus execute_repl();
   goos::Interpreter& get_goos() { return m_goos; }
   FileEnv* compile_object_file(const std::string& name, goos::Object code, bool allow_emit);
+  void color_object_file(FileEnv* env);
+  std::vector<u8> codegen_object_file(FileEnv* env);
+  double macro_expansion_ms() const { return m_macro_expansion_ms; }
   std::unique_ptr<FunctionEnv> compile_top_level_function(const std::string& name,
                                                           const goos::Object& code,
                                                           Env* env);
@@ -46,6 +50,7 @@ class Compiler {
   void shutdown_target();
   void enable_throw_on_redefines() { m_throw_on_define_extern_redefinition = true; }
   Debugger& get_debugger() { return m_debugger; }
+  const LoopOptimizerStats& get_loop_stats() const { return m_loop_stats; }
   listener::Listener& listener() { return m_listener; }
   void poke_target() { m_listener.send_poke(); }
   bool connect_to_target();
@@ -118,8 +123,6 @@ class Compiler {
                               Env* env);
 
   SymbolVal* compile_get_sym_obj(const std::string& name, Env* env);
-  void color_object_file(FileEnv* env);
-  std::vector<u8> codegen_object_file(FileEnv* env);
   bool codegen_and_disassemble_object_file(FileEnv* env,
                                            std::vector<u8>* data_out,
                                            std::string* asm_out);
@@ -223,6 +226,9 @@ class Compiler {
   bool m_throw_on_define_extern_redefinition = false;
   SymbolInfoMap m_symbol_info;
   std::unique_ptr<ReplWrapper> m_repl;
+  emitter::CodeStats m_code_stats;  // for all object files generated since startup
+  LoopOptimizerStats m_loop_stats;  // for all functions since startup
+  double m_macro_expansion_ms = 0;  // time spent evaluating macros since startup
 
   MathMode get_math_mode(const TypeSpec& ts);
   bool is_number(const TypeSpec& ts);
@@ -11,6 +11,7 @@ CompilerSettings::CompilerSettings() {
   m_settings["disable-math-const-prop"].boolp = &disable_math_const_prop;
 
   link(print_timing, "print-timing");
+  link(optimize_loops, "optimize-loops");
 }
 
 void CompilerSettings::set(const std::string& name, const goos::Object& value) {
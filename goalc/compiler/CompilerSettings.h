@@ -15,6 +15,7 @@ class CompilerSettings {
   bool disable_math_const_prop = false;
   bool emit_move_after_return = true;
   bool print_timing = false;
+  bool optimize_loops = false;
 
   void set(const std::string& name, const goos::Object& value);
 
@@ -170,8 +170,10 @@ class FunctionEnv : public DeclareEnv {
   void finish();
   RegVal* make_ireg(TypeSpec ts, RegClass reg_class) override;
   const std::vector<std::unique_ptr<IR>>& code() const { return m_code; }
+  std::vector<std::unique_ptr<IR>>& mutable_code() { return m_code; }
   int max_vars() const { return m_iregs.size(); }
   const std::vector<IRegConstraint>& constraints() { return m_constraints; }
+  std::vector<IRegConstraint>& mutable_constraints() { return m_constraints; }
   void constrain(const IRegConstraint& c) { m_constraints.push_back(c); }
   void set_allocations(const AllocationResult& result) { m_regalloc_result = result; }
   RegVal* lexical_lookup(goos::Object sym) override;
@@ -54,6 +54,7 @@ class IR_LoadConstant64 : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  u64 value() const { return m_value; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -111,6 +112,8 @@ class IR_RegSet : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  const RegVal* dest() const { return m_dest; }
+  const RegVal* src() const { return m_src; }
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -204,6 +207,9 @@ class IR_IntegerMath : public IR {
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
   IntegerMathKind get_kind() const { return m_kind; }
+  RegVal* dest() const { return m_dest; }
+  RegVal* arg() const { return m_arg; }
+  u8 shift_amount() const { return m_shift_amount; }
 
  protected:
   IntegerMathKind m_kind;
@@ -252,6 +258,7 @@ class IR_GotoLabel : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  const Label* dest() const { return m_dest; }
 
  protected:
   const Label* m_dest = nullptr;
@@ -354,6 +361,7 @@ class IR_Asm : public IR {
  public:
   explicit IR_Asm(bool use_coloring);
   std::string get_color_suffix_string();
+  bool use_coloring() const { return m_use_coloring; }
 
  protected:
   bool m_use_coloring;
@@ -371,6 +379,7 @@ class IR_LoadConstOffset : public IR_Asm {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  const RegVal* base() const { return m_base; }
 
  private:
   const RegVal* m_dest = nullptr;
@@ -391,6 +400,8 @@ class IR_StoreConstOffset : public IR_Asm {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  const RegVal* value() const { return m_value; }
+  const RegVal* base() const { return m_base; }
 
  private:
   const RegVal* m_value = nullptr;
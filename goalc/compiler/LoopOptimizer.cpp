@@ -0,0 +1,816 @@
+/*!
+ * @file LoopOptimizer.cpp
+ * Loop optimizations on the IR of a function, run after compilation and before register allocation.
+ *
+ * Loops are found from backward jumps. A loop is only changed if it is a contiguous range of IR
+ * that is entered by falling into the top (like until) or by a goto right before the loop (like
+ * while and dotimes). Code that should run once before the loop is put in a "preheader" that runs
+ * right before the loop is entered.
+ *
+ * - Loop invariant code motion moves instructions that compute the same value on every iteration
+ *   to the preheader.
+ * - Strength reduction replaces addresses computed from an induction variable, like the address of
+ *   (-> arr i) in a dotimes, with a pointer that is set up in the preheader and incremented along
+ *   with the induction variable.
+ *
+ * Loops with function calls are left alone. Values that are kept in a register across a call are
+ * often spilled to the stack, and that costs more than recomputing them.
+ */
+
+#include <algorithm>
+#include <unordered_map>
+#include "LoopOptimizer.h"
+#include "Env.h"
+#include "IR.h"
+
+namespace {
+// stop after this many changes to one function.
+constexpr int MAX_CHANGES_PER_FUNCTION = 256;
+// limits on new values that are live through the entire loop, so we don't run out of registers.
+// These count all the changes made to a loop, not just one pass over it.
+constexpr int MAX_HOISTED_VALUES = 8;
+constexpr int MAX_REDUCED_ADDRESSES = 4;
+
+struct Loop {
+  int start = -1;  // the target of the backward jump
+  int end = -1;    // the backward jump
+  int entry = -1;  // the first instruction executed when entering the loop
+  bool entered_by_goto = false;  // if set, start - 1 is a goto to entry
+
+  bool contains(int idx) const { return idx >= start && idx <= end; }
+};
+
+/*!
+ * Changes already made to a loop, for the limits above.
+ */
+struct LoopChanges {
+  int hoisted_values = 0;
+  int reduced_addresses = 0;
+};
+
+/*!
+ * Changes to make to the code of a function. Instructions are identified by their old index.
+ */
+struct Rewrite {
+  int preheader_pos = -1;  // the preheader goes right before this instruction
+  bool preheader_is_jump_target = false;  // jumps to preheader_pos should run the preheader
+  std::vector<std::unique_ptr<IR>> preheader;
+  std::unordered_map<int, std::unique_ptr<IR>> replace;  // replace with null to remove
+  std::unordered_map<int, std::vector<std::unique_ptr<IR>>> insert_after;
+};
+
+/*!
+ * A register that is a linear function of an induction variable within a loop:
+ *   reg = scale * var + (something that doesn't change in the loop).
+ * It is computed by instructions [start, end], which are the only writes to reg in the loop.
+ */
+struct DerivedVar {
+  int start = -1;
+  int end = -1;
+  int source = -1;  // the induction variable, or another DerivedVar
+  s64 scale = 0;
+  bool imul_32 = false;  // starts with a 32-bit multiply, which may overflow
+  const RegVal* reg = nullptr;
+};
+
+class LoopOptimizer {
+ public:
+  explicit LoopOptimizer(FunctionEnv* func, LoopOptimizerStats* stats)
+      : m_func(func), m_stats(stats) {}
+  bool run_once();
+
+ private:
+  void analyze();
+  std::vector<Loop> find_loops() const;
+  bool can_optimize(const Loop& loop) const;
+  bool memory_is_invariant(const Loop& loop) const;
+  bool can_hoist(int idx, bool memory_invariant, const std::vector<bool>& always_runs) const;
+  bool is_invariant(int reg, const Loop& loop, const std::vector<bool>& hoisted, int idx) const;
+  bool get_constant(int reg, s64* value) const;
+  bool get_increment(const Loop& loop, int idx, int var, s64* step) const;
+  int count_writes_in_loop(int reg, const Loop& loop) const;
+  bool defined_before(int reg, const Loop& loop) const;
+  bool only_used_as_address(int reg, const std::unordered_map<int, DerivedVar>& derived) const;
+  bool hoist(const Loop& loop);
+  bool strength_reduce(const Loop& loop);
+  bool strength_reduce(const Loop& loop, int var, int increment, s64 step);
+  void emit_derived(const std::unordered_map<int, DerivedVar>& derived,
+                    int reg,
+                    RegVal* dest,
+                    std::vector<std::unique_ptr<IR>>* out);
+  void start_rewrite(const Loop& loop, Rewrite* rewrite) const;
+  void apply(Rewrite* rewrite);
+
+  FunctionEnv* m_func = nullptr;
+  LoopOptimizerStats* m_stats = nullptr;
+  std::unordered_map<int, LoopChanges> m_loop_changes;  // by the index of the backward jump
+
+  // analysis of the current code
+  std::vector<RegAllocInstr> m_rai;
+  std::vector<std::vector<int>> m_writes, m_reads;  // instructions, by ireg id
+  std::vector<bool> m_reg_constrained;              // by ireg id
+  std::vector<bool> m_instr_constrained;            // by instruction
+  std::vector<bool> m_jump_target;                  // by instruction
+};
+
+void LoopOptimizer::analyze() {
+  const auto& code = m_func->code();
+  int n = code.size();
+  m_rai.clear();
+  m_writes.assign(m_func->max_vars(), {});
+  m_reads.assign(m_func->max_vars(), {});
+  m_reg_constrained.assign(m_func->max_vars(), false);
+  m_instr_constrained.assign(n + 1, false);
+  m_jump_target.assign(n + 1, false);
+
+  for (int i = 0; i < n; i++) {
+    m_rai.push_back(code[i]->to_rai());
+    for (auto& w : m_rai.back().write) {
+      m_writes.at(w.id).push_back(i);
+    }
+    for (auto& r : m_rai.back().read) {
+      m_reads.at(r.id).push_back(i);
+    }
+    for (auto j : m_rai.back().jumps) {
+      m_jump_target.at(j) = true;
+    }
+  }
+
+  for (auto& c : m_func->constraints()) {
+    m_reg_constrained.at(c.ireg.id) = true;
+    if (c.instr_idx >= 0 && c.instr_idx <= n) {
+      m_instr_constrained.at(c.instr_idx) = true;
+    }
+  }
+}
+
+/*!
+ * Find loops that we know how to put a preheader in front of, innermost first.
+ */
+std::vector<Loop> LoopOptimizer::find_loops() const {
+  const auto& code = m_func->code();
+  int n = code.size();
+
+  std::vector<std::pair<int, int>> jumps;
+  for (int i = 0; i < n; i++) {
+    for (auto j : m_rai[i].jumps) {
+      jumps.emplace_back(i, j);
+    }
+  }
+
+  std::vector<Loop> result;
+  for (auto& back_edge : jumps) {
+    Loop loop;
+    loop.start = back_edge.second;
+    loop.end = back_edge.first;
+    if (loop.start > loop.end || loop.start < 2) {
+      // not a loop, or no room for a preheader that isn't at the very start of the function.
+      continue;
+    }
+
+    int outside_jumps = 0;
+    int goto_entry = -1;
+    for (auto& jump : jumps) {
+      if (!loop.contains(jump.first) && loop.contains(jump.second)) {
+        outside_jumps++;
+        if (jump.first == loop.start - 1 && dynamic_cast<IR_GotoLabel*>(code[jump.first].get())) {
+          goto_entry = jump.second;
+        }
+      }
+    }
+
+    if (outside_jumps == 0 && m_rai[loop.start - 1].fallthrough) {
+      loop.entry = loop.start;
+    } else if (outside_jumps == 1 && goto_entry >= 0) {
+      loop.entry = goto_entry;
+      loop.entered_by_goto = true;
+    } else {
+      continue;
+    }
+    result.push_back(loop);
+  }
+
+  std::stable_sort(result.begin(), result.end(), [](const Loop& a, const Loop& b) {
+    return a.end - a.start < b.end - b.start;
+  });
+  return result;
+}
+
+bool LoopOptimizer::can_optimize(const Loop& loop) const {
+  const auto& code = m_func->code();
+  for (int i = loop.start; i <= loop.end; i++) {
+    auto ir = code[i].get();
+    if (dynamic_cast<IR_FunctionCall*>(ir)) {
+      return false;
+    }
+    if (dynamic_cast<IR_Asm*>(ir) && !dynamic_cast<IR_LoadConstOffset*>(ir) &&
+        !dynamic_cast<IR_StoreConstOffset*>(ir)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Is it safe to move a load from memory out of this loop?
+ */
+bool LoopOptimizer::memory_is_invariant(const Loop& loop) const {
+  const auto& code = m_func->code();
+  for (int i = loop.start; i <= loop.end; i++) {
+    auto ir = code[i].get();
+    if (dynamic_cast<IR_StoreConstOffset*>(ir) || dynamic_cast<IR_SetSymbolValue*>(ir)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Can this instruction be run once before the loop instead of on each iteration, assuming that
+ * its inputs don't change in the loop? It must not have side effects or be able to crash.
+ * Loads from memory are only allowed if always_runs is set, meaning the original code would
+ * have done the load every time the loop is entered, and the address is valid.
+ */
+bool LoopOptimizer::can_hoist(int idx,
+                              bool memory_invariant,
+                              const std::vector<bool>& always_runs) const {
+  auto ir = m_func->code()[idx].get();
+  if (m_instr_constrained[idx] || m_rai[idx].write.size() != 1) {
+    return false;
+  }
+
+  if (dynamic_cast<IR_LoadConstant64*>(ir) || dynamic_cast<IR_LoadSymbolPointer*>(ir) ||
+      dynamic_cast<IR_StaticVarAddr*>(ir) || dynamic_cast<IR_FunctionAddr*>(ir) ||
+      dynamic_cast<IR_GetStackAddr*>(ir) || dynamic_cast<IR_RegSet*>(ir) ||
+      dynamic_cast<IR_IntToFloat*>(ir) || dynamic_cast<IR_FloatToInt*>(ir) ||
+      dynamic_cast<IR_FloatMath*>(ir)) {
+    return true;
+  }
+
+  if (auto math = dynamic_cast<IR_IntegerMath*>(ir)) {
+    switch (math->get_kind()) {
+      case IntegerMathKind::IDIV_32:
+      case IntegerMathKind::IMOD_32:
+        return false;
+      default:
+        return true;
+    }
+  }
+
+  if (dynamic_cast<IR_GetSymbolValue*>(ir) || dynamic_cast<IR_StaticVarLoad*>(ir)) {
+    return memory_invariant;
+  }
+
+  if (dynamic_cast<IR_LoadConstOffset*>(ir)) {
+    return memory_invariant && always_runs[idx];
+  }
+
+  return false;
+}
+
+/*!
+ * Will reg have the same value everywhere in the loop, if the hoisted instructions before idx are
+ * moved out of the loop?
+ */
+bool LoopOptimizer::is_invariant(int reg,
+                                 const Loop& loop,
+                                 const std::vector<bool>& hoisted,
+                                 int idx) const {
+  for (auto w : m_writes[reg]) {
+    if (loop.contains(w) && !(hoisted[w] && w < idx)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Is this register only ever set to a constant?
+ */
+bool LoopOptimizer::get_constant(int reg, s64* value) const {
+  if (m_writes[reg].size() != 1 || m_reg_constrained[reg]) {
+    return false;
+  }
+  auto load = dynamic_cast<IR_LoadConstant64*>(m_func->code()[m_writes[reg].front()].get());
+  if (!load) {
+    return false;
+  }
+  *value = load->value();
+  return true;
+}
+
+/*!
+ * Is the instruction at idx var += constant? The compiler generates this as either
+ *   addi var, const
+ * or
+ *   mov temp, const
+ *   addi temp, var
+ *   mov var, temp
+ */
+bool LoopOptimizer::get_increment(const Loop& loop, int idx, int var, s64* step) const {
+  const auto& code = m_func->code();
+  if (auto add = dynamic_cast<IR_IntegerMath*>(code[idx].get())) {
+    return add->get_kind() == IntegerMathKind::ADD_64 && add->dest()->ireg().id == var &&
+           get_constant(add->arg()->ireg().id, step);
+  }
+
+  auto set = dynamic_cast<IR_RegSet*>(code[idx].get());
+  if (!set || !loop.contains(idx - 2) || m_jump_target[idx] || m_jump_target[idx - 1]) {
+    return false;
+  }
+  int temp = set->src()->ireg().id;
+  if (m_writes[temp] != std::vector<int>{idx - 2, idx - 1}) {
+    return false;
+  }
+  auto mov = dynamic_cast<IR_RegSet*>(code[idx - 2].get());
+  auto add = dynamic_cast<IR_IntegerMath*>(code[idx - 1].get());
+  if (!mov || !add || add->get_kind() != IntegerMathKind::ADD_64) {
+    return false;
+  }
+  int a = mov->src()->ireg().id;
+  int b = add->arg()->ireg().id;
+  if (a == var) {
+    return get_constant(b, step);
+  }
+  if (b == var) {
+    return get_constant(a, step);
+  }
+  return false;
+}
+
+int LoopOptimizer::count_writes_in_loop(int reg, const Loop& loop) const {
+  int count = 0;
+  for (auto w : m_writes[reg]) {
+    if (loop.contains(w)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/*!
+ * Is every write to reg before the loop? If so, the preheader can read it.
+ */
+bool LoopOptimizer::defined_before(int reg, const Loop& loop) const {
+  const auto& writes = m_writes[reg];
+  return !writes.empty() && writes.back() < loop.start;
+}
+
+/*!
+ * Is this DerivedVar, and everything derived from it, only used as the base address of loads and
+ * stores?
+ */
+bool LoopOptimizer::only_used_as_address(int reg,
+                                         const std::unordered_map<int, DerivedVar>& derived) const {
+  const auto& code = m_func->code();
+  const auto& dv = derived.at(reg);
+  for (auto r : m_reads[reg]) {
+    if (r >= dv.start && r <= dv.end) {
+      continue;
+    }
+    auto user = m_rai[r].write.empty() ? derived.end() : derived.find(m_rai[r].write.front().id);
+    if (user != derived.end() && user->second.start == r && user->second.source == reg) {
+      if (!only_used_as_address(user->first, derived)) {
+        return false;
+      }
+      continue;
+    }
+    auto load = dynamic_cast<IR_LoadConstOffset*>(code[r].get());
+    auto store = dynamic_cast<IR_StoreConstOffset*>(code[r].get());
+    if (!(load && load->base()->ireg().id == reg) &&
+        !(store && store->base()->ireg().id == reg && store->value()->ireg().id != reg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Set up the preheader position for a loop.
+ */
+void LoopOptimizer::start_rewrite(const Loop& loop, Rewrite* rewrite) const {
+  if (loop.entered_by_goto) {
+    // put it before the goto, so anything that jumps to the goto also runs it.
+    rewrite->preheader_pos = loop.start - 1;
+    rewrite->preheader_is_jump_target = true;
+  } else {
+    // put it before the loop, but jumps back to the start of the loop should skip it.
+    rewrite->preheader_pos = loop.start;
+    rewrite->preheader_is_jump_target = false;
+  }
+}
+
+/*!
+ * Move loop invariant instructions to the preheader.
+ * Only registers that are used in the loop and nowhere else are moved. This way, it doesn't matter
+ * if the loop didn't run the instruction on every iteration, or ran zero iterations.
+ */
+bool LoopOptimizer::hoist(const Loop& loop) {
+  auto& code = m_func->mutable_code();
+  int n = code.size();
+  bool memory_invariant = memory_is_invariant(loop);
+
+  // instructions that run every time the loop is entered, before anything can branch.
+  std::vector<bool> always_runs(n, false);
+  for (int i = loop.entry; i <= loop.end; i++) {
+    always_runs[i] = true;
+    if (!m_rai[i].fallthrough || !m_rai[i].jumps.empty()) {
+      break;
+    }
+  }
+
+  auto& changes = m_loop_changes[loop.end];
+  int max_values = MAX_HOISTED_VALUES - changes.hoisted_values;
+  std::vector<bool> hoisted(n, false);
+  int hoisted_values = 0;
+  bool progress = true;
+  while (progress && hoisted_values < max_values) {
+    progress = false;
+    for (int i = loop.start; i <= loop.end && hoisted_values < max_values; i++) {
+      if (hoisted[i] || m_rai[i].write.size() != 1) {
+        continue;
+      }
+      int reg = m_rai[i].write.front().id;
+      const auto& writes = m_writes[reg];
+      if (writes.front() != i || m_reg_constrained[reg] || m_rai[i].reads(reg)) {
+        continue;
+      }
+
+      bool ok = true;
+      for (auto r : m_reads[reg]) {
+        ok = ok && loop.contains(r);
+      }
+
+      // all the writes have to be moved together, so they must be next to each other.
+      for (size_t w = 0; ok && w < writes.size(); w++) {
+        int idx = writes[w];
+        ok = idx == i + (int)w && (w == 0 || !m_jump_target[idx]) &&
+             can_hoist(idx, memory_invariant, always_runs);
+        for (auto& read : m_rai[idx].read) {
+          ok = ok && (read.id == reg || is_invariant(read.id, loop, hoisted, i));
+        }
+      }
+
+      if (ok) {
+        for (auto w : writes) {
+          hoisted[w] = true;
+        }
+        hoisted_values++;
+        progress = true;
+      }
+    }
+  }
+
+  if (!hoisted_values) {
+    return false;
+  }
+  changes.hoisted_values += hoisted_values;
+
+  Rewrite rewrite;
+  start_rewrite(loop, &rewrite);
+  for (int i = loop.start; i <= loop.end; i++) {
+    if (hoisted[i]) {
+      rewrite.preheader.push_back(std::move(code[i]));
+      rewrite.replace[i] = nullptr;
+      m_stats->hoisted++;
+    }
+  }
+  apply(&rewrite);
+  return true;
+}
+
+bool LoopOptimizer::strength_reduce(const Loop& loop) {
+  for (int i = loop.start; i <= loop.end; i++) {
+    if (m_rai[i].write.size() != 1) {
+      continue;
+    }
+    auto& var = m_rai[i].write.front();
+    s64 step;
+    if (var.reg_class == RegClass::GPR_64 && !m_reg_constrained[var.id] &&
+        count_writes_in_loop(var.id, loop) == 1 && get_increment(loop, i, var.id, &step) &&
+        strength_reduce(loop, var.id, i, step)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ * Strength reduce values computed from var, which changes by step at increment and nowhere else
+ * in the loop.
+ */
+bool LoopOptimizer::strength_reduce(const Loop& loop, int var, int increment, s64 step) {
+  const auto& code = m_func->code();
+  std::unordered_map<int, DerivedVar> derived;
+  std::vector<int> order;
+
+  for (int i = loop.start; i <= loop.end; i++) {
+    if (m_instr_constrained[i] || m_rai[i].write.size() != 1) {
+      continue;
+    }
+
+    DerivedVar dv;
+    dv.start = i;
+    int next = i + 1;
+
+    // the first instruction sets the register to scale * var.
+    if (auto set = dynamic_cast<IR_RegSet*>(code[i].get())) {
+      dv.reg = set->dest();
+      dv.source = set->src()->ireg().id;
+      if (dv.source == var) {
+        dv.scale = 1;
+      } else {
+        auto src = derived.find(dv.source);
+        if (src == derived.end()) {
+          continue;
+        }
+        // the source must be computed right before, so it's up to date.
+        bool ok = src->second.end < i;
+        for (int j = src->second.end + 1; ok && j <= i; j++) {
+          ok = !m_jump_target[j] && j != increment;
+        }
+        if (!ok) {
+          continue;
+        }
+        dv.scale = src->second.scale;
+      }
+    } else if (auto load = dynamic_cast<IR_LoadConstant64*>(code[i].get())) {
+      // a multiply by a constant that isn't a power of two, used for array indexing.
+      auto mul = i + 1 <= loop.end ? dynamic_cast<IR_IntegerMath*>(code[i + 1].get()) : nullptr;
+      if (!mul || mul->get_kind() != IntegerMathKind::IMUL_32 || mul->arg()->ireg().id != var ||
+          mul->dest()->ireg().id != m_rai[i].write.front().id || m_jump_target[i + 1] ||
+          m_instr_constrained[i + 1]) {
+        continue;
+      }
+      dv.reg = mul->dest();
+      dv.source = var;
+      dv.scale = (s64)load->value();
+      dv.imul_32 = true;
+      next = i + 2;
+    } else {
+      continue;
+    }
+
+    int reg = dv.reg->ireg().id;
+    if (reg == var || m_reg_constrained[reg] || dv.reg->ireg().reg_class != RegClass::GPR_64) {
+      continue;
+    }
+
+    // then it may add things that don't change in the loop, or multiply by a constant.
+    bool ok = true;
+    dv.end = next - 1;
+    for (int j = next; ok && j <= loop.end; j++) {
+      auto math = dynamic_cast<IR_IntegerMath*>(code[j].get());
+      if (!math || math->dest()->ireg().id != reg) {
+        break;
+      }
+      ok = !m_jump_target[j] && !m_instr_constrained[j];
+      s64 constant;
+      switch (math->get_kind()) {
+        case IntegerMathKind::SHL_64:
+          dv.scale = (s64)((u64)dv.scale << math->shift_amount());
+          break;
+        case IntegerMathKind::IMUL_64:
+          // the preheader will multiply by the same register.
+          ok = ok && get_constant(math->arg()->ireg().id, &constant) &&
+               defined_before(math->arg()->ireg().id, loop);
+          dv.scale = (s64)((u64)dv.scale * (u64)constant);
+          break;
+        case IntegerMathKind::ADD_64:
+        case IntegerMathKind::SUB_64: {
+          int arg = math->arg()->ireg().id;
+          ok = ok && arg != reg && defined_before(arg, loop);
+        } break;
+        default:
+          ok = false;
+      }
+      dv.end = j;
+    }
+
+    // it must do some math, and those must be the only writes to the register in the loop.
+    if (ok && dv.end > i && count_writes_in_loop(reg, loop) == dv.end - i + 1) {
+      derived[reg] = dv;
+      order.push_back(reg);
+    }
+  }
+
+  // the pointer is updated with 64-bit adds, which only matches a 32-bit multiply if it doesn't
+  // overflow. That's fine for addresses, which wouldn't be valid anyway, but not for other values.
+  // Values computed from one that is removed here are removed too, since they come after it.
+  std::vector<int> kept;
+  for (auto reg : order) {
+    const auto& dv = derived.at(reg);
+    if (dv.source == var ? !dv.imul_32 || only_used_as_address(reg, derived)
+                         : derived.count(dv.source) > 0) {
+      kept.push_back(reg);
+    } else {
+      derived.erase(reg);
+    }
+  }
+  order = std::move(kept);
+
+  // replace the ones used for something other than computing another DerivedVar. The others will
+  // be unused after this, and can be removed.
+  std::vector<int> replaced;
+  int removed_instructions = 0;
+  for (auto reg : order) {
+    const auto& dv = derived.at(reg);
+    bool used = false;
+    for (auto r : m_reads[reg]) {
+      if (r >= dv.start && r <= dv.end) {
+        continue;
+      }
+      auto user = m_rai[r].write.empty() ? derived.end() : derived.find(m_rai[r].write.front().id);
+      if (user == derived.end() || user->second.start != r || user->second.source != reg) {
+        used = true;
+      }
+    }
+    if (used) {
+      replaced.push_back(reg);
+      removed_instructions += dv.end - dv.start;
+    } else {
+      removed_instructions += dv.end - dv.start + 1;
+    }
+  }
+
+  // each replaced value costs an add in the loop.
+  auto& changes = m_loop_changes[loop.end];
+  if (replaced.empty() ||
+      changes.reduced_addresses + (int)replaced.size() > MAX_REDUCED_ADDRESSES ||
+      removed_instructions <= (int)replaced.size()) {
+    return false;
+  }
+  changes.reduced_addresses += replaced.size();
+
+  Rewrite rewrite;
+  start_rewrite(loop, &rewrite);
+  for (auto reg : order) {
+    const auto& dv = derived.at(reg);
+    for (int i = dv.start; i <= dv.end; i++) {
+      rewrite.replace[i] = nullptr;
+    }
+  }
+
+  std::unordered_map<u64, RegVal*> steps;  // pointers with the same step can share a register
+  for (auto reg : replaced) {
+    const auto& dv = derived.at(reg);
+    auto ptr = m_func->make_ireg(dv.reg->type(), RegClass::GPR_64);
+    emit_derived(derived, reg, ptr, &rewrite.preheader);
+    u64 ptr_step_value = (u64)dv.scale * (u64)step;
+    auto& ptr_step = steps[ptr_step_value];
+    if (!ptr_step) {
+      ptr_step = m_func->make_ireg(TypeSpec("int"), RegClass::GPR_64);
+      rewrite.preheader.push_back(std::make_unique<IR_LoadConstant64>(ptr_step, ptr_step_value));
+    }
+    rewrite.insert_after[increment].push_back(
+        std::make_unique<IR_IntegerMath>(IntegerMathKind::ADD_64, ptr, ptr_step));
+    rewrite.replace[dv.start] = std::make_unique<IR_RegSet>(dv.reg, ptr);
+    m_stats->strength_reduced++;
+  }
+
+  apply(&rewrite);
+  return true;
+}
+
+/*!
+ * Emit code that computes the value of a DerivedVar into dest, for the preheader. Other than the
+ * induction variable, the registers it reads are only set before the loop.
+ */
+void LoopOptimizer::emit_derived(const std::unordered_map<int, DerivedVar>& derived,
+                                 int reg,
+                                 RegVal* dest,
+                                 std::vector<std::unique_ptr<IR>>* out) {
+  const auto& code = m_func->code();
+  const auto& dv = derived.at(reg);
+  int i = dv.start;
+  if (auto set = dynamic_cast<IR_RegSet*>(code[i].get())) {
+    auto src = derived.find(dv.source);
+    if (src == derived.end()) {
+      out->push_back(std::make_unique<IR_RegSet>(dest, set->src()));
+    } else {
+      emit_derived(derived, dv.source, dest, out);
+    }
+    i++;
+  }
+
+  for (; i <= dv.end; i++) {
+    if (auto load = dynamic_cast<IR_LoadConstant64*>(code[i].get())) {
+      out->push_back(std::make_unique<IR_LoadConstant64>(dest, load->value()));
+    } else {
+      auto math = dynamic_cast<IR_IntegerMath*>(code[i].get());
+      assert(math);
+      if (math->get_kind() == IntegerMathKind::SHL_64) {
+        out->push_back(
+            std::make_unique<IR_IntegerMath>(math->get_kind(), dest, math->shift_amount()));
+      } else {
+        out->push_back(std::make_unique<IR_IntegerMath>(math->get_kind(), dest, math->arg()));
+      }
+    }
+  }
+}
+
+/*!
+ * Rebuild the code of the function, and update jumps and constraints to use the new indices.
+ */
+void LoopOptimizer::apply(Rewrite* rewrite) {
+  auto& code = m_func->mutable_code();
+  int n = code.size();
+  std::vector<std::unique_ptr<IR>> new_code;
+  std::vector<int> label_map(n + 1, -1);  // where a jump to the old instruction should go
+  std::vector<int> instr_map(n, -1);      // where the old instruction went
+
+  for (int i = 0; i < n; i++) {
+    if (i == rewrite->preheader_pos && rewrite->preheader_is_jump_target) {
+      label_map[i] = new_code.size();
+    }
+    if (i == rewrite->preheader_pos) {
+      for (auto& ir : rewrite->preheader) {
+        new_code.push_back(std::move(ir));
+      }
+    }
+    if (label_map[i] == -1) {
+      label_map[i] = new_code.size();
+    }
+
+    auto replacement = rewrite->replace.find(i);
+    auto ir = replacement == rewrite->replace.end() ? std::move(code[i])
+                                                    : std::move(replacement->second);
+    if (ir) {
+      instr_map[i] = new_code.size();
+      new_code.push_back(std::move(ir));
+    }
+
+    auto after = rewrite->insert_after.find(i);
+    if (after != rewrite->insert_after.end()) {
+      for (auto& new_ir : after->second) {
+        new_code.push_back(std::move(new_ir));
+      }
+    }
+  }
+  label_map[n] = new_code.size();
+
+  for (auto& ir : new_code) {
+    if (auto go = dynamic_cast<IR_GotoLabel*>(ir.get())) {
+      // labels can be shared between gotos, so make a new one.
+      auto label = m_func->alloc_unnamed_label();
+      *label = Label(m_func, label_map.at(go->dest()->idx));
+      ir = std::make_unique<IR_GotoLabel>(label);
+    } else if (auto branch = dynamic_cast<IR_ConditionalBranch*>(ir.get())) {
+      branch->label.idx = label_map.at(branch->label.idx);
+    }
+  }
+
+  for (auto& c : m_func->mutable_constraints()) {
+    if (c.instr_idx >= 0 && c.instr_idx < n) {
+      c.instr_idx = instr_map[c.instr_idx];
+      assert(c.instr_idx >= 0);
+    } else if (c.instr_idx == n) {
+      c.instr_idx = new_code.size();
+    }
+  }
+
+  code = std::move(new_code);
+
+  // jumps are never removed, so the changes to each loop can follow its backward jump.
+  std::unordered_map<int, LoopChanges> loop_changes;
+  for (auto& kv : m_loop_changes) {
+    assert(instr_map.at(kv.first) >= 0);
+    loop_changes[instr_map.at(kv.first)] = kv.second;
+  }
+  m_loop_changes = std::move(loop_changes);
+}
+
+/*!
+ * Find a loop and optimize it. Returns false if nothing changed.
+ */
+bool LoopOptimizer::run_once() {
+  analyze();
+  for (auto& loop : find_loops()) {
+    if (can_optimize(loop) && (hoist(loop) || strength_reduce(loop))) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+/*!
+ * Run loop optimizations on a function. This must happen before register allocation.
+ */
+void optimize_loops(FunctionEnv* func, LoopOptimizerStats* stats) {
+  if (func->is_asm_func) {
+    return;
+  }
+
+  // inline assembly that isn't colored uses registers the register allocator doesn't know about.
+  for (auto& ir : func->code()) {
+    auto as = dynamic_cast<IR_Asm*>(ir.get());
+    if (as && (!as->use_coloring() || dynamic_cast<IR_JumpReg*>(ir.get()))) {
+      return;
+    }
+  }
+
+  LoopOptimizer optimizer(func, stats);
+  for (int i = 0; i < MAX_CHANGES_PER_FUNCTION && optimizer.run_once(); i++) {
+  }
+}
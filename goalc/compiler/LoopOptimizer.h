@@ -0,0 +1,20 @@
+/*!
+ * @file LoopOptimizer.h
+ * Loop optimizations on the IR of a function, run after compilation and before register allocation.
+ */
+
+#pragma once
+
+#ifndef JAK_LOOPOPTIMIZER_H
+#define JAK_LOOPOPTIMIZER_H
+
+class FunctionEnv;
+
+struct LoopOptimizerStats {
+  int hoisted = 0;           // instructions moved out of a loop
+  int strength_reduced = 0;  // indexed addresses replaced with a pointer that is incremented
+};
+
+void optimize_loops(FunctionEnv* func, LoopOptimizerStats* stats);
+
+#endif  // JAK_LOOPOPTIMIZER_H
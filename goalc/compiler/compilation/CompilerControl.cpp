@@ -153,7 +153,8 @@ Val* Compiler::compile_asm_file(const goos::Object& form, const goos::Object& re
     // send to target
     if (load) {
       if (m_listener.is_connected()) {
-        m_listener.send_code(data);
+        // don't wait for the ack, so a batch of files can be loaded back to back.
+        m_listener.queue_code(data);
       } else {
         printf("WARNING - couldn't load because listener isn't connected\n");  // todo log warn
       }
@@ -343,6 +344,19 @@ Val* Compiler::compile_build_dgo(const goos::Object& form, const goos::Object& r
     build_dgo(desc);
   });
 
+  if (m_code_stats.code_bytes) {
+    int unrelaxed_bytes = m_code_stats.code_bytes + m_code_stats.bytes_saved_by_short_jumps;
+    fmt::print("[Codegen] {} of {} jumps are short, saving {} of {} code bytes ({:.2f}%)\n",
+               m_code_stats.short_jumps, m_code_stats.total_jumps,
+               m_code_stats.bytes_saved_by_short_jumps, unrelaxed_bytes,
+               100. * m_code_stats.bytes_saved_by_short_jumps / unrelaxed_bytes);
+  }
+
+  if (m_settings.optimize_loops) {
+    fmt::print("[Codegen] {} instructions were moved out of loops, {} addresses were reduced\n",
+               m_loop_stats.hoisted, m_loop_stats.strength_reduced);
+  }
+
   return get_none();
 }
 
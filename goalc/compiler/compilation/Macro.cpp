@@ -1,5 +1,6 @@
 #include "goalc/compiler/Compiler.h"
 #include "third-party/fmt/core.h"
+#include "common/util/Timer.h"
 
 using namespace goos;
 
@@ -27,6 +28,7 @@ Val* Compiler::compile_goos_macro(const goos::Object& o,
                                   const goos::Object& macro_obj,
                                   const goos::Object& rest,
                                   Env* env) {
+  Timer macro_timer;
   auto macro = macro_obj.as_macro();
   Arguments args = m_goos.get_args(o, rest, macro->args);
   auto mac_env_obj = EnvironmentObject::make_new();
@@ -39,6 +41,7 @@ Val* Compiler::compile_goos_macro(const goos::Object& o,
   // make the macro expanded form point to the source where the macro was used for error messages.
   m_goos.reader.db.inherit_info(o, goos_result);
   m_goos.goal_to_goos.reset();
+  m_macro_expansion_ms += macro_timer.getMs();
   return compile_error_guard(goos_result, env);
 }
 
@@ -211,6 +214,7 @@ bool Compiler::expand_macro_once(const goos::Object& src, goos::Object* out, Env
     return false;
   }
 
+  Timer macro_timer;
   auto macro = macro_obj.as_macro();
   Arguments args = m_goos.get_args(src, rest, macro->args);
   auto mac_env_obj = EnvironmentObject::make_new();
@@ -221,6 +225,7 @@ bool Compiler::expand_macro_once(const goos::Object& src, goos::Object* out, Env
   auto goos_result = m_goos.eval_list_return_last(macro->body, macro->body, mac_env);
   // make the macro expanded form point to the source where the macro was used for error messages.
   m_goos.reader.db.inherit_info(src, goos_result);
+  m_macro_expansion_ms += macro_timer.getMs();
 
   *out = goos_result;
   return true;
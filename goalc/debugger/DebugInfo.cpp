@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <vector>
 #include "DebugInfo.h"
@@ -22,6 +23,49 @@ std::string FunctionDebugInfo::disassemble_debug_info(bool* had_failure) {
   return result;
 }
 
+/*!
+ * Find the function containing the given offset in the given segment.
+ */
+bool DebugInfo::lookup_function(FunctionDebugInfo** info, std::string* name, u32 offset, u8 seg) {
+  if (!m_index_valid) {
+    build_index();
+  }
+
+  // find the first function starting after offset, then check the one before it.
+  auto it = std::upper_bound(m_index.begin(), m_index.end(), std::make_pair(seg, offset),
+                             [](const std::pair<u8, u32>& key, const IndexEntry& entry) {
+                               return key.first < entry.seg ||
+                                      (key.first == entry.seg && key.second < entry.start);
+                             });
+  if (it == m_index.begin()) {
+    return false;
+  }
+  it--;
+  if (it->seg != seg || offset >= it->end) {
+    return false;
+  }
+
+  *info = &m_functions.at(it->name);
+  *name = it->name;
+  return true;
+}
+
+void DebugInfo::build_index() {
+  m_index.clear();
+  m_index.reserve(m_functions.size());
+  for (auto& kv : m_functions) {
+    if (!kv.second.length) {
+      continue;  // can't contain any address
+    }
+    auto start = kv.second.offset_in_seg;
+    m_index.push_back({kv.second.seg, start, start + kv.second.length, kv.first});
+  }
+  std::sort(m_index.begin(), m_index.end(), [](const IndexEntry& a, const IndexEntry& b) {
+    return a.seg < b.seg || (a.seg == b.seg && a.start < b.start);
+  });
+  m_index_valid = true;
+}
+
 std::string DebugInfo::disassemble_all_functions(bool* had_failure) {
   std::string result;
   for (auto& kv : m_functions) {
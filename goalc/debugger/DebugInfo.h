@@ -30,28 +30,40 @@ class DebugInfo {
     }
     auto& result = m_functions[name];
     result.name = name;
+    // the offset and length aren't known yet, so the index is rebuilt on the next lookup.
+    m_index_valid = false;
     return result;
   }
 
-  bool lookup_function(FunctionDebugInfo** info, std::string* name, u32 offset, u8 seg) {
-    for (auto& kv : m_functions) {
-      auto start = kv.second.offset_in_seg;
-      auto end = start + kv.second.length;
-      if (offset >= start && offset < end && seg == kv.second.seg) {
-        *info = &kv.second;
-        *name = kv.first;
-        return true;
-      }
-    }
-    return false;
-  }
+  bool lookup_function(FunctionDebugInfo** info, std::string* name, u32 offset, u8 seg);
+
+  /*!
+   * Must be called after the offset or length of a function changes.
+   */
+  void invalidate_index() { m_index_valid = false; }
 
-  void clear() { m_functions.clear(); }
+  void clear() {
+    m_functions.clear();
+    m_index.clear();
+    m_index_valid = true;
+  }
 
   std::string disassemble_all_functions(bool* had_failure);
   std::string disassemble_function_by_name(const std::string& name, bool* had_failure);
 
  private:
+  void build_index();
+
+  // functions sorted by segment, then offset, for looking up functions by address.
+  struct IndexEntry {
+    u8 seg;
+    u32 start;
+    u32 end;
+    std::string name;
+  };
+
   std::string m_obj_name;
   std::unordered_map<std::string, FunctionDebugInfo> m_functions;
+  std::vector<IndexEntry> m_index;
+  bool m_index_valid = true;
 };
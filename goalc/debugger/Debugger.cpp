@@ -4,8 +4,12 @@
  * Uses xdbg functions to debug an OpenGOAL target.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <unordered_set>
 #include "Debugger.h"
+#include "common/util/FileUtil.h"
 #include "common/util/Timer.h"
 #include "common/goal_constants.h"
 #include "common/symbols.h"
@@ -57,6 +61,7 @@ bool Debugger::is_attached() const {
 void Debugger::detach() {
   if (is_valid() && m_attached) {
     stop_watcher();
+    invalidate_memory_cache();
     xdbg::close_memory(m_debug_context.tid, &m_memory_handle);
     xdbg::detach_and_resume(m_debug_context.tid);
     m_context_valid = false;
@@ -89,6 +94,9 @@ std::string Debugger::get_context_string() const {
  */
 bool Debugger::attach_and_break() {
   if (is_valid() && !m_attached) {
+    Timer timer;
+    invalidate_memory_cache();
+
     // reset and start the stop watcher
     clear_signal_queue();
     start_watcher();
@@ -118,6 +126,7 @@ bool Debugger::attach_and_break() {
 
       auto signal_count = get_signal_count();
       assert(signal_count == 0);
+      fmt::print("[Debugger] Attached in {:.2f} ms\n", timer.getMs());
       return true;
     }
   } else {
@@ -271,6 +280,7 @@ bool Debugger::do_continue() {
   }
 
   m_expecting_immeidate_break = false;
+  invalidate_memory_cache();
   if (!xdbg::cont_now(m_debug_context.tid)) {
     return false;
   } else {
@@ -283,8 +293,53 @@ bool Debugger::do_continue() {
  * Read memory from an attached and halted target.
  */
 bool Debugger::read_memory(u8* dest_buffer, int size, u32 goal_addr) {
+  return read_memory_batch({{dest_buffer, goal_addr, size}});
+}
+
+/*!
+ * Do many reads of memory from an attached and halted target.
+ * Pages which aren't in the memory cache yet are all read from the target together.
+ */
+bool Debugger::read_memory_batch(const std::vector<xdbg::MemoryRead>& reads) {
   assert(is_valid() && is_attached() && is_halted());
-  return xdbg::read_goal_memory(dest_buffer, size, goal_addr, m_debug_context, m_memory_handle);
+  std::vector<xdbg::MemoryRead> target_reads;
+  std::vector<u32> new_pages;
+
+  for (auto& read : reads) {
+    if (read.size <= 0) {
+      continue;
+    }
+
+    if (!is_cacheable(read.goal_addr, read.size)) {
+      target_reads.push_back(read);
+      continue;
+    }
+
+    u32 last_page = (read.goal_addr + read.size - 1) / MEMORY_CACHE_PAGE_SIZE;
+    for (u32 page = read.goal_addr / MEMORY_CACHE_PAGE_SIZE; page <= last_page; page++) {
+      auto& data = m_memory_cache[page];
+      if (data.empty()) {
+        data.resize(MEMORY_CACHE_PAGE_SIZE);
+        target_reads.push_back({data.data(), page * MEMORY_CACHE_PAGE_SIZE, int(data.size())});
+        new_pages.push_back(page);
+      }
+    }
+  }
+
+  if (!target_reads.empty() &&
+      !xdbg::read_goal_memory_batch(target_reads, m_debug_context, m_memory_handle)) {
+    for (auto page : new_pages) {
+      m_memory_cache.erase(page);
+    }
+    return false;
+  }
+
+  for (auto& read : reads) {
+    if (read.size > 0 && is_cacheable(read.goal_addr, read.size)) {
+      copy_from_memory_cache(read);
+    }
+  }
+  return true;
 }
 
 /*!
@@ -292,7 +347,59 @@ bool Debugger::read_memory(u8* dest_buffer, int size, u32 goal_addr) {
  */
 bool Debugger::write_memory(const u8* src_buffer, int size, u32 goal_addr) {
   assert(is_valid() && is_attached() && is_halted());
-  return xdbg::write_goal_memory(src_buffer, size, goal_addr, m_debug_context, m_memory_handle);
+  if (!xdbg::write_goal_memory(src_buffer, size, goal_addr, m_debug_context, m_memory_handle)) {
+    return false;
+  }
+  update_memory_cache(src_buffer, size, goal_addr);
+  return true;
+}
+
+/*!
+ * Should this read go through the memory cache? Large reads and reads outside of the normal EE
+ * memory go straight to the target.
+ */
+bool Debugger::is_cacheable(u32 goal_addr, int size) const {
+  return size <= MEMORY_CACHE_MAX_READ && goal_addr >= EE_MAIN_MEM_LOW_PROTECT &&
+         u64(goal_addr) + size <= EE_MAIN_MEM_SIZE;
+}
+
+/*!
+ * Copy the data for a read out of the memory cache. All the pages must be cached.
+ */
+void Debugger::copy_from_memory_cache(const xdbg::MemoryRead& read) {
+  u32 addr = read.goal_addr;
+  u32 end = read.goal_addr + read.size;
+  while (addr < end) {
+    u32 page_offset = addr % MEMORY_CACHE_PAGE_SIZE;
+    u32 count = std::min(end - addr, MEMORY_CACHE_PAGE_SIZE - page_offset);
+    const auto& data = m_memory_cache.at(addr / MEMORY_CACHE_PAGE_SIZE);
+    memcpy(read.dest + (addr - read.goal_addr), data.data() + page_offset, count);
+    addr += count;
+  }
+}
+
+/*!
+ * Update any cached pages after writing to the target's memory.
+ */
+void Debugger::update_memory_cache(const u8* src_buffer, int size, u32 goal_addr) {
+  u32 addr = goal_addr;
+  u32 end = goal_addr + size;
+  while (addr < end) {
+    u32 page_offset = addr % MEMORY_CACHE_PAGE_SIZE;
+    u32 count = std::min(end - addr, MEMORY_CACHE_PAGE_SIZE - page_offset);
+    auto kv = m_memory_cache.find(addr / MEMORY_CACHE_PAGE_SIZE);
+    if (kv != m_memory_cache.end()) {
+      memcpy(kv->second.data() + page_offset, src_buffer + (addr - goal_addr), count);
+    }
+    addr += count;
+  }
+}
+
+/*!
+ * Forget all cached memory. Must be done whenever the target runs.
+ */
+void Debugger::invalidate_memory_cache() {
+  m_memory_cache.clear();
 }
 
 /*!
@@ -310,7 +417,7 @@ void Debugger::read_symbol_table() {
   std::vector<u8> mem;
   mem.resize(0x20000);
 
-  if (!xdbg::read_goal_memory(mem.data(), 0x20000, st_base, m_debug_context, m_memory_handle)) {
+  if (!read_memory(mem.data(), 0x20000, st_base)) {
     fmt::print("Read failed during read_symbol_table\n");
     return;
   }
@@ -331,6 +438,14 @@ void Debugger::read_symbol_table() {
   m_symbol_offset_to_name_map.clear();
   m_symbol_name_to_value_map.clear();
 
+  constexpr int STR_BUFF_SIZE = 128;
+  struct SymRead {
+    u32 offset;
+    const SymLower* sym;
+  };
+  std::vector<SymRead> syms;
+  std::vector<xdbg::MemoryRead> str_reads;
+
   u32 sym_type = 0;
   // now loop through all the symbols
   for (int i = 0; i < (SYM_INFO_OFFSET + 4) / int(sizeof(SymLower)); i++) {
@@ -352,44 +467,54 @@ void Debugger::read_symbol_table() {
 
       // now get the info
       auto info = (SymUpper*)(mem.data() + i * sizeof(SymLower) + SYM_INFO_OFFSET + BASIC_OFFSET);
+      syms.push_back({u32(offset), sym});
+      str_reads.push_back({nullptr, info->str + 4, STR_BUFF_SIZE});
+    }
+  }
 
-      // now get the string.
-      char str_buff[128];
-      if (!xdbg::read_goal_memory((u8*)str_buff, 128, info->str + 4, m_debug_context,
-                                  m_memory_handle)) {
-        fmt::print("Read symbol string failed during read_symbol_table\n");
-        return;
-      }
-      reads++;
-      bytes_read += 128;
-      // just in case
-      str_buff[127] = '\0';
-      assert(strlen(str_buff) < 50);
-      std::string str(str_buff);
-
-      // GOAL sym - s7
-      auto sym_offset = s32(offset + st_base + BASIC_OFFSET) - s32(m_debug_context.s7);
-      assert(sym_offset >= INT16_MIN);
-      assert(sym_offset <= INT16_MAX);
-
-      // update maps
-      if (m_symbol_name_to_offset_map.find(str) != m_symbol_name_to_offset_map.end()) {
-        if (str == "asize-of-basic-func") {
-          // this is an actual bug in kscheme. The bug has no effect, but we replicate it so that
-          // the symbol table layout is closer.
-
-          // to hide this duplicate symbol, we append "-hack-copy" to the end of it.
-          str += "-hack-copy";
-        } else {
-          fmt::print("Symbol {} appears multiple times!\n", str);
-          assert(false);
-        }
+  // now get all the strings at once.
+  std::vector<char> str_buffs(str_reads.size() * STR_BUFF_SIZE);
+  for (size_t i = 0; i < str_reads.size(); i++) {
+    str_reads[i].dest = (u8*)str_buffs.data() + i * STR_BUFF_SIZE;
+  }
+  if (!read_memory_batch(str_reads)) {
+    fmt::print("Read symbol string failed during read_symbol_table\n");
+    return;
+  }
+  reads++;
+  bytes_read += str_buffs.size();
+
+  for (size_t i = 0; i < syms.size(); i++) {
+    auto offset = syms[i].offset;
+    auto sym = syms[i].sym;
+    char* str_buff = str_buffs.data() + i * STR_BUFF_SIZE;
+    // just in case
+    str_buff[STR_BUFF_SIZE - 1] = '\0';
+    assert(strlen(str_buff) < 50);
+    std::string str(str_buff);
+
+    // GOAL sym - s7
+    auto sym_offset = s32(offset + st_base + BASIC_OFFSET) - s32(m_debug_context.s7);
+    assert(sym_offset >= INT16_MIN);
+    assert(sym_offset <= INT16_MAX);
+
+    // update maps
+    if (m_symbol_name_to_offset_map.find(str) != m_symbol_name_to_offset_map.end()) {
+      if (str == "asize-of-basic-func") {
+        // this is an actual bug in kscheme. The bug has no effect, but we replicate it so that
+        // the symbol table layout is closer.
+
+        // to hide this duplicate symbol, we append "-hack-copy" to the end of it.
+        str += "-hack-copy";
+      } else {
+        fmt::print("Symbol {} appears multiple times!\n", str);
+        assert(false);
       }
-
-      m_symbol_name_to_offset_map[str] = sym_offset;
-      m_symbol_offset_to_name_map[sym_offset] = str;
-      m_symbol_name_to_value_map[str] = sym->value;
     }
+
+    m_symbol_name_to_offset_map[str] = sym_offset;
+    m_symbol_offset_to_name_map[sym_offset] = str;
+    m_symbol_name_to_value_map[str] = sym->value;
   }
 
   assert(m_symbol_offset_to_name_map.size() == m_symbol_name_to_offset_map.size());
@@ -605,4 +730,173 @@ DebugInfo& Debugger::get_debug_info_for_object(const std::string& object_name) {
   }
 
   return m_debug_info.insert(std::make_pair(object_name, DebugInfo(object_name))).first->second;
-}
\ No newline at end of file
+}
+
+/*!
+ * Get the name of the GOAL function containing the given address. If ir_out is set, also gets the
+ * IR for the instruction at the address. For return addresses, looks at the call instead.
+ */
+std::string Debugger::describe_code_address(listener::MemoryMap& memory_map,
+                                            u32 goal_addr,
+                                            bool is_return,
+                                            std::string* ir_out) {
+  if (!goal_addr) {
+    return "[not GOAL code]";
+  }
+
+  u32 addr = is_return ? goal_addr - 1 : goal_addr;
+  const auto& map_loc = memory_map.lookup(addr);
+  if (map_loc.empty) {
+    return fmt::format("[unknown 0x{:x}]", goal_addr);
+  }
+
+  u32 obj_offset = addr - map_loc.start_addr;
+  FunctionDebugInfo* info = nullptr;
+  std::string name;
+  if (!get_debug_info_for_object(map_loc.obj_name)
+           .lookup_function(&info, &name, obj_offset, map_loc.seg_id)) {
+    return fmt::format("{}+0x{:x}", map_loc.obj_name, obj_offset);
+  }
+
+  if (ir_out) {
+    int function_offset = obj_offset - info->offset_in_seg;
+    const InstructionInfo* instr = nullptr;
+    for (auto& x : info->instructions) {
+      if (x.offset > function_offset) {
+        break;
+      }
+      instr = &x;
+    }
+
+    if (instr) {
+      switch (instr->kind) {
+        case InstructionInfo::Kind::PROLOGUE:
+          *ir_out = "(prologue)";
+          break;
+        case InstructionInfo::Kind::EPILOGUE:
+          *ir_out = "(epilogue)";
+          break;
+        case InstructionInfo::Kind::IR:
+          *ir_out = info->irs.at(instr->ir_idx);
+          break;
+      }
+    }
+  }
+  return name;
+}
+
+/*!
+ * Report the results of the profiler, if the listener received them since the last call.
+ * This uses the debug info, so it must run on the compiler's thread, not the listener's.
+ */
+bool Debugger::report_received_profile() {
+  std::vector<ProfileStack> stacks;
+  u32 total_samples = 0, dropped_samples = 0;
+  if (!m_listener->take_received_profile(&stacks, &total_samples, &dropped_samples)) {
+    return false;
+  }
+  report_profile(stacks, total_samples, dropped_samples);
+  return true;
+}
+
+/*!
+ * Print the results of the profiler, as a flat profile of functions and IR, and the most common
+ * call stacks. All call stacks are also written to log/profile.folded, in the format used by
+ * flamegraph tools.
+ */
+void Debugger::report_profile(const std::vector<ProfileStack>& stacks,
+                              u32 total_samples,
+                              u32 dropped_samples) {
+  auto memory_map = m_listener->build_memory_map();
+  std::unordered_map<std::string, u32> function_self, function_total, ir_self, folded;
+  u32 sample_count = 0;
+
+  for (auto& stack : stacks) {
+    if (stack.frames.empty()) {
+      continue;
+    }
+    sample_count += stack.count;
+
+    std::string ir;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < stack.frames.size(); i++) {
+      names.push_back(describe_code_address(memory_map, stack.frames[i], i > 0,
+                                            i == 0 ? &ir : nullptr));
+    }
+
+    function_self[names.front()] += stack.count;
+    if (!ir.empty()) {
+      ir_self[fmt::format("{}: {}", names.front(), ir)] += stack.count;
+    }
+
+    // recursive functions only count once per sample.
+    std::unordered_set<std::string> seen;
+    for (auto& name : names) {
+      if (seen.insert(name).second) {
+        function_total[name] += stack.count;
+      }
+    }
+
+    std::string line;
+    for (auto it = names.rbegin(); it != names.rend(); it++) {
+      if (!line.empty()) {
+        line += ';';
+      }
+      line += *it;
+    }
+    folded[line] += stack.count;
+  }
+
+  auto sorted = [](const std::unordered_map<std::string, u32>& counts) {
+    std::vector<std::pair<std::string, u32>> result(counts.begin(), counts.end());
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+      return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return result;
+  };
+  auto percent = [&](u32 count) { return sample_count ? 100. * count / sample_count : 0.; };
+
+  constexpr int MAX_LINES = 20;
+  std::string result = fmt::format("Profile: {} samples, {} dropped\n", total_samples,
+                                   dropped_samples);
+  result += " self %  total %  function\n";
+  int lines = 0;
+  for (auto& kv : sorted(function_self)) {
+    if (lines++ == MAX_LINES) {
+      break;
+    }
+    result += fmt::format("{:6.2f}   {:6.2f}   {}\n", percent(kv.second),
+                          percent(function_total.at(kv.first)), kv.first);
+  }
+
+  result += " self %  ir\n";
+  lines = 0;
+  for (auto& kv : sorted(ir_self)) {
+    if (lines++ == MAX_LINES) {
+      break;
+    }
+    result += fmt::format("{:6.2f}   {}\n", percent(kv.second), kv.first);
+  }
+
+  auto sorted_folded = sorted(folded);
+  result += " count   call stack\n";
+  lines = 0;
+  for (auto& kv : sorted_folded) {
+    if (lines++ == MAX_LINES) {
+      break;
+    }
+    result += fmt::format("{:6}   {}\n", kv.second, kv.first);
+  }
+
+  std::string folded_text;
+  for (auto& kv : sorted_folded) {
+    folded_text += fmt::format("{} {}\n", kv.first, kv.second);
+  }
+  file_util::create_dir_if_needed(file_util::get_file_path({"log"}));
+  auto folded_path = file_util::get_file_path({"log", "profile.folded"});
+  file_util::write_text_file(folded_path, folded_text);
+  result += fmt::format("Wrote call stacks to {}\n", folded_path);
+
+  fmt::print("{}", result);
+  m_last_profile_report = result;
+}
@@ -11,7 +11,9 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <vector>
 #include "common/common_types.h"
+#include "common/listener_common.h"
 #include "common/cross_os_debug/xdbg.h"
 #include "goalc/listener/MemoryMap.h"
 #include "DebugInfo.h"
@@ -52,6 +54,7 @@ class Debugger {
   bool do_break();
   bool do_continue();
   bool read_memory(u8* dest_buffer, int size, u32 goal_addr);
+  bool read_memory_batch(const std::vector<xdbg::MemoryRead>& reads);
   bool write_memory(const u8* src_buffer, int size, u32 goal_addr);
   void read_symbol_table();
   u32 get_symbol_address(const std::string& sym_name);
@@ -61,6 +64,8 @@ class Debugger {
   void update_break_info();
   DebugInfo& get_debug_info_for_object(const std::string& object_name);
   const BreakInfo& get_cached_break_info() { return m_break_info; }
+  bool report_received_profile();
+  const std::string& get_last_profile_report() const { return m_last_profile_report; }
 
   /*!
    * Get the x86 address of GOAL memory
@@ -109,6 +114,11 @@ class Debugger {
   static constexpr int INSTR_DUMP_SIZE_REV = 32;
   static constexpr int INSTR_DUMP_SIZE_FWD = 64;
 
+  // target memory is cached by page while halted, so nearby reads don't go back to the target.
+  static constexpr u32 MEMORY_CACHE_PAGE_SIZE = 4096;
+  // reads larger than this skip the cache
+  static constexpr int MEMORY_CACHE_MAX_READ = 256 * 1024;
+
   // symbol table info (all s7-relative offsets)
   std::unordered_map<std::string, s32> m_symbol_name_to_offset_map;
   std::unordered_map<std::string, u32> m_symbol_name_to_value_map;
@@ -127,6 +137,17 @@ class Debugger {
   void stop_watcher();
   void watcher();
   void update_continue_info();
+  void report_profile(const std::vector<ProfileStack>& stacks,
+                      u32 total_samples,
+                      u32 dropped_samples);
+  std::string describe_code_address(listener::MemoryMap& memory_map,
+                                    u32 goal_addr,
+                                    bool is_return,
+                                    std::string* ir_out);
+  bool is_cacheable(u32 goal_addr, int size) const;
+  void copy_from_memory_cache(const xdbg::MemoryRead& read);
+  void update_memory_cache(const u8* src_buffer, int size, u32 goal_addr);
+  void invalidate_memory_cache();
 
   struct Breakpoint {
     u32 goal_addr = 0;  // address to break at
@@ -166,7 +187,11 @@ class Debugger {
 
   BreakInfo m_break_info;
 
+  // page index -> page data
+  std::unordered_map<u32, std::vector<u8>> m_memory_cache;
+
   listener::Listener* m_listener = nullptr;
   listener::MemoryMap m_memory_map;
   std::unordered_map<std::string, DebugInfo> m_debug_info;
+  std::string m_last_profile_report;
 };
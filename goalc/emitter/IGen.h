@@ -1920,6 +1920,30 @@ class IGen {
     return instr;
   }
 
+  /*!
+   * Jump, 8-bit constant offset.  The offset is by default 0 and must be patched later.
+   */
+  static Instruction jmp_8() {
+    Instruction instr(0xeb);
+    instr.set(Imm(1, 0));
+    return instr;
+  }
+
+  /*!
+   * Convert a jump from one of the _32 functions above to the same jump with an 8-bit offset.
+   * The conditional jumps 0f 8x rel32 become 7x rel8.
+   */
+  static Instruction jump_32_to_8(const Instruction& jump) {
+    assert(jump.get_imm_size() == 4);
+    if (jump.op == 0xe9) {
+      return jmp_8();
+    }
+    assert(jump.op == 0x0f && jump.op2_set && (jump.op2 & 0xf0) == 0x80);
+    Instruction instr(jump.op2 - 0x10);
+    instr.set(Imm(1, 0));
+    return instr;
+  }
+
   //;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
   //   FLOAT MATH
   //;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -4,7 +4,7 @@
  *
  * There are 5 steps:
  * 1. The user adds static data / instructions and specifies links.
- * 2. The functions and static data are laid out in memory
+ * 2. Jumps are shortened where possible, then the functions and static data are laid out in memory
  * 3. The user specified links are updated according to the memory layout, and jumps are patched
  * 4. The link table is generated for each segment
  * 5. All segments and link tables are put into a final object file, along with a header.
@@ -14,6 +14,7 @@
  */
 
 #include "ObjectGenerator.h"
+#include "IGen.h"
 #include "goalc/debugger/DebugInfo.h"
 #include "common/goal_constants.h"
 #include "common/versions.h"
@@ -28,44 +29,49 @@ namespace emitter {
 ObjectFileData ObjectGenerator::generate_data_v3(const TypeSystem* ts) {
   ObjectFileData out;
 
+  // pick jump encodings (step 2, part 0)
+  for (int seg = N_SEG; seg-- > 0;) {
+    relax_jumps(seg);
+  }
+
   // do functions (step 2, part 1)
   for (int seg = N_SEG; seg-- > 0;) {
     auto& data = m_data_by_seg.at(seg);
+    // the instructions are already encoded, so we know (almost) exactly how big the segment is.
+    size_t max_size = data.size();
+    for (auto& function : m_function_data_by_seg.at(seg)) {
+      max_size += function.min_align + POINTER_SIZE + function.code.size();
+    }
+    for (auto& s : m_static_data_by_seg.at(seg)) {
+      max_size += s.min_align + s.data.size();
+    }
+    data.reserve(max_size);
+
     // loop over functions in this segment
     for (auto& function : m_function_data_by_seg.at(seg)) {
       // align
-      while (data.size() % function.min_align) {
-        insert_data<u8>(seg, 0);
-      }
+      align_data(seg, function.min_align);
 
       // add a type tag link
       m_type_ptr_links_by_seg.at(seg)["function"].push_back(data.size());
 
       // add room for a type tag
-      for (int i = 0; i < POINTER_SIZE; i++) {
-        insert_data<u8>(seg, 0xae);
-      }
+      data.insert(data.end(), POINTER_SIZE, 0xae);
 
       // add debug info for the function start
-      function.debug->offset_in_seg = m_data_by_seg.at(seg).size();
+      function.debug->offset_in_seg = data.size();
       function.debug->seg = seg;
 
       // insert instructions!
-
+      function.offset_in_seg = data.size();
+      data.insert(data.end(), function.code.begin(), function.code.end());
       for (size_t instr_idx = 0; instr_idx < function.instructions.size(); instr_idx++) {
-        const auto& instr = function.instructions[instr_idx];
-        u8 temp[128];
-        auto count = instr.emit(temp);
-        assert(count < 128);
-        function.instruction_to_byte_in_data.push_back(data.size());
         function.debug->instructions.at(instr_idx).offset =
-            data.size() - function.debug->offset_in_seg;
-        for (int i = 0; i < count; i++) {
-          insert_data<u8>(seg, temp[i]);
-        }
+            function.instruction_offsets.at(instr_idx);
       }
 
-      function.debug->length = m_data_by_seg.at(seg).size() - function.debug->offset_in_seg;
+      function.debug->length = function.code.size();
+      m_code_stats.code_bytes += function.debug->length;
     }
   }
 
@@ -74,9 +80,7 @@ ObjectFileData ObjectGenerator::generate_data_v3(const TypeSystem* ts) {
     auto& data = m_data_by_seg.at(seg);
     for (auto& s : m_static_data_by_seg.at(seg)) {
       // align
-      while (data.size() % s.min_align) {
-        insert_data<u8>(seg, 0);
-      }
+      align_data(seg, s.min_align);
 
       s.location = data.size();
 
@@ -182,7 +186,7 @@ InstructionRecord ObjectGenerator::add_instr(Instruction inst, IR_Record ir) {
   rec.ir_id = ir.ir_id;
   auto& func_data = m_function_data_by_seg.at(rec.seg).at(rec.func_id);
   rec.instr_id = int(func_data.instructions.size());
-  func_data.instructions.emplace_back(inst);
+  func_data.add_instr(inst);
   auto debug = m_function_data_by_seg.at(ir.seg).at(ir.func_id).debug;
   debug->instructions.emplace_back(inst, InstructionInfo::Kind::IR, ir.ir_id);
   return rec;
@@ -192,10 +196,49 @@ void ObjectGenerator::add_instr_no_ir(FunctionRecord func,
                                       Instruction inst,
                                       InstructionInfo::Kind kind) {
   auto info = InstructionInfo(inst, kind);
-  m_function_data_by_seg.at(func.seg).at(func.func_id).instructions.emplace_back(inst);
+  m_function_data_by_seg.at(func.seg).at(func.func_id).add_instr(inst);
   func.debug->instructions.push_back(info);
 }
 
+/*!
+ * Add an instruction to the end of the function and encode it.
+ */
+void ObjectGenerator::FunctionData::add_instr(const Instruction& inst) {
+  instructions.push_back(inst);
+  u8 temp[128];
+  auto count = inst.emit(temp);
+  assert(count < 128);
+  code.insert(code.end(), temp, temp + count);
+  instruction_offsets.push_back(int(code.size()));
+}
+
+/*!
+ * Update the encoded instructions after the instructions marked in changed were modified.
+ * The other instructions are copied from the old encoding.
+ */
+void ObjectGenerator::FunctionData::reencode(const std::vector<bool>& changed) {
+  std::vector<u8> old_code = std::move(code);
+  std::vector<int> old_offsets = std::move(instruction_offsets);
+  code.clear();
+  code.reserve(old_code.size());
+  instruction_offsets.clear();
+  instruction_offsets.reserve(old_offsets.size());
+  instruction_offsets.push_back(0);
+
+  for (size_t i = 0; i < instructions.size(); i++) {
+    if (changed.at(i)) {
+      u8 temp[128];
+      auto count = instructions[i].emit(temp);
+      assert(count < 128);
+      code.insert(code.end(), temp, temp + count);
+    } else {
+      code.insert(code.end(), old_code.begin() + old_offsets.at(i),
+                  old_code.begin() + old_offsets.at(i + 1));
+    }
+    instruction_offsets.push_back(int(code.size()));
+  }
+}
+
 /*!
  * Create a new static object in the given segment.
  */
@@ -344,6 +387,77 @@ void ObjectGenerator::handle_temp_static_ptr_links(int seg) {
   }
 }
 
+/*!
+ * Branch relaxation for m_jump_temp_links_by_seg, before memory layout.
+ * All jumps are added with a 32-bit offset, but most of them can reach their destination with an
+ * 8-bit offset. Shortening a jump never moves any other jump farther from its destination, so we
+ * start with all jumps long and keep shortening until nothing changes.
+ */
+void ObjectGenerator::relax_jumps(int seg) {
+  auto& functions = m_function_data_by_seg.at(seg);
+  std::vector<std::vector<const JumpLink*>> links_by_function(functions.size());
+  for (const auto& link : m_jump_temp_links_by_seg.at(seg)) {
+    links_by_function.at(link.jump_instr.func_id).push_back(&link);
+    m_code_stats.total_jumps++;
+  }
+
+  for (size_t func_id = 0; func_id < functions.size(); func_id++) {
+    auto& function = functions.at(func_id);
+    const auto& links = links_by_function.at(func_id);
+    if (links.empty()) {
+      continue;
+    }
+
+    // offset of each instruction from the start of the function, plus the end of the function.
+    // these may be stale after a jump is shortened, but only ever too big, so the distances we
+    // compute from them can only be too large.
+    std::vector<int> offsets = function.instruction_offsets;
+    std::vector<int> lengths(function.instructions.size());
+    for (size_t i = 0; i < lengths.size(); i++) {
+      lengths[i] = offsets[i + 1] - offsets[i];
+    }
+    std::vector<bool> shortened(function.instructions.size(), false);
+    bool any_shortened = false;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (size_t i = 0; i < lengths.size(); i++) {
+        offsets[i + 1] = offsets[i] + lengths[i];
+      }
+
+      for (auto* link : links) {
+        auto& jump_instr = function.instructions.at(link->jump_instr.instr_id);
+        if (jump_instr.get_imm_size() != 4) {
+          continue;  // already short
+        }
+
+        auto short_instr = IGen::jump_32_to_8(jump_instr);
+        int savings = jump_instr.length() - short_instr.length();
+        int source = offsets.at(link->jump_instr.instr_id);
+        int dest = offsets.at(function.ir_to_instruction.at(link->dest.ir_id));
+        if (dest > source) {
+          dest -= savings;
+        }
+        int disp = dest - (source + short_instr.length());
+        if (disp >= INT8_MIN && disp <= INT8_MAX) {
+          jump_instr = short_instr;
+          function.debug->instructions.at(link->jump_instr.instr_id).instruction = short_instr;
+          lengths.at(link->jump_instr.instr_id) = short_instr.length();
+          shortened.at(link->jump_instr.instr_id) = true;
+          m_code_stats.short_jumps++;
+          m_code_stats.bytes_saved_by_short_jumps += savings;
+          changed = true;
+          any_shortened = true;
+        }
+      }
+    }
+
+    if (any_shortened) {
+      function.reencode(shortened);
+    }
+  }
+}
+
 /*!
  * m_jump_temp_links_by_seg patching after memory layout is done
  */
@@ -358,20 +472,25 @@ void ObjectGenerator::handle_temp_jump_links(int seg) {
     assert(link.jump_instr.seg == seg);
     assert(link.dest.seg == seg);
     const auto& jump_instr = function.instructions.at(link.jump_instr.instr_id);
-    assert(jump_instr.get_imm_size() == 4);
+    assert(jump_instr.get_imm_size() == 4 || jump_instr.get_imm_size() == 1);
 
     // 1). patch = instruction location + location of imm in instruction.
-    int patch_location = function.instruction_to_byte_in_data.at(link.jump_instr.instr_id) +
+    int patch_location = function.instruction_location(link.jump_instr.instr_id) +
                          jump_instr.offset_of_imm();
 
     // 2). source rip = jump instr + 1 location
-    int source_rip = function.instruction_to_byte_in_data.at(link.jump_instr.instr_id + 1);
+    int source_rip = function.instruction_location(link.jump_instr.instr_id + 1);
 
     // 3). dest rip = first instruction of dest IR
     int dest_rip =
-        function.instruction_to_byte_in_data.at(function.ir_to_instruction.at(link.dest.ir_id));
+        function.instruction_location(function.ir_to_instruction.at(link.dest.ir_id));
 
-    patch_data<s32>(seg, patch_location, dest_rip - source_rip);
+    if (jump_instr.get_imm_size() == 1) {
+      assert(dest_rip - source_rip >= INT8_MIN && dest_rip - source_rip <= INT8_MAX);
+      patch_data<s8>(seg, patch_location, dest_rip - source_rip);
+    } else {
+      patch_data<s32>(seg, patch_location, dest_rip - source_rip);
+    }
   }
 }
 
@@ -387,7 +506,7 @@ void ObjectGenerator::handle_temp_instr_sym_links(int seg) {
       assert(seg == link.rec.seg);
       const auto& function = m_function_data_by_seg.at(seg).at(link.rec.func_id);
       const auto& instruction = function.instructions.at(link.rec.instr_id);
-      int offset_of_instruction = function.instruction_to_byte_in_data.at(link.rec.instr_id);
+      int offset_of_instruction = function.instruction_location(link.rec.instr_id);
       int offset_in_instruction =
           link.is_mem_access ? instruction.offset_of_disp() : instruction.offset_of_imm();
       if (link.is_mem_access) {
@@ -406,7 +525,7 @@ void ObjectGenerator::handle_temp_rip_func_links(int seg) {
     result.instr = link.instr;
     result.target_segment = link.target.seg;
     const auto& target_func = m_function_data_by_seg.at(link.target.seg).at(link.target.func_id);
-    result.offset_in_segment = target_func.instruction_to_byte_in_data.at(0);
+    result.offset_in_segment = target_func.instruction_location(0);
     m_rip_links_by_seg.at(seg).push_back(result);
   }
 }
@@ -505,7 +624,7 @@ void ObjectGenerator::emit_link_rip(int seg) {
     out.push_back(rec.target_segment);
     // offset into current
     const auto& src_func = m_function_data_by_seg.at(rec.instr.seg).at(rec.instr.func_id);
-    push_data<u32>(src_func.instruction_to_byte_in_data.at(rec.instr.instr_id + 1), out);
+    push_data<u32>(src_func.instruction_location(rec.instr.instr_id + 1), out);
     // offset into target
     assert(rec.offset_in_segment >= 0);
     push_data<u32>(rec.offset_in_segment, out);
@@ -513,7 +632,7 @@ void ObjectGenerator::emit_link_rip(int seg) {
     const auto& src_instr = src_func.instructions.at(rec.instr.instr_id);
     assert(src_instr.get_disp_size() == 4);
     push_data<u32>(
-        src_func.instruction_to_byte_in_data.at(rec.instr.instr_id) + src_instr.offset_of_disp(),
+        src_func.instruction_location(rec.instr.instr_id) + src_instr.offset_of_disp(),
         out);
   }
 }
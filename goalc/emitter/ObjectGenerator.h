@@ -56,6 +56,23 @@ struct StaticRecord {
   int static_id = -1;
 };
 
+/*!
+ * Statistics about the code in generated object files.
+ */
+struct CodeStats {
+  int code_bytes = 0;   // size of all instructions, after branch relaxation
+  int total_jumps = 0;  // jumps within functions
+  int short_jumps = 0;  // jumps that use an 8-bit offset
+  int bytes_saved_by_short_jumps = 0;
+
+  void add(const CodeStats& other) {
+    code_bytes += other.code_bytes;
+    total_jumps += other.total_jumps;
+    short_jumps += other.short_jumps;
+    bytes_saved_by_short_jumps += other.bytes_saved_by_short_jumps;
+  }
+};
+
 class ObjectGenerator {
  public:
   ObjectGenerator() = default;
@@ -87,8 +104,10 @@ class ObjectGenerator {
                                int offset);
   void link_instruction_to_function(const InstructionRecord& instr,
                                     const FunctionRecord& target_func);
+  const CodeStats& code_stats() const { return m_code_stats; }
 
  private:
+  void relax_jumps(int seg);
   void handle_temp_static_type_links(int seg);
   void handle_temp_jump_links(int seg);
   void handle_temp_instr_sym_links(int seg);
@@ -113,6 +132,11 @@ class ObjectGenerator {
     return insert_location;
   }
 
+  void align_data(int seg, int align) {
+    auto& data = m_data_by_seg.at(seg);
+    data.resize(((data.size() + align - 1) / align) * align, 0);
+  }
+
   template <typename T>
   void patch_data(int seg, int offset, const T& x) {
     auto& data = m_data_by_seg.at(seg);
@@ -124,9 +148,19 @@ class ObjectGenerator {
   struct FunctionData {
     std::vector<Instruction> instructions;
     std::vector<int> ir_to_instruction;
-    std::vector<int> instruction_to_byte_in_data;
+    // the encoded instructions, and the offset of each instruction in code, plus the end.
+    std::vector<u8> code;
+    std::vector<int> instruction_offsets = {0};
+    int offset_in_seg = -1;  // where code starts in the segment, set during layout
     int min_align = 16;
     FunctionDebugInfo* debug = nullptr;
+
+    void add_instr(const Instruction& inst);
+    void reencode(const std::vector<bool>& changed);
+    int instruction_location(int instr_id) const {
+      assert(offset_in_seg >= 0);
+      return offset_in_seg + instruction_offsets.at(instr_id);
+    }
   };
 
   struct StaticData {
@@ -216,6 +250,7 @@ class ObjectGenerator {
   seg_vector<PointerLink> m_pointer_links_by_seg;
 
   std::vector<FunctionRecord> m_all_function_records;
+  CodeStats m_code_stats;
 };
 }  // namespace emitter
 
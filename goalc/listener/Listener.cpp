@@ -64,6 +64,7 @@ void Listener::disconnect() {
     m_debugger->invalidate();
   }
   m_connected = false;
+  m_ack_cv.notify_all();
   if (receive_thread_running) {
     rcv_thread.join();
     receive_thread_running = false;
@@ -145,12 +146,13 @@ bool Listener::connect_to_target(int n_tries, const std::string& ip, int port) {
   }
 
   // get the GOAL version number, to make sure we connected to the right thing
-  int32_t version_buffer[2] = {-1, -1};
+  int32_t version_buffer[3] = {-1, -1, -1};
   int read_tries = 0;
   int prog = 0;
   bool ok = true;
-  while (prog < 8) {
-    auto r = read_from_socket(listen_socket, (char*)version_buffer + prog, 8 - prog);
+  while (prog < (int)sizeof(version_buffer)) {
+    auto r = read_from_socket(listen_socket, (char*)version_buffer + prog,
+                              sizeof(version_buffer) - prog);
     std::this_thread::sleep_for(std::chrono::microseconds(100000));
     prog += r > 0 ? r : 0;
     read_tries++;
@@ -166,22 +168,27 @@ bool Listener::connect_to_target(int n_tries, const std::string& ip, int port) {
     return false;
   }
 
-  printf("Got version %d.%d", version_buffer[0], version_buffer[1]);
-  if (version_buffer[0] == GOAL_VERSION_MAJOR && version_buffer[1] == GOAL_VERSION_MINOR) {
+  printf("Got version %d.%d (protocol %d)", version_buffer[0], version_buffer[1],
+         version_buffer[2]);
+  if (version_buffer[0] == GOAL_VERSION_MAJOR && version_buffer[1] == GOAL_VERSION_MINOR &&
+      version_buffer[2] == (int32_t)LISTENER_PROTOCOL_VERSION) {
     printf(" OK!\n");
+    {
+      std::lock_guard<std::mutex> lk(m_ack_mtx);
+      m_unacked_ids.clear();
+      last_sent_id = 0;
+    }
     m_connected = true;
     rcv_thread = std::thread(&Listener::receive_func, this);
     receive_thread_running = true;
     return true;
   } else {
-    printf(", expected %d.%d. Cannot connect.\n", GOAL_VERSION_MAJOR, GOAL_VERSION_MINOR);
+    printf(", expected %d.%d (protocol %d). Cannot connect.\n", GOAL_VERSION_MAJOR,
+           GOAL_VERSION_MINOR, LISTENER_PROTOCOL_VERSION);
     close_socket(listen_socket);
     listen_socket = -1;
     return false;
   }
-
-  last_recvd_id = 0;
-  last_sent_id = 0;
 }
 
 /*!
@@ -189,6 +196,15 @@ bool Listener::connect_to_target(int n_tries, const std::string& ip, int port) {
  * Will print messages to stdout, or optionally save them.
  */
 void Listener::receive_func() {
+  receive_messages();
+  // anybody waiting for an ack should give up.
+  m_ack_cv.notify_all();
+}
+
+/*!
+ * Receive messages until we disconnect.
+ */
+void Listener::receive_messages() {
   while (m_connected) {
     // attempt to receive a ListenerMessageHeader
     int rcvd = 0;
@@ -217,24 +233,10 @@ void Listener::receive_func() {
     switch (hdr->msg_kind) {
       case ListenerMessageKind::MSG_ACK:
         // an "ack" message, sent by the target to indicate it got something.
-        if (!waiting_for_ack) {
-          if (hdr->msg_id == last_sent_id) {
-            printf("[Listener] Received ACK for most recent message late.\n");
-            if (last_recvd_id != hdr->msg_id - 1) {
-              fmt::print(
-                  "[Listener] WARNING: message ID jumped from {} to {}. Some messages may have "
-                  "been lost. You must wait for an ACK before sending the next message.\n",
-                  last_recvd_id, hdr->msg_id);
-            }
-          } else {
-            printf("[Listener] Got an unexpcted ACK message.");
-          }
-        }
-
         if (hdr->deci2_header.len < 512) {
           // ack's should be < 512 bytes (they are just "ack").
           int ack_recv_prog = 0;
-          while (rcvd < hdr->deci2_header.len) {
+          while (rcvd < (int)hdr->deci2_header.len) {
             if (!m_connected)
               return;
             int got = read_from_socket(listen_socket, ack_recv_buff + ack_recv_prog,
@@ -245,14 +247,22 @@ void Listener::receive_func() {
           }
           ack_recv_buff[ack_recv_prog] = '\0';
           assert(ack_recv_prog < 512);
-          got_ack = true;
-          last_recvd_id = hdr->msg_id;
-          if (last_recvd_id > last_sent_id) {
-            fmt::print(
-                "[Listener] ERROR: Got an ack message with id of {}, but the last message sent "
-                "had an ID of {}.\n",
-                last_recvd_id, last_sent_id);
+
+          {
+            std::lock_guard<std::mutex> lk(m_ack_mtx);
+            if (!m_unacked_ids.erase(hdr->msg_id)) {
+              if (hdr->msg_id <= last_sent_id) {
+                fmt::print("[Listener] Received ACK for message {} late.\n", hdr->msg_id);
+              } else {
+                fmt::print(
+                    "[Listener] ERROR: Got an ack message with id of {}, but the last message sent "
+                    "had an ID of {}.\n",
+                    hdr->msg_id, last_sent_id);
+              }
+            }
+            m_ack_count++;
           }
+          m_ack_cv.notify_all();
         } else {
           printf("[Listener] got invalid ack!\n");
         }
@@ -263,7 +273,7 @@ void Listener::receive_func() {
         auto* str_buff = new char[hdr->msg_size + 1];  // plus one for the null terminator
         int msg_prog = 0;
         assert(hdr->msg_id == 0);
-        while (rcvd < hdr->deci2_header.len) {
+        while (rcvd < (int)hdr->deci2_header.len) {
           if (!m_connected) {
             return;
           }
@@ -339,27 +349,26 @@ int Listener::get_received_message_count() {
  * Returns once the target acks the code.
  */
 void Listener::send_code(std::vector<uint8_t>& code) {
-  got_ack = false;
+  auto id = queue_code(code);
+  m_last_send_acked = id && wait_for_ack(id);
+}
+
+/*!
+ * Send a "CODE" message for the target to execute as the Listener Function, without waiting for
+ * the target to ack it. The target runs messages in the order they are sent, so several can be in
+ * flight. Returns the message ID, or 0 if the message couldn't be sent.
+ */
+u64 Listener::queue_code(std::vector<uint8_t>& code) {
   int total_size = code.size() + sizeof(ListenerMessageHeader);
-  if (total_size > BUFFER_SIZE) {
-    printf("[ERROR] Listener send_code got too big of a message\n");
-    return;
+  if (total_size > BUFFER_SIZE || total_size > (int)DEBUG_MESSAGE_BUFFER_SIZE) {
+    printf("[ERROR] Listener send_code got too big of a message (%d bytes, limit is %d)\n",
+           total_size, std::min(BUFFER_SIZE, (int)DEBUG_MESSAGE_BUFFER_SIZE));
+    return 0;
   }
 
-  auto* header = (ListenerMessageHeader*)m_buffer;
-  auto* buffer_data = (char*)(header + 1);
-  header->deci2_header.rsvd = 0;
-  header->deci2_header.len = total_size;
-  header->deci2_header.proto = DECI2_PROTOCOL;
-  header->deci2_header.src = 'H';
-  header->deci2_header.dst = 'E';
-  header->msg_size = code.size();
-  header->ltt_msg_kind = LTT_MSG_CODE;
-  header->u6 = 0;
-  last_sent_id++;
-  header->msg_id = last_sent_id;
-  memcpy(buffer_data, code.data(), code.size());
-  send_buffer(total_size);
+  fill_header(LTT_MSG_CODE, code.size());
+  memcpy(m_buffer + sizeof(ListenerMessageHeader), code.data(), code.size());
+  return send_buffer(total_size);
 }
 
 /*!
@@ -377,18 +386,8 @@ void Listener::send_reset(bool shutdown) {
     m_debugger->detach();
   }
 
-  auto* header = (ListenerMessageHeader*)m_buffer;
-  header->deci2_header.rsvd = 0;
-  header->deci2_header.len = sizeof(ListenerMessageHeader);
-  header->deci2_header.proto = DECI2_PROTOCOL;
-  header->deci2_header.src = 'H';
-  header->deci2_header.dst = 'E';
-  header->msg_size = 0;
-  header->ltt_msg_kind = shutdown ? LTT_MSG_SHUTDOWN : LTT_MSG_RESET;
-  header->u6 = 0;
-  last_sent_id++;
-  header->msg_id = last_sent_id;
-  send_buffer(sizeof(ListenerMessageHeader));
+  fill_header(shutdown ? LTT_MSG_SHUTDOWN : LTT_MSG_RESET, 0);
+  wait_for_ack(send_buffer(sizeof(ListenerMessageHeader)));
   disconnect();
   close_socket(listen_socket);
   printf("[Listener] Closed connection to target\n");
@@ -403,72 +402,98 @@ void Listener::send_poke() {
     printf("Not connected, so cannot poke target.\n");
     return;
   }
+  fill_header(LTT_MSG_POKE, 0);
+  wait_for_ack(send_buffer(sizeof(ListenerMessageHeader)));
+}
+
+/*!
+ * Set up the header at the start of m_buffer for a new message.
+ */
+void Listener::fill_header(ListenerToTargetMsgKind kind, u32 msg_size) {
   auto* header = (ListenerMessageHeader*)m_buffer;
-  header->deci2_header.rsvd = 0;
-  header->deci2_header.len = sizeof(ListenerMessageHeader);
+  header->deci2_header.len = msg_size + sizeof(ListenerMessageHeader);
   header->deci2_header.proto = DECI2_PROTOCOL;
   header->deci2_header.src = 'H';
   header->deci2_header.dst = 'E';
-  header->msg_size = 0;
-  header->ltt_msg_kind = LTT_MSG_POKE;
+  header->msg_size = msg_size;
+  header->ltt_msg_kind = kind;
   header->u6 = 0;
+  std::lock_guard<std::mutex> lk(m_ack_mtx);
   last_sent_id++;
   header->msg_id = last_sent_id;
-  send_buffer(sizeof(ListenerMessageHeader));
 }
 
 /*!
  * Low level send of the m_buffer.
- * Waits for the target to respond or times out and prints an error.
+ * Doesn't wait for the target to respond. Returns the ID of the message, which the ack will have.
  */
-void Listener::send_buffer(int sz) {
+u64 Listener::send_buffer(int sz) {
   int wrote = 0;
+  auto id = ((ListenerMessageHeader*)m_buffer)->msg_id;
 
   if (debug_listener) {
     fprintf(stderr, "[L -> T] sending %d bytes...\n", sz);
   }
 
-  got_ack = false;
-  waiting_for_ack = true;
+  {
+    // before the send, so we can't miss the ack.
+    std::lock_guard<std::mutex> lk(m_ack_mtx);
+    m_unacked_ids.insert(id);
+  }
+
   while (wrote < sz) {
-    auto to_send = std::min(512, sz - wrote);
+    auto to_send = std::min(SEND_CHUNK_SIZE, sz - wrote);
     auto x = write_to_socket(listen_socket, m_buffer + wrote, to_send);
     wrote += x > 0 ? x : 0;
   }
 
-  if (debug_listener) {
-    printf("  waiting for ack...\n");
-  }
-
-  if (wait_for_ack()) {
-    if (debug_listener) {
-      printf("ack buff:\n");
-      printf("%s\n", ack_recv_buff);
-      printf("  OK\n");
-    }
-  } else {
-    printf("  Timed out waiting for ack.\n");
-  }
+  return id;
 }
 
 /*!
- * Wait for the target to send an ack.
+ * Wait for the target to ack the message with the given ID, and all messages sent before it.
+ * Only times out if the target goes too long without acking anything, so a long queue of
+ * messages is fine.
  */
-bool Listener::wait_for_ack() {
-  // todo, check the message ID.
+bool Listener::wait_for_ack(u64 id) {
   if (!m_connected) {
     printf("wait_for_ack called when not connected!\n");
     return false;
   }
 
-  for (int i = 0; i < 2000; i++) {
-    if (got_ack)
-      return true;
-    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+  std::unique_lock<std::mutex> lk(m_ack_mtx);
+  while (!m_unacked_ids.empty() && *m_unacked_ids.begin() <= id) {
+    auto ack_count = m_ack_count;
+    m_ack_cv.wait_for(lk, ACK_TIMEOUT, [&]() { return m_ack_count != ack_count || !m_connected; });
+    if (m_ack_count == ack_count) {
+      // no progress. Forget about these messages, a late ack will print a warning.
+      m_unacked_ids.erase(m_unacked_ids.begin(), m_unacked_ids.upper_bound(id));
+      printf("  Timed out waiting for ack.\n");
+      return false;
+    }
   }
 
-  waiting_for_ack = false;
-  return false;
+  if (debug_listener) {
+    printf("ack buff:\n");
+    printf("%s\n", ack_recv_buff);
+    printf("  OK\n");
+  }
+  return true;
+}
+
+/*!
+ * Wait for the target to ack every message sent so far.
+ */
+bool Listener::wait_for_all_acks() {
+  u64 id;
+  {
+    std::lock_guard<std::mutex> lk(m_ack_mtx);
+    if (m_unacked_ids.empty()) {
+      return true;
+    }
+    id = last_sent_id;
+  }
+  return wait_for_ack(id);
 }
 
 /*!
@@ -540,8 +565,34 @@ void Listener::handle_output_message(const char* msg) {
 
       add_load(name_str.substr(2, name_str.length() - 3), entry);
       // fmt::print("LOAD:\n{}", entry.print());
+    } else if (kind == "profile") {
+      // profile <count> #x<frame> #x<frame> ...
+      ProfileStack stack;
+      const char* ptr = str.c_str() + x;
+      char* end = nullptr;
+      stack.count = strtoul(ptr, &end, 10);
+      ptr = end;
+      while (*ptr == ' ') {
+        ptr += 3;  // skip " #x"
+        stack.frames.push_back(strtoul(ptr, &end, 16));
+        ptr = end;
+      }
+      m_profile_stacks.push_back(std::move(stack));
+    } else if (kind == "profile-end") {
+      // profile-end <total-samples> <dropped-samples>
+      u32 total_samples = 0, dropped_samples = 0;
+      sscanf(str.c_str(), "profile-end %u %u", &total_samples, &dropped_samples);
+      // the debug info belongs to the compiler thread, so it reports the profile, not us.
+      std::lock_guard<std::mutex> lock(m_profile_mtx);
+      m_profile_received = true;
+      m_received_profile_stacks = std::move(m_profile_stacks);
+      m_received_profile_total = total_samples;
+      m_received_profile_dropped = dropped_samples;
+      m_profile_stacks.clear();
+    } else if (kind == "unload") {
+      auto name_str = str.substr(x);
+      do_unload(name_str.substr(2, name_str.length() - 3));
     } else {
-      // todo unload
       printf("[Listener Warning] unknown output message \"%s\"\n", msg);
     }
   }
@@ -551,10 +602,23 @@ void Listener::handle_output_message(const char* msg) {
  * Add a load to the load listing.
  */
 void Listener::add_load(const std::string& name, const LoadEntry& le) {
+  std::lock_guard<std::mutex> lock(m_load_mtx);
   if (m_load_entries.find(name) != m_load_entries.end() && name != "*listener*") {
     printf("[Listener Warning] The runtime has loaded %s twice!\n", name.c_str());
   }
   m_load_entries[name] = le;
+  m_memory_map_valid = false;
+}
+
+/*!
+ * Remove a load from the load listing.
+ */
+void Listener::do_unload(const std::string& name) {
+  std::lock_guard<std::mutex> lock(m_load_mtx);
+  if (!m_load_entries.erase(name)) {
+    printf("[Listener Warning] The runtime has unloaded %s, which wasn't loaded!\n", name.c_str());
+  }
+  m_memory_map_valid = false;
 }
 
 /*!
@@ -564,8 +628,34 @@ void Listener::add_debugger(Debugger* debugger) {
   m_debugger = debugger;
 }
 
+/*!
+ * Get the memory map of loaded objects. This is only rebuilt after a load or unload.
+ */
 MemoryMap Listener::build_memory_map() {
-  return MemoryMap(m_load_entries);
+  std::lock_guard<std::mutex> lock(m_load_mtx);
+  if (!m_memory_map_valid) {
+    m_memory_map = MemoryMap(m_load_entries);
+    m_memory_map_valid = true;
+  }
+  return m_memory_map;
+}
+
+/*!
+ * Get the results of the profiler, if they were received since the last call.
+ */
+bool Listener::take_received_profile(std::vector<ProfileStack>* stacks,
+                                     u32* total_samples,
+                                     u32* dropped_samples) {
+  std::lock_guard<std::mutex> lock(m_profile_mtx);
+  if (!m_profile_received) {
+    return false;
+  }
+  m_profile_received = false;
+  *stacks = std::move(m_received_profile_stacks);
+  m_received_profile_stacks.clear();
+  *total_samples = m_received_profile_total;
+  *dropped_samples = m_received_profile_dropped;
+  return true;
 }
 
 }  // namespace listener
@@ -11,7 +11,10 @@
 #include <string>
 #include <vector>
 #include <thread>
+#include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <set>
 #include <unordered_map>
 #include "common/common_types.h"
 #include "common/listener_common.h"
@@ -24,6 +27,8 @@ namespace listener {
 class Listener {
  public:
   static constexpr int BUFFER_SIZE = 32 * 1024 * 1024;
+  static constexpr int SEND_CHUNK_SIZE = 64 * 1024;
+  static constexpr std::chrono::milliseconds ACK_TIMEOUT{2000};
   Listener();
   ~Listener();
   bool connect_to_target(int n_tries = 1,
@@ -37,36 +42,56 @@ class Listener {
   void send_poke();
   void disconnect();
   void send_code(std::vector<uint8_t>& code);
+  u64 queue_code(std::vector<uint8_t>& code);
+  bool wait_for_all_acks();
   void add_debugger(Debugger* debugger);
-  bool most_recent_send_was_acked() const { return got_ack; }
+  bool most_recent_send_was_acked() const { return m_last_send_acked; }
   MemoryMap build_memory_map();
+  bool take_received_profile(std::vector<ProfileStack>* stacks,
+                             u32* total_samples,
+                             u32* dropped_samples);
 
  private:
   void add_load(const std::string& name, const LoadEntry& le);
   void do_unload(const std::string& name);
 
-  void send_buffer(int sz);
-  bool wait_for_ack();
+  void fill_header(ListenerToTargetMsgKind kind, u32 msg_size);
+  u64 send_buffer(int sz);
+  bool wait_for_ack(u64 id);
   void handle_output_message(const char* msg);
 
-  char* m_buffer = nullptr;             //! buffer for incoming messages
+  char* m_buffer = nullptr;             //! buffer for outgoing messages
   bool m_connected = false;             //! do we think we are connected?
   bool receive_thread_running = false;  //! is the receive thread unjoined?
   int listen_socket = -1;               //! socket
-  bool got_ack = false;
-  bool waiting_for_ack = false;
+  bool m_last_send_acked = false;
+
+  std::mutex m_ack_mtx;
+  std::condition_variable m_ack_cv;
+  std::set<u64> m_unacked_ids;  //! messages sent, but not acked yet
+  u64 m_ack_count = 0;          //! total acks received, to tell if the target is making progress
 
   Debugger* m_debugger = nullptr;
 
   std::thread rcv_thread;
   std::mutex rcv_mtx;
   void receive_func();
+  void receive_messages();
   ListenerMessageKind filter = ListenerMessageKind::MSG_INVALID;
   std::vector<std::string> message_record;
   std::unordered_map<std::string, LoadEntry> m_load_entries;
+  std::mutex m_load_mtx;            //! protects m_load_entries and m_memory_map
+  MemoryMap m_memory_map;           //! built from m_load_entries
+  bool m_memory_map_valid = false;  //! false if m_load_entries has changed since it was built
+  std::vector<ProfileStack> m_profile_stacks;  //! profiler results received so far
+
+  std::mutex m_profile_mtx;  //! protects the finished profile below
+  bool m_profile_received = false;
+  std::vector<ProfileStack> m_received_profile_stacks;
+  u32 m_received_profile_total = 0;
+  u32 m_received_profile_dropped = 0;
   char ack_recv_buff[512];
   uint64_t last_sent_id = 0;
-  uint64_t last_recvd_id = 0;
 };
 }  // namespace listener
 
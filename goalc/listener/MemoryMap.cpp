@@ -88,6 +88,13 @@ MemoryMap::MemoryMap(const std::unordered_map<std::string, LoadEntry>& load_entr
   m_entries.push_back(last_gap);
 }
 
+MemoryMap::MemoryMap(std::vector<MemoryMapEntry> entries) : m_entries(std::move(entries)) {
+  std::sort(m_entries.begin(), m_entries.end(),
+            [](const MemoryMapEntry& a, const MemoryMapEntry& b) {
+              return a.start_addr < b.start_addr;
+            });
+}
+
 std::string MemoryMap::print() const {
   std::string result;
   result += std::string(40, '-');
@@ -109,9 +116,14 @@ std::string MemoryMap::print() const {
 }
 
 const MemoryMapEntry& MemoryMap::lookup(u32 addr) {
-  for (auto& entry : m_entries) {
-    if (addr >= entry.start_addr && addr < entry.end_addr) {
-      return entry;
+  // find the first entry starting after addr, then check the one before it.
+  auto it = std::upper_bound(
+      m_entries.begin(), m_entries.end(), addr,
+      [](u32 a, const MemoryMapEntry& entry) { return a < entry.start_addr; });
+  if (it != m_entries.begin()) {
+    it--;
+    if (addr >= it->start_addr && addr < it->end_addr) {
+      return *it;
     }
   }
   assert(false);
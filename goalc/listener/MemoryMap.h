@@ -27,12 +27,12 @@ class MemoryMap {
  public:
   MemoryMap() = default;
   explicit MemoryMap(const std::unordered_map<std::string, LoadEntry>& load_entries);
-  explicit MemoryMap(std::vector<MemoryMapEntry> entries) : m_entries(std::move(entries)) {}
+  explicit MemoryMap(std::vector<MemoryMapEntry> entries);
   std::string print() const;
   const MemoryMapEntry& lookup(u32 addr);
   bool lookup(const std::string& obj_name, u8 seg_id, MemoryMapEntry* out);
 
  private:
-  std::vector<MemoryMapEntry> m_entries;
+  std::vector<MemoryMapEntry> m_entries;  // sorted by start_addr
 };
 }  // namespace listener
@@ -1,6 +1,80 @@
 #include "gtest/gtest.h"
 #include "goalc/compiler/Compiler.h"
 #include "test/goalc/framework/test_runner.h"
+#include "common/link_types.h"
+#include "third-party/fmt/core.h"
+
+TEST(Debugger, SymbolizeAddresses) {
+  constexpr int object_count = 3;
+  constexpr int functions_per_object = 4;
+  constexpr u32 function_size = 0x40;
+  constexpr u32 segment_size = functions_per_object * function_size;
+
+  // lay out objects back to back, each with a main and debug segment full of functions.
+  std::unordered_map<std::string, listener::LoadEntry> loads;
+  std::unordered_map<std::string, DebugInfo> debug_info;
+  u32 addr = 0x100000;
+  for (int obj = 0; obj < object_count; obj++) {
+    auto obj_name = fmt::format("object-{}", obj);
+    auto& le = loads[obj_name];
+    auto& di = debug_info.insert({obj_name, DebugInfo(obj_name)}).first->second;
+    for (int seg : {MAIN_SEGMENT, DEBUG_SEGMENT}) {
+      le.segments[seg] = addr;
+      le.segment_sizes[seg] = segment_size;
+      addr += segment_size;
+      for (int f = 0; f < functions_per_object; f++) {
+        auto& func = di.add_function(fmt::format("{}-seg{}-function-{}", obj_name, seg, f));
+        func.seg = seg;
+        func.offset_in_seg = f * function_size;
+        func.length = function_size;
+      }
+    }
+  }
+  listener::MemoryMap map(loads);
+
+  // the first and last byte of every function
+  FunctionDebugInfo* info = nullptr;
+  std::string name;
+  for (u32 lookup_addr = 0x100000; lookup_addr < addr; lookup_addr += function_size) {
+    for (u32 lookup_offset : {0u, function_size - 1}) {
+      auto& entry = map.lookup(lookup_addr + lookup_offset);
+      ASSERT_FALSE(entry.empty);
+      u32 obj_offset = lookup_addr + lookup_offset - entry.start_addr;
+      ASSERT_TRUE(debug_info.at(entry.obj_name)
+                      .lookup_function(&info, &name, obj_offset, entry.seg_id));
+      EXPECT_EQ(name, fmt::format("{}-seg{}-function-{}", entry.obj_name, entry.seg_id,
+                                  obj_offset / function_size));
+    }
+  }
+  EXPECT_TRUE(map.lookup(addr).empty);
+
+  // check one by hand
+  auto& entry = map.lookup(0x100000 + 3 * segment_size + 2 * function_size + 3);
+  EXPECT_EQ(entry.obj_name, "object-1");
+  EXPECT_EQ(entry.seg_id, DEBUG_SEGMENT);
+  EXPECT_TRUE(debug_info.at("object-1").lookup_function(&info, &name, 2 * function_size + 3,
+                                                        DEBUG_SEGMENT));
+  EXPECT_EQ(name, "object-1-seg1-function-2");
+  EXPECT_EQ(info->offset_in_seg, 2 * function_size);
+  EXPECT_FALSE(debug_info.at("object-1").lookup_function(&info, &name, segment_size, MAIN_SEGMENT));
+}
+
+TEST(Debugger, SymbolizeAfterLayout) {
+  // functions are added before their offsets are known, so a lookup before layout finds nothing.
+  DebugInfo di("object");
+  auto& func = di.add_function("function");
+  FunctionDebugInfo* info = nullptr;
+  std::string name;
+  EXPECT_FALSE(di.lookup_function(&info, &name, 0x10, MAIN_SEGMENT));
+
+  func.seg = MAIN_SEGMENT;
+  func.offset_in_seg = 0x10;
+  func.length = 0x20;
+  di.invalidate_index();
+  EXPECT_TRUE(di.lookup_function(&info, &name, 0x10, MAIN_SEGMENT));
+  EXPECT_EQ(name, "function");
+  EXPECT_FALSE(di.lookup_function(&info, &name, 0x30, MAIN_SEGMENT));
+}
 
 #ifdef __linux
 TEST(Debugger, DebuggerBasicConnect) {
@@ -106,6 +180,65 @@ TEST(Debugger, DebuggerWriteMemory) {
   }
 }
 
+TEST(Debugger, DebuggerReadMemoryBatch) {
+  Compiler compiler;
+  // evidently you can't ptrace threads in your own process, so we need to run the runtime in a
+  // separate process.
+  if (!fork()) {
+    GoalTest::runtime_no_kernel();
+    exit(0);
+  } else {
+    compiler.connect_to_target();
+    compiler.poke_target();
+    compiler.run_test_from_string("(dbg)");
+    EXPECT_TRUE(compiler.get_debugger().do_continue());
+    auto result1 = compiler.run_test_from_string("\"first-string\"");
+    auto result2 = compiler.run_test_from_string("\"second-string\"");
+    EXPECT_TRUE(compiler.get_debugger().do_break());
+    auto addr1 = std::stoi(result1.at(0));
+    auto addr2 = std::stoi(result2.at(0));
+    u8 str_buff1[64], str_buff2[64];
+    EXPECT_TRUE(compiler.get_debugger().read_memory_batch(
+        {{str_buff1, u32(addr1 + 4), 64}, {str_buff2, u32(addr2 + 4), 64}}));
+    EXPECT_EQ(0, strcmp((char*)str_buff1, "first-string"));
+    EXPECT_EQ(0, strcmp((char*)str_buff2, "second-string"));
+
+    // reads after a write should see the new data
+    EXPECT_TRUE(compiler.get_debugger().write_value<u8>('F', addr1 + 4));
+    EXPECT_TRUE(compiler.get_debugger().read_memory(str_buff1, 64, addr1 + 4));
+    EXPECT_EQ(0, strcmp((char*)str_buff1, "First-string"));
+
+    compiler.shutdown_target();
+
+    // and now the child process should be done!
+    EXPECT_TRUE(wait(nullptr) >= 0);
+  }
+}
+
+TEST(Debugger, Profiler) {
+  Compiler compiler;
+  // the profiler runs in the runtime, but the results are sent back to the debugger
+  if (!fork()) {
+    GoalTest::runtime_no_kernel();
+    exit(0);
+  } else {
+    compiler.connect_to_target();
+    compiler.poke_target();
+    compiler.run_test_from_string(
+        "(defun profiler-test-loop ((n int)) (let ((x 0)) (dotimes (i n) (set! x (+ x i))) x))"
+        "(profile-start 1000)"
+        "(profiler-test-loop 100000000)"
+        "(profile-stop)");
+    auto& report = compiler.get_debugger().get_last_profile_report();
+    EXPECT_TRUE(report.find("profiler-test-loop") != std::string::npos);
+
+    compiler.shutdown_target();
+
+    // and now the child process should be done!
+    EXPECT_TRUE(wait(nullptr) >= 0);
+  }
+}
+
 TEST(Debugger, Symbol) {
   Compiler compiler;
   // evidently you can't ptrace threads in your own process, so we need to run the runtime in a
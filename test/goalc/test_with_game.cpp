@@ -312,6 +312,17 @@ TEST_F(WithGameTests, VectorDot) {
                          get_test_pass_string("vector-dot", 1));
 }
 
+TEST_F(WithGameTests, LoopOptimizer) {
+  compiler.run_test_from_string("(set-config! optimize-loops #t)");
+  auto before = compiler.get_loop_stats();
+  runner.run_static_test(env, testCategory, "test-loop-opt.gc",
+                         get_test_pass_string("loop-opt", 9));
+  auto after = compiler.get_loop_stats();
+  compiler.run_test_from_string("(set-config! optimize-loops #f)");
+  EXPECT_GT(after.hoisted, before.hoisted);
+  EXPECT_GT(after.strength_reduced, before.strength_reduced);
+}
+
 TEST_F(WithGameTests, DebuggerMemoryMap) {
   auto mem_map = compiler.listener().build_memory_map();
 
@@ -0,0 +1,120 @@
+/*!
+ * @file test_ObjectGenerator.cpp
+ * Tests for the ObjectGenerator's layout of functions, mostly jump shortening.
+ */
+
+#include "gtest/gtest.h"
+#include "goalc/emitter/ObjectGenerator.h"
+#include "goalc/emitter/IGen.h"
+#include "goalc/debugger/DebugInfo.h"
+#include "common/type_system/TypeSystem.h"
+#include "common/link_types.h"
+
+using namespace emitter;
+
+namespace {
+/*!
+ * Add a function made of n_jumps jumps to its last instruction, then n_nops nops, then a ret.
+ * Each instruction gets its own IR.
+ */
+FunctionRecord add_jump_function(ObjectGenerator& gen,
+                                 FunctionDebugInfo& debug,
+                                 int n_jumps,
+                                 int n_nops) {
+  auto func = gen.add_function_to_seg(MAIN_SEGMENT, &debug);
+  auto end = gen.get_future_ir_record(func, n_jumps + n_nops);
+  for (int i = 0; i < n_jumps; i++) {
+    auto jump = gen.add_instr(IGen::jmp_32(), gen.add_ir(func, "jump"));
+    gen.link_instruction_jump(jump, end);
+  }
+  for (int i = 0; i < n_nops; i++) {
+    gen.add_instr(IGen::nop(), gen.add_ir(func, "nop"));
+  }
+  gen.add_instr(IGen::ret(), gen.add_ir(func, "ret"));
+  return func;
+}
+
+ObjectFileData generate(ObjectGenerator& gen) {
+  TypeSystem ts;
+  ts.add_builtin_types();
+  return gen.generate_data_v3(&ts);
+}
+
+// functions are 16-byte aligned, and the code starts after the type tag.
+constexpr int CODE_START = 4;
+}  // namespace
+
+TEST(ObjectGenerator, ShortJumpAtMaxDisplacement) {
+  ObjectGenerator gen;
+  FunctionDebugInfo debug, next_debug;
+  add_jump_function(gen, debug, 1, 127);
+  auto next = gen.add_function_to_seg(MAIN_SEGMENT, &next_debug);
+  gen.add_instr(IGen::ret(), gen.add_ir(next, "ret"));
+  auto data = generate(gen).segment_data.at(MAIN_SEGMENT);
+
+  // jmp rel8 +127, skipping all the nops.
+  EXPECT_EQ(data.at(CODE_START), 0xeb);
+  EXPECT_EQ((s8)data.at(CODE_START + 1), 127);
+  EXPECT_EQ(debug.instructions.at(0).instruction.get_imm_size(), 1);
+
+  // everything after the jump moves back by 3 bytes.
+  EXPECT_EQ(debug.offset_in_seg, CODE_START);
+  EXPECT_EQ(debug.instructions.at(1).offset, 2);
+  EXPECT_EQ(debug.instructions.at(128).offset, 2 + 127);
+  EXPECT_EQ(debug.length, 2 + 127 + 1);
+  EXPECT_EQ(data.at(CODE_START + 2 + 127), 0xc3);
+
+  // and so does the next function, which is now at 144 instead of 160.
+  EXPECT_EQ(next_debug.offset_in_seg, 144 + CODE_START);
+  EXPECT_EQ(data.at(144 + CODE_START), 0xc3);
+
+  EXPECT_EQ(gen.code_stats().total_jumps, 1);
+  EXPECT_EQ(gen.code_stats().short_jumps, 1);
+  EXPECT_EQ(gen.code_stats().bytes_saved_by_short_jumps, 3);
+}
+
+TEST(ObjectGenerator, LongJumpPastMaxDisplacement) {
+  ObjectGenerator gen;
+  FunctionDebugInfo debug;
+  add_jump_function(gen, debug, 1, 128);
+  auto data = generate(gen).segment_data.at(MAIN_SEGMENT);
+
+  // a short jump would need +128, so it stays jmp rel32.
+  EXPECT_EQ(data.at(CODE_START), 0xe9);
+  s32 disp;
+  memcpy(&disp, data.data() + CODE_START + 1, sizeof(disp));
+  EXPECT_EQ(disp, 128);
+  EXPECT_EQ(debug.instructions.at(0).instruction.get_imm_size(), 4);
+
+  EXPECT_EQ(debug.instructions.at(1).offset, 5);
+  EXPECT_EQ(debug.instructions.at(129).offset, 5 + 128);
+  EXPECT_EQ(debug.length, 5 + 128 + 1);
+
+  EXPECT_EQ(gen.code_stats().total_jumps, 1);
+  EXPECT_EQ(gen.code_stats().short_jumps, 0);
+  EXPECT_EQ(gen.code_stats().bytes_saved_by_short_jumps, 0);
+}
+
+TEST(ObjectGenerator, ShortJumpBringsAnotherInRange) {
+  ObjectGenerator gen;
+  FunctionDebugInfo debug;
+  // the first jump has the second jump and 125 nops to skip. With the second jump long, that is
+  // 130 bytes, which is out of range. Once the second jump is short, it is 127.
+  add_jump_function(gen, debug, 2, 125);
+  auto data = generate(gen).segment_data.at(MAIN_SEGMENT);
+
+  EXPECT_EQ(data.at(CODE_START), 0xeb);
+  EXPECT_EQ((s8)data.at(CODE_START + 1), 127);
+  EXPECT_EQ(data.at(CODE_START + 2), 0xeb);
+  EXPECT_EQ((s8)data.at(CODE_START + 3), 125);
+
+  EXPECT_EQ(debug.instructions.at(1).offset, 2);
+  EXPECT_EQ(debug.instructions.at(2).offset, 4);
+  EXPECT_EQ(debug.instructions.at(127).offset, 4 + 125);
+  EXPECT_EQ(debug.length, 4 + 125 + 1);
+  EXPECT_EQ(data.at(CODE_START + 4 + 125), 0xc3);
+
+  EXPECT_EQ(gen.code_stats().total_jumps, 2);
+  EXPECT_EQ(gen.code_stats().short_jumps, 2);
+  EXPECT_EQ(gen.code_stats().bytes_saved_by_short_jumps, 6);
+}
@@ -1,9 +1,12 @@
 #include "common/util/FileUtil.h"
+#include "common/util/DgoReader.h"
 #include "common/util/Trie.h"
 #include "gtest/gtest.h"
 #include "test/all_jak1_symbols.h"
 #include "common/util/json_util.h"
 #include "common/util/Range.h"
+#include "third-party/lzokay/lzokay.hpp"
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -40,6 +43,67 @@ TEST(CommonUtil, Trie) {
   EXPECT_FALSE(test.lookup("path1") == nullptr);
   EXPECT_TRUE(test.lookup("path-") == nullptr);
   EXPECT_FALSE(test.lookup("path1-k") == nullptr);
+
+  // prefixes ending partway through a node
+  EXPECT_EQ(test.lookup_prefix("energydoor-closed-till-ne").size(), 1);
+  EXPECT_EQ(*test.lookup_prefix("energydoor-closed-till-ne").at(0), "energydoor-closed-till-near");
+  EXPECT_TRUE(test.lookup_prefix("energydoor-closed-till-nex").empty());
+}
+
+TEST(CommonUtil, TrieInsertAndReplace) {
+  Trie<int> test;
+  test.insert("abcd", 1);
+  test.insert("ab", 2);    // splits abcd
+  test.insert("abef", 3);  // adds to ab
+  test.insert("abcd", 4);  // replaces
+  *test["a"] = 5;
+  *test["ab"] += 10;
+  EXPECT_EQ(test.size(), 4);
+  EXPECT_EQ(*test.lookup("abcd"), 4);
+  EXPECT_EQ(*test.lookup("ab"), 12);
+  EXPECT_EQ(*test.lookup("abef"), 3);
+  EXPECT_EQ(*test.lookup("a"), 5);
+  EXPECT_EQ(test.lookup("abc"), nullptr);
+  EXPECT_EQ(test.lookup("abcde"), nullptr);
+
+  // results are sorted by key
+  std::vector<int> values;
+  for (auto x : test.lookup_prefix("a")) {
+    values.push_back(*x);
+  }
+  EXPECT_EQ(values, std::vector<int>({5, 12, 4, 3}));
+}
+
+TEST(CommonUtil, TrieAllSymbols) {
+  Trie<std::string> test;
+  for (auto x : all_syms) {
+    test.insert(x, x);
+  }
+  EXPECT_EQ(test.size(), 7941);
+
+  for (auto x : all_syms) {
+    auto result = test.lookup(x);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(*result, x);
+  }
+
+  // compare prefix lookups against a search over all symbols.
+  for (std::string prefix : {"", "*", "a", "ve", "vector-", "process-", "not-a-symbol"}) {
+    std::vector<std::string> expected;
+    for (auto x : all_syms) {
+      if (std::string(x).compare(0, prefix.length(), prefix) == 0) {
+        expected.push_back(x);
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+    std::vector<std::string> result;
+    for (auto x : test.lookup_prefix(prefix)) {
+      result.push_back(*x);
+    }
+    EXPECT_EQ(result, expected) << prefix;
+  }
 }
 
 TEST(CommonUtil, StripComments) {
@@ -77,4 +141,137 @@ TEST(CommonUtil, RangeIterator) {
   EXPECT_FALSE(Range<int>(3, 4).empty());
   EXPECT_EQ(1, Range<int>(3, 4).size());
   EXPECT_EQ(4, Range<int>(4, 8).size());
+}
+
+namespace {
+/*!
+ * Build a compressed DGO in the chunked oZlB format, storing every 4th full size chunk
+ * uncompressed.
+ */
+std::vector<u8> make_compressed_dgo(const std::vector<u8>& data, size_t chunk_size = 0x8000) {
+  std::vector<u8> result = {'o', 'Z', 'l', 'B'};
+  u32 size = data.size();
+  result.insert(result.end(), (u8*)&size, (u8*)&size + 4);
+  for (size_t offset = 0, i = 0; offset < data.size(); offset += chunk_size, i++) {
+    size_t in_size = std::min(chunk_size, data.size() - offset);
+    std::vector<u8> compressed(lzokay::compress_worst_size(in_size));
+    size_t out_size = 0;
+    lzokay::compress(data.data() + offset, in_size, compressed.data(), compressed.size(),
+                     out_size);
+    u32 header = out_size;
+    if (i % 4 == 3 && in_size == 0x8000) {
+      header = chunk_size;
+      compressed.assign(data.data() + offset, data.data() + offset + in_size);
+      out_size = in_size;
+    }
+    result.insert(result.end(), (u8*)&header, (u8*)&header + 4);
+    result.insert(result.end(), compressed.begin(), compressed.begin() + out_size);
+    while (result.size() % 4) {
+      result.push_back(0);
+    }
+  }
+  return result;
+}
+}  // namespace
+
+TEST(CommonUtil, DecompressDgo) {
+  std::vector<u8> data;
+  for (int i = 0; i < 0x8000 * 9 + 123; i++) {
+    data.push_back((i * 7) ^ (i >> 9));
+  }
+  auto compressed = make_compressed_dgo(data);
+  EXPECT_TRUE(file_util::dgo_header_is_compressed(compressed));
+
+  auto chunks = file_util::scan_dgo_chunks(compressed);
+  EXPECT_EQ(chunks.size(), 10);
+  EXPECT_FALSE(chunks.at(3).compressed);
+  EXPECT_EQ(chunks.back().out_size, 123);
+  EXPECT_EQ(file_util::decompress_dgo(compressed), data);
+
+  // a truncated file should fail instead of reading past the end.
+  std::vector<u8> truncated(compressed.begin(), compressed.begin() + compressed.size() / 2);
+  EXPECT_THROW(file_util::decompress_dgo(truncated), std::runtime_error);
+
+  // chunks smaller than the usual size are allowed too.
+  EXPECT_EQ(file_util::decompress_dgo(make_compressed_dgo(data, 0x5000)), data);
+  auto short_truncated = make_compressed_dgo(data, 0x5000);
+  short_truncated.resize(short_truncated.size() / 2);
+  EXPECT_THROW(file_util::decompress_dgo(short_truncated), std::runtime_error);
+}
+
+TEST(CommonUtil, WriteTextFileIfChanged) {
+  auto file_name = (std::filesystem::temp_directory_path() / "test_write_if_changed.txt").string();
+  std::filesystem::remove(file_name);
+  EXPECT_TRUE(file_util::write_text_file_if_changed(file_name, "abc"));
+  EXPECT_FALSE(file_util::write_text_file_if_changed(file_name, "abc"));
+  EXPECT_TRUE(file_util::write_text_file_if_changed(file_name, "abd"));
+  EXPECT_TRUE(file_util::write_text_file_if_changed(file_name, "abd\n"));
+  EXPECT_TRUE(file_util::write_text_file_if_changed(file_name, "abd"));
+  EXPECT_TRUE(file_util::write_text_file_if_changed(file_name, ""));
+  EXPECT_FALSE(file_util::write_text_file_if_changed(file_name, ""));
+  std::string big(200000, 'x');
+  EXPECT_TRUE(file_util::write_text_file_if_changed(file_name, big));
+  EXPECT_FALSE(file_util::write_text_file_if_changed(file_name, big));
+  EXPECT_EQ(file_util::read_text_file(file_name), big + "\n");
+  std::filesystem::remove(file_name);
+}
+
+TEST(CommonUtil, DgoReader) {
+  // two objects, padded to 16 bytes like the real DGOs.
+  std::vector<u8> dgo(64 * 3 + 256 + 512, 0);
+  u32 count = 2, size0 = 256, size1 = 512;
+  memcpy(dgo.data(), &count, 4);
+  strcpy((char*)dgo.data() + 4, "TEST.DGO");
+  memcpy(dgo.data() + 64, &size0, 4);
+  strcpy((char*)dgo.data() + 68, "obj-a");
+  memcpy(dgo.data() + 128 + 256, &size1, 4);
+  strcpy((char*)dgo.data() + 128 + 256 + 4, "obj-b");
+  for (int i = 0; i < 512; i++) {
+    dgo.at(128 + 256 + 64 + i) = i * 3;
+  }
+
+  DgoReader from_memory("TEST.DGO", dgo);
+  ASSERT_EQ(from_memory.entries().size(), 2);
+  EXPECT_EQ(from_memory.internal_name(), "TEST.DGO");
+  EXPECT_EQ(from_memory.entries().at(0).unique_name, "obj-a");
+  EXPECT_EQ(from_memory.entries().at(1).size, 512);
+  // no copy
+  EXPECT_EQ(from_memory.entries().at(1).data, dgo.data() + 128 + 256 + 64);
+
+  auto file_name = (std::filesystem::temp_directory_path() / "TEST.DGO").string();
+  for (bool compress : {false, true}) {
+    auto file_data = compress ? make_compressed_dgo(dgo) : dgo;
+    file_util::write_binary_file(file_name, file_data.data(), file_data.size());
+    DgoReader from_file(file_name);
+    ASSERT_EQ(from_file.entries().size(), 2);
+    EXPECT_EQ(from_file.entries().at(1).internal_name, "obj-b");
+    EXPECT_EQ(from_file.entries().at(1).copy(), from_memory.entries().at(1).copy());
+    EXPECT_EQ(from_file.description_as_json(), from_memory.description_as_json());
+  }
+  std::filesystem::remove(file_name);
+}
+
+TEST(CommonUtil, CompressDgo) {
+  // compressible, with an incompressible chunk in the middle and a partial chunk at the end.
+  std::vector<u8> data;
+  u32 rng = 12345;
+  for (int i = 0; i < 0x8000 * 5 + 1000; i++) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    data.push_back((i / 0x8000 == 2) ? (u8)rng : (u8)(i / 64));
+  }
+
+  auto compressed = file_util::compress_dgo(data.data(), data.size());
+  EXPECT_TRUE(file_util::dgo_header_is_compressed(compressed));
+  EXPECT_LT(compressed.size(), data.size());
+  auto chunks = file_util::scan_dgo_chunks(compressed);
+  EXPECT_EQ(chunks.size(), 6);
+  EXPECT_FALSE(chunks.at(2).compressed);
+  EXPECT_TRUE(chunks.at(5).compressed);
+  EXPECT_EQ(file_util::decompress_dgo(compressed), data);
+
+  // a truncated file should fail instead of reading past the end.
+  std::vector<u8> truncated(compressed.begin(), compressed.begin() + compressed.size() / 2);
+  EXPECT_THROW(file_util::decompress_dgo(truncated), std::runtime_error);
 }
\ No newline at end of file
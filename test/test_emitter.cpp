@@ -618,6 +618,27 @@ TEST(EmitterIntegerMath, jumps) {
             "000000000F83000000000F82000000000F8700000000");
 }
 
+TEST(EmitterIntegerMath, short_jumps) {
+  CodeTester tester;
+  tester.init_code_buffer(256);
+
+  std::vector<Instruction> long_jumps = {IGen::jmp_32(), IGen::je_32(),  IGen::jne_32(),
+                                         IGen::jle_32(), IGen::jge_32(), IGen::jl_32(),
+                                         IGen::jg_32(),  IGen::jbe_32(), IGen::jae_32(),
+                                         IGen::jb_32(),  IGen::ja_32()};
+
+  for (auto& long_jump : long_jumps) {
+    auto x = IGen::jump_32_to_8(long_jump);
+    EXPECT_EQ(x.get_imm_size(), 1);
+    EXPECT_EQ(x.length(), 2);
+    EXPECT_EQ(x.offset_of_imm(), 1);
+    tester.emit(x);
+  }
+
+  EXPECT_EQ(IGen::jmp_8().length(), 2);
+  EXPECT_EQ(tester.dump_to_hex_string(true), "EB00740075007E007D007C007F007600730072007700");
+}
+
 TEST(EmitterIntegerMath, null) {
   auto instr = IGen::null();
   EXPECT_EQ(0, instr.emit(nullptr));
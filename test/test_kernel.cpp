@@ -1,6 +1,8 @@
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include "gtest/gtest.h"
 #include "common/symbols.h"
 #include "common/goal_constants.h"
@@ -9,6 +11,11 @@
 #include "game/kernel/kprint.h"
 #include "game/kernel/kdsnetm.h"
 #include "game/kernel/kscheme.h"
+#include "game/kernel/kmalloc.h"
+#include "game/system/IOP_Kernel.h"
+#include "game/system/frame_stats.h"
+#include "game/sce/iop.h"
+#include "common/util/Timer.h"
 #include "all_jak1_symbols.h"
 
 TEST(Kernel, strend) {
@@ -342,6 +349,55 @@ TEST(Kernel, PrintBuffer) {
   // more complicated tests for format will be done from within GOAL.
 }
 
+TEST(Kernel, KmallocLedger) {
+  constexpr int size = 32 * 1024 * 1024;
+  auto mem = new u8[size];
+  setup_hack_heaps(mem, size);
+
+  // nothing is recorded until the ledger is started.
+  kmalloc(kglobalheap, 100, 0, "before");
+  kmalloc_ledger_enable(true);
+  kmalloc(kglobalheap, 8, 0, "small");
+  kmalloc(kglobalheap, 8, 0, "small");
+  kmalloc(kglobalheap, 100, KMALLOC_ALIGN_256, "aligned");
+  auto old_group = kmalloc_ledger_set_group("test-dgo");
+  EXPECT_EQ(old_group, "");
+  kmalloc(kglobalheap, 1000, KMALLOC_TOP, "temp");
+  kmalloc(kdebugheap, 64, 0, "debug-thing");
+  kmalloc_ledger_set_group(old_group);
+  kmalloc_ledger_enable(false);
+  kmalloc(kglobalheap, 100, 0, "after");
+
+  auto report = kmalloc_ledger_report(Ptr<kheapinfo>(0));
+  auto line = [&](const std::string& name) {
+    auto start = report.find("    " + name + " ");
+    if (start == std::string::npos) {
+      return std::string();
+    }
+    auto end = report.find('\n', start);
+    // collapse the spaces
+    std::string result;
+    for (size_t i = start + 4; i < end; i++) {
+      if (report[i] != ' ' || (!result.empty() && result.back() != ' ')) {
+        result.push_back(report[i]);
+      }
+    }
+    return result;
+  };
+
+  // "before" leaves the heap 4 past a 16 byte boundary, then the first "small" leaves it 8 past.
+  EXPECT_EQ(line("small"), "small bottom 2 16 20");
+  EXPECT_EQ(line("temp"), "temp top 1 1000 8");
+  EXPECT_EQ(line("debug-thing"), "debug-thing bottom 1 64 0");
+  EXPECT_EQ(line("before"), "");
+  EXPECT_EQ(line("after"), "");
+  EXPECT_TRUE(report.find("test-dgo: 0 bytes bottom, 1000 bytes top") != std::string::npos);
+  EXPECT_TRUE(report.find("(global)") < report.find("(debug)"));
+
+  kmalloc_init_globals();
+  delete[] mem;
+}
+
 TEST(Kernel, HashTable) {
   constexpr int size = 32 * 1024 * 1024;
   auto mem = new u8[size];
@@ -385,3 +441,112 @@ TEST(Kernel, HashTable) {
 
   delete[] mem;
 }
+
+namespace {
+IOP_Kernel* test_iop_kernel = nullptr;
+iop::sceSifQueueData test_rpc_queue;
+iop::sceSifServeData test_rpc_serve;
+u32 test_rpc_serve_buff[64];
+constexpr u32 TEST_RPC_ID = 0xdeb4;
+
+void* test_rpc_handler(unsigned int fno, void* data, int size) {
+  (void)size;
+  auto* words = (u32*)data;
+  words[0] += fno;
+  return data;
+}
+
+u32 test_rpc_thread() {
+  test_iop_kernel->set_rpc_queue(&test_rpc_queue, test_iop_kernel->getCurrentThread());
+  test_rpc_serve.command = TEST_RPC_ID;
+  test_rpc_serve.func = test_rpc_handler;
+  test_rpc_serve.buff = test_rpc_serve_buff;
+  test_rpc_queue.serve_data = &test_rpc_serve;
+  test_iop_kernel->sif_register(&test_rpc_queue);
+  test_iop_kernel->rpc_loop(&test_rpc_queue);
+  return 0;
+}
+}  // namespace
+
+TEST(Kernel, SifRpcRoundTrip) {
+  IOP_Kernel kernel;
+  test_iop_kernel = &kernel;
+  auto thread = kernel.CreateThread("test-rpc", test_rpc_thread);
+  kernel.StartThread(thread);
+
+  // zero-copy (send and receive buffers are the same)
+  u32 shared[4] = {1, 2, 3, 4};
+  kernel.sif_rpc(TEST_RPC_ID, 10, true, shared, sizeof(shared), shared, sizeof(shared));
+  EXPECT_TRUE(kernel.sif_busy(TEST_RPC_ID));
+  while (kernel.sif_busy(TEST_RPC_ID)) {
+    kernel.dispatchAll();
+  }
+  EXPECT_EQ(shared[0], 11);
+
+  // copied (different send and receive buffers)
+  u32 send[4] = {5, 6, 7, 8};
+  u32 recv[4] = {0, 0, 0, 0};
+  kernel.sif_rpc(TEST_RPC_ID, 1, true, send, sizeof(send), recv, sizeof(recv));
+  while (kernel.sif_busy(TEST_RPC_ID)) {
+    kernel.dispatchAll();
+  }
+  EXPECT_EQ(send[0], 5);
+  EXPECT_EQ(recv[0], 6);
+  EXPECT_EQ(recv[3], 8);
+
+  // multiple commands in flight
+  kernel.sif_rpc(TEST_RPC_ID, 1, true, shared, sizeof(shared), shared, sizeof(shared));
+  kernel.sif_rpc(TEST_RPC_ID, 2, true, shared, sizeof(shared), shared, sizeof(shared));
+  while (kernel.sif_busy(TEST_RPC_ID)) {
+    kernel.dispatchAll();
+  }
+  EXPECT_EQ(shared[0], 14);
+
+  // no channel for this ID
+  EXPECT_FALSE(kernel.sif_busy(TEST_RPC_ID + 1));
+
+  kernel.shutdown();
+  test_iop_kernel = nullptr;
+}
+
+TEST(Kernel, FrameStats) {
+  frame_stats_init_globals();
+  for (int i = 1; i <= 100; i++) {
+    frame_stats_add_rpc_wait(0.5);
+    frame_stats_add_rpc_wait(0.5);
+    frame_stats_finish_frame(0.25, i);
+  }
+  frame_stats_add_link(2.0);
+  frame_stats_finish_frame(0, 0);
+
+  auto report = frame_stats_report();
+  auto row = [&](const char* name) {
+    std::vector<double> result(4);
+    auto line = report.find(std::string("\n") + name + " ");
+    EXPECT_TRUE(line != std::string::npos);
+    if (line != std::string::npos) {
+      sscanf(report.c_str() + line + 1 + strlen(name), "%lf %lf %lf %lf", &result[0], &result[1],
+             &result[2], &result[3]);
+    }
+    return result;
+  };
+
+  EXPECT_TRUE(report.find("101 frames") != std::string::npos);
+  EXPECT_EQ(row("dispatch"), std::vector<double>({50, 99, 100, 5050}));
+  EXPECT_EQ(row("rpc-wait"), std::vector<double>({1, 1, 1, 100}));
+  EXPECT_EQ(row("listener"), std::vector<double>({0.25, 0.25, 0.25, 25}));
+  EXPECT_EQ(row("link"), std::vector<double>({0, 0, 2, 2}));
+
+  // the frame limiter should slow the loop down.
+  frame_stats_set_limit(200);
+  Timer timer;
+  for (int i = 0; i < 20; i++) {
+    frame_stats_finish_frame(0, 0);
+  }
+  EXPECT_GT(timer.getMs(), 90);
+  EXPECT_TRUE(frame_stats_report().find("limited to 200 fps") != std::string::npos);
+
+  frame_stats_reset();
+  EXPECT_TRUE(frame_stats_report().find("0 frames") == 0);
+  frame_stats_init_globals();
+}
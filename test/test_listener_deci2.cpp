@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 #include "goalc/listener/Listener.h"
 #include "game/system/Deci2Server.h"
+#include "game/sce/deci2.h"
 
 using namespace listener;
 
@@ -8,6 +9,26 @@ namespace {
 bool always_false() {
   return false;
 }
+
+/*!
+ * A DECI2 protocol driver that just collects what it receives.
+ */
+struct TestDriver {
+  s32 socket = 0;
+  std::vector<u8> data;
+  int messages_done = 0;
+};
+
+void test_driver_handler(s32 event, s32 param, void* opt) {
+  auto* driver = (TestDriver*)opt;
+  if (event == DECI2_READ) {
+    auto start = driver->data.size();
+    driver->data.resize(start + param);
+    ee::sceDeci2ExRecv(driver->socket, driver->data.data() + start, param);
+  } else if (event == DECI2_READDONE) {
+    driver->messages_done++;
+  }
+}
 }  // namespace
 
 TEST(Listener, ListenerCreation) {
@@ -111,3 +132,46 @@ TEST(Listener, ListenerThenDeci) {
     }
   }
 }
+
+TEST(Listener, LargePipelinedMessages) {
+  Deci2Server s(always_false);
+  ee::LIBRARY_INIT_sceDeci2();
+  ee::LIBRARY_sceDeci2_register(&s);
+  TestDriver driver;
+  driver.socket = ee::sceDeci2Open(DECI2_PROTOCOL, &driver, test_driver_handler);
+  EXPECT_TRUE(s.init());
+  Listener l;
+  bool connected = l.connect_to_target();
+  EXPECT_TRUE(connected);
+  while (connected && !s.check_for_listener()) {
+  }
+
+  // larger than 64 kB, so this needs a 32-bit length and is delivered in several reads.
+  std::vector<u8> big(200000);
+  for (size_t i = 0; i < big.size(); i++) {
+    big[i] = i * 7;
+  }
+  std::vector<u8> small = {1, 2, 3};
+  // send both without waiting for an ack.
+  EXPECT_EQ(1, l.queue_code(big));
+  EXPECT_EQ(2, l.queue_code(small));
+
+  s.run();
+  EXPECT_EQ(1, driver.messages_done);
+  ASSERT_EQ(big.size() + sizeof(ListenerMessageHeader), driver.data.size());
+  auto* hdr = (ListenerMessageHeader*)driver.data.data();
+  EXPECT_EQ(driver.data.size(), hdr->deci2_header.len);
+  EXPECT_EQ(big.size(), hdr->msg_size);
+  EXPECT_EQ(1, hdr->msg_id);
+  EXPECT_EQ(0, memcmp(big.data(), driver.data.data() + sizeof(ListenerMessageHeader), big.size()));
+
+  // the second message is held until the driver is done with the first.
+  driver.data.clear();
+  ee::LIBRARY_sceDeci2_receive_done(driver.socket);
+  s.run();
+  EXPECT_EQ(2, driver.messages_done);
+  ASSERT_EQ(small.size() + sizeof(ListenerMessageHeader), driver.data.size());
+  hdr = (ListenerMessageHeader*)driver.data.data();
+  EXPECT_EQ(2, hdr->msg_id);
+  EXPECT_EQ(0, memcmp(small.data(), driver.data.data() + sizeof(ListenerMessageHeader), 3));
+}
@@ -84,4 +84,32 @@ TEST(PrettyPrinter, DefunNoArgs) {
             "   )\n"
             "  (the-as symbol #f)\n"
             "  )");
-}
\ No newline at end of file
+}
+
+TEST(PrettyPrinter, NestedBreaks) {
+  EXPECT_EQ(ppr("(defun foo ((a int) (b int)) (let ((x (+ a b)) (y (* a b))) (if (> x y) (format "
+                "#t \"~D~%\" (+ x (* y (- x y)))) (cond ((zero? x) 0) (else (-> self root trans "
+                "x))))))",
+                30),
+            "(defun foo ((a int) (b int))\n"
+            "  (let ((x (+ a b))\n"
+            "        (y (* a b))\n"
+            "        )\n"
+            "   (if (> x y)\n"
+            "    (format\n"
+            "     #t\n"
+            "     \"~D~%\"\n"
+            "     (+ x (* y (- x y)))\n"
+            "     )\n"
+            "    (cond\n"
+            "     ((zero? x)\n"
+            "      0\n"
+            "      )\n"
+            "     (else\n"
+            "      (-> self root trans x)\n"
+            "      )\n"
+            "     )\n"
+            "    )\n"
+            "   )\n"
+            "  )");
+}
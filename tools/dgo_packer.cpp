@@ -9,13 +9,20 @@ int main(int argc, char** argv) {
   printf("DGO Packing Tool\n");
 
   if (argc < 3) {
-    printf("usage: dgo_packer <path> <dgo description file>\n");
+    printf("usage: dgo_packer [--compress] <path> <dgo description files>\n");
     return 1;
   }
 
-  std::string out_path = argv[1];
+  int arg_idx = 1;
+  bool compress = false;
+  if (std::string(argv[arg_idx]) == "--compress") {
+    compress = true;
+    arg_idx++;
+  }
+
+  std::string out_path = argv[arg_idx++];
 
-  for (int i = 2; i < argc; i++) {
+  for (int i = arg_idx; i < argc; i++) {
     std::string file_name = argv[i];
     std::string file_text = file_util::read_text_file(file_name);
 
@@ -43,7 +50,15 @@ int main(int argc, char** argv) {
         writer.add<uint8_t>(0);
       }
     }
-    writer.write_to_file(file_util::combine_path(out_path, "mod_" + out_file_name));
+    auto out_name = file_util::combine_path(out_path, "mod_" + out_file_name);
+    if (compress) {
+      auto compressed = file_util::compress_dgo((const u8*)writer.get_data(), writer.get_size());
+      printf(" Compressed from %d to %d bytes (%.2f%%)\n", int(writer.get_size()),
+             int(compressed.size()), 100.f * compressed.size() / writer.get_size());
+      file_util::write_binary_file(out_name, compressed.data(), compressed.size());
+    } else {
+      writer.write_to_file(out_name);
+    }
   }
 
   printf("Done\n");
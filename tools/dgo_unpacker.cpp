@@ -18,24 +18,15 @@ int main(int argc, char** argv) {
     std::string file_name = argv[i];
     std::string base = file_util::base_name(file_name);
     printf("Unpacking %s\n", base.c_str());
-    // read the file
-    auto data = file_util::read_binary_file(file_name);
-    if (file_util::dgo_header_is_compressed(data)) {
-      printf(" Detected compressed dgo, decompressing...\n");
-      auto original_size = data.size();
-      data = file_util::decompress_dgo(data);
-      printf(" Decompressed from %d to %d bytes (%.2f%% compression)\n", int(original_size),
-             int(data.size()), 100.f * original_size / data.size());
-    }
-    // read as a DGO
-    auto dgo = DgoReader(base, data);
+    // read as a DGO, decompressing if needed.
+    auto dgo = DgoReader(file_name);
     // write dgo description
     file_util::write_text_file(file_util::combine_path(out_path, base + ".txt"),
                                dgo.description_as_json());
     // write files:
     for (auto& entry : dgo.entries()) {
       file_util::write_binary_file(file_util::combine_path(out_path, entry.unique_name),
-                                   (const void*)entry.data.data(), entry.data.size());
+                                   (const void*)entry.data, entry.size);
     }
   }
 